@@ -0,0 +1,49 @@
+#include <stddef.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+
+#ifndef ALLOCATION_TRACER
+#define ALLOCATION_TRACER
+
+#ifdef CONFIG_CRYPTO_API_ALLOC_TRACE
+#define CRYPTO_API_ALLOC_TRACE 1
+#else
+#define CRYPTO_API_ALLOC_TRACE 0
+#endif
+
+#ifdef CONFIG_CRYPTO_API_ALLOC_TRACE_SLOTS
+#define CRYPTO_API_ALLOC_TRACE_SLOTS CONFIG_CRYPTO_API_ALLOC_TRACE_SLOTS
+#else
+#define CRYPTO_API_ALLOC_TRACE_SLOTS 256
+#endif
+
+// What one traced operation allocated. peak_bytes is the most it held at
+// once and leaked_bytes what it had not freed when it returned (for
+// gen_keys() that includes the keys it keeps). Allocations beyond
+// CRYPTO_API_ALLOC_TRACE_SLOTS live ones are counted in `untracked` and left
+// out of both byte figures.
+struct AllocationStats
+{
+  uint32_t allocations;
+  uint32_t frees;
+  uint32_t peak_bytes;
+  uint32_t leaked_bytes;
+  uint32_t untracked;
+};
+
+// Follows every allocation and free between start() and stop(). With
+// CONFIG_HEAP_USE_HOOKS it sees the whole heap through the ESP-IDF heap
+// hooks (the host shim calls the same hooks); otherwise it installs itself as
+// the mbedTLS and wolfSSL allocator and only sees what those libraries
+// allocate. One operation can be traced at a time.
+class AllocationTracer
+{
+public:
+  static void start();
+  static void stop(AllocationStats *stats);
+
+  static void on_alloc(void *ptr, size_t size);
+  static void on_free(void *ptr);
+};
+
+#endif
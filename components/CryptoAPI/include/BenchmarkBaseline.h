@@ -0,0 +1,58 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "BenchmarkLog.h"
+#include "BenchmarkRunner.h"
+
+#ifndef BENCHMARK_BASELINE
+#define BENCHMARK_BASELINE
+
+#define BASELINE_NAME_MAX 12
+
+// The statistics of one operation in one configuration, as saved in a
+// baseline file. Names are the exported-results names (library_name() etc.).
+struct BaselineEntry
+{
+  char library[BASELINE_NAME_MAX];
+  char algorithm[BASELINE_NAME_MAX];
+  char hash[BASELINE_NAME_MAX];
+  char operation[BENCHMARK_OPERATION_MAX];
+  uint32_t samples;
+  uint64_t median_ns;
+  double mean_ns;
+  double stddev_ns;
+};
+
+// A set of BenchmarkRunner results that can be saved as CSV and later
+// compared against a new run. A difference counts when the means differ by
+// more than the threshold and Welch's t-test finds it significant at 95%;
+// smaller or noisier differences are reported as unchanged.
+class BenchmarkBaseline
+{
+public:
+  BenchmarkBaseline();
+  ~BenchmarkBaseline();
+
+  int add(int library, int algorithm, int hash, const char *operation, const BenchmarkStats &stats);
+  void clear();
+
+  int save(const char *file_path);
+  int load(const char *file_path);
+
+  // Prints one row per operation of either run, with the change of the mean
+  // and its verdict, and returns the number of regressions.
+  int compare(BenchmarkBaseline &current, double threshold_percent, FILE *out);
+
+  size_t size();
+  const BaselineEntry &at(size_t index);
+
+private:
+  BaselineEntry *entries;
+  size_t count;
+  size_t capacity;
+
+  int append(const BaselineEntry &entry);
+  const BaselineEntry *find(const BaselineEntry &key);
+};
+
+#endif
@@ -0,0 +1,79 @@
+#include <stdint.h>
+#include <stdio.h>
+#include "sdkconfig.h"
+
+#ifndef BENCHMARK_LOG
+#define BENCHMARK_LOG
+
+#ifdef CONFIG_CRYPTO_API_RESULT_LOG_SIZE
+#define CRYPTO_API_RESULT_LOG_SIZE CONFIG_CRYPTO_API_RESULT_LOG_SIZE
+#else
+#define CRYPTO_API_RESULT_LOG_SIZE 256
+#endif
+
+#define BENCHMARK_OPERATION_MAX 24
+
+enum ResultFormat
+{
+  RESULT_CSV,
+  RESULT_JSON
+};
+
+// One measured operation. library/algorithm/hash hold the Libraries,
+// Algorithms and Hashes values (-1 when not known); message_length is the
+// number of bytes the operation hashed, 0 for key generation. elapsed_ns and
+// cycles have the cost of the timing probe already taken out.
+struct BenchmarkRecord
+{
+  int8_t library;
+  int8_t algorithm;
+  int8_t hash;
+  char operation[BENCHMARK_OPERATION_MAX];
+  uint32_t message_length;
+  uint32_t peak_heap_bytes;
+  uint64_t elapsed_ns;
+  uint64_t cycles;
+};
+
+// Number of Libraries, Algorithms and Hashes values, for code that walks
+// every combination
+#define BENCHMARK_LIBRARY_COUNT 3
+#define BENCHMARK_ALGORITHM_COUNT 7
+#define BENCHMARK_HASH_COUNT 4
+
+// Short names of Libraries, Algorithms and Hashes values as they appear in
+// exported results ("mbedtls", "bp256r1", "sha3-256"); "unknown" otherwise
+const char *library_name(int library);
+const char *algorithm_name(int algorithm);
+const char *hash_name(int hash);
+
+// Ring buffer of the last CRYPTO_API_RESULT_LOG_SIZE records. The storage is
+// allocated on the first add(), so an image that never measures pays nothing.
+// When full, the oldest record is overwritten and counted as dropped.
+class BenchmarkLog
+{
+public:
+  BenchmarkLog();
+  ~BenchmarkLog();
+
+  void add(const BenchmarkRecord &record);
+  void clear();
+
+  size_t size();
+  unsigned long get_dropped();
+  // Oldest first
+  const BenchmarkRecord &at(size_t index);
+
+  int write(FILE *out, ResultFormat format);
+
+private:
+  BenchmarkRecord *records;
+  size_t head;
+  size_t count;
+  unsigned long dropped;
+
+  void write_csv(FILE *out);
+  void write_json(FILE *out);
+};
+
+#endif
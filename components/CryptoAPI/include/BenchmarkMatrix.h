@@ -0,0 +1,64 @@
+#include <stddef.h>
+#include <stdio.h>
+#include "sdkconfig.h"
+#include "BenchmarkRunner.h"
+#include "CryptoAPI.h"
+
+#ifndef BENCHMARK_MATRIX
+#define BENCHMARK_MATRIX
+
+#ifdef CONFIG_CRYPTO_API_BENCH_KEYGEN_ITERATIONS
+#define CRYPTO_API_BENCH_KEYGEN_ITERATIONS CONFIG_CRYPTO_API_BENCH_KEYGEN_ITERATIONS
+#else
+#define CRYPTO_API_BENCH_KEYGEN_ITERATIONS 3
+#endif
+
+// Results of one library/algorithm/hash combination. status is 0, or the
+// first non-zero status of init, key generation, sign or verify, in which
+// case the stats after it are all zero.
+struct MatrixCell
+{
+  Libraries library;
+  Algorithms algorithm;
+  Hashes hash;
+  int status;
+  BenchmarkStats keygen;
+  BenchmarkStats sign;
+  BenchmarkStats verify;
+};
+
+// Benchmarks every Libraries x Algorithms x Hashes combination that
+// CryptoAPI::is_supported() accepts, one after the other on the same
+// CryptoAPI: init, then key generation, sign and verify through
+// BenchmarkRunner. Key generation is not warmed up and runs
+// `keygen_iterations` times, since RSA key generation alone can take seconds.
+// A failing cell is recorded and the run moves on to the next one.
+class BenchmarkMatrix
+{
+public:
+  BenchmarkMatrix(CryptoAPI &crypto_api, int warmup = CRYPTO_API_BENCH_WARMUP, int iterations = CRYPTO_API_BENCH_ITERATIONS, int keygen_iterations = CRYPTO_API_BENCH_KEYGEN_ITERATIONS);
+  ~BenchmarkMatrix();
+
+  // Signs and verifies `message` in every cell. Returns 0 if every cell
+  // passed, otherwise the status of the first one that failed.
+  int run(const unsigned char *message, size_t message_length, unsigned int rsa_key_size, int rsa_exponent, size_t shake_256_length);
+
+  // One row per cell with the median key generation time and the median,
+  // p95 and 95% confidence interval of sign and verify, in milliseconds
+  void print_table(FILE *out);
+
+  size_t size();
+  const MatrixCell &at(size_t index);
+
+private:
+  CryptoAPI &crypto_api;
+  int warmup;
+  int iterations;
+  int keygen_iterations;
+  MatrixCell *cells;
+  size_t count;
+
+  int run_cell(MatrixCell &cell, const unsigned char *message, size_t message_length, unsigned int rsa_key_size, int rsa_exponent, size_t shake_256_length);
+};
+
+#endif
@@ -0,0 +1,70 @@
+#include <stddef.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_log.h"
+
+#ifndef BENCHMARK_RUNNER
+#define BENCHMARK_RUNNER
+
+#ifdef CONFIG_CRYPTO_API_BENCH_WARMUP
+#define CRYPTO_API_BENCH_WARMUP CONFIG_CRYPTO_API_BENCH_WARMUP
+#else
+#define CRYPTO_API_BENCH_WARMUP 5
+#endif
+
+#ifdef CONFIG_CRYPTO_API_BENCH_ITERATIONS
+#define CRYPTO_API_BENCH_ITERATIONS CONFIG_CRYPTO_API_BENCH_ITERATIONS
+#else
+#define CRYPTO_API_BENCH_ITERATIONS 50
+#endif
+
+// The operation being benchmarked. Returns 0 on success; any other value
+// stops the run and is returned by BenchmarkRunner::run().
+typedef int (*BenchmarkOperation)(void *user_data);
+
+// Summary of the measured iterations that were kept. All times are in
+// nanoseconds; ci95_ns is the half-width of the 95% confidence interval of
+// the mean.
+struct BenchmarkStats
+{
+  size_t samples;
+  size_t rejected;
+  uint64_t min_ns;
+  uint64_t median_ns;
+  uint64_t p95_ns;
+  uint64_t p99_ns;
+  uint64_t max_ns;
+  double mean_ns;
+  double stddev_ns;
+  double ci95_ns;
+};
+
+// Runs an operation `warmup` times unmeasured, then `iterations` times
+// measured, and summarises the measured times. Samples with a modified
+// z-score above 3.5 (median absolute deviation based) are rejected as
+// outliers, which drops the odd iteration stalled by a flash write or an
+// interrupt without being pulled around by the stall itself.
+//
+// While running, the log level is lowered to `log_level` so the modules'
+// per-operation ESP_LOGI output is not part of what is measured.
+class BenchmarkRunner
+{
+public:
+  BenchmarkRunner(int warmup = CRYPTO_API_BENCH_WARMUP, int iterations = CRYPTO_API_BENCH_ITERATIONS, esp_log_level_t log_level = ESP_LOG_WARN);
+
+  int run(const char *label, BenchmarkOperation operation, void *user_data, BenchmarkStats *stats);
+  void print_stats(const char *label, const BenchmarkStats &stats);
+
+  // Fills `stats` from raw samples; sorts `samples` in place
+  static void summarize(uint64_t *samples, size_t count, BenchmarkStats *stats);
+  // Two-sided 95% Student t value; fractional degrees of freedom (as from
+  // Welch's test) are rounded down, which errs on the strict side
+  static double t_critical_95(double degrees);
+
+private:
+  int warmup;
+  int iterations;
+  esp_log_level_t log_level;
+};
+
+#endif
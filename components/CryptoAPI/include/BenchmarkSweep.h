@@ -0,0 +1,87 @@
+#include <stddef.h>
+#include <stdio.h>
+#include "sdkconfig.h"
+#include "BenchmarkRunner.h"
+#include "CryptoAPI.h"
+
+#ifndef BENCHMARK_SWEEP
+#define BENCHMARK_SWEEP
+
+#ifdef CONFIG_CRYPTO_API_BENCH_SWEEP_MAX_SIZE
+#define CRYPTO_API_BENCH_SWEEP_MAX_SIZE CONFIG_CRYPTO_API_BENCH_SWEEP_MAX_SIZE
+#else
+#define CRYPTO_API_BENCH_SWEEP_MAX_SIZE 4194304
+#endif
+
+#ifdef CONFIG_CRYPTO_API_BENCH_SWEEP_ITERATIONS
+#define CRYPTO_API_BENCH_SWEEP_ITERATIONS CONFIG_CRYPTO_API_BENCH_SWEEP_ITERATIONS
+#else
+#define CRYPTO_API_BENCH_SWEEP_ITERATIONS 5
+#endif
+
+// The message is generated in pieces of this size and fed through
+// sign_update()/verify_update(), so only one piece is ever in RAM
+#define BENCHMARK_SWEEP_CHUNK 4096
+
+// One library/hash combination at one message size. hashing is the time
+// sign_update() took to stream the message, sign and verify the whole
+// init/update/final sequence. status is 0, or the first non-zero status of
+// init, key generation, sign or verify, in which case the stats are all zero.
+struct SweepPoint
+{
+  Libraries library;
+  Algorithms algorithm;
+  Hashes hash;
+  size_t message_length;
+  int status;
+  BenchmarkStats hashing;
+  BenchmarkStats sign;
+  BenchmarkStats verify;
+};
+
+// Signs and verifies messages of 0 bytes and then 64 bytes, quadrupling up
+// to `max_size`, with every library and hash CryptoAPI::is_supported()
+// accepts for one algorithm. Each size is measured `iterations` times after
+// one unmeasured run, through the streaming API, so a multi-megabyte message
+// needs no more RAM than a small one.
+//
+// Hashing time grows with the message while the signature math does not; the
+// crossover is the message length at which the two take the same time,
+// estimated from the hash throughput of the largest size and the signature
+// math of the smallest.
+class BenchmarkSweep
+{
+public:
+  BenchmarkSweep(CryptoAPI &crypto_api, size_t max_size = CRYPTO_API_BENCH_SWEEP_MAX_SIZE, int iterations = CRYPTO_API_BENCH_SWEEP_ITERATIONS);
+  ~BenchmarkSweep();
+
+  // Returns 0 if every combination passed, otherwise the status of the first
+  // one that failed
+  int run(Algorithms algorithm, unsigned int rsa_key_size, int rsa_exponent, size_t shake_256_length);
+
+  // One row per point with the hash throughput in MB/s and the median sign
+  // and verify times, then the sign and verify crossover of each combination
+  void print_table(FILE *out);
+
+  // Message length at which hashing takes as long as the signature math of
+  // sign (or verify), for the combination of `point`; 0 if not measured
+  size_t sign_crossover(const SweepPoint &point);
+  size_t verify_crossover(const SweepPoint &point);
+
+  size_t size();
+  const SweepPoint &at(size_t index);
+
+private:
+  CryptoAPI &crypto_api;
+  size_t max_size;
+  int iterations;
+  SweepPoint *points;
+  size_t count;
+
+  size_t sizes_per_combination();
+  int run_combination(SweepPoint *first, unsigned int rsa_key_size, int rsa_exponent, size_t shake_256_length);
+  int run_point(SweepPoint &point, unsigned char *chunk, unsigned char *signature, size_t signature_size);
+  size_t crossover(const SweepPoint &point, bool verify);
+};
+
+#endif
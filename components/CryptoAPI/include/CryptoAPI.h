@@ -1,21 +1,62 @@
+#include "sdkconfig.h"
+#include "AllocationTracer.h"
 #include "CryptoApiCommons.h"
 #include "ICryptoModule.h"
+#include "VerifyKeyCache.h"
 
 #ifndef CRYPTO_API
 #define CRYPTO_API
 
-enum Libraries
-{
-  MBEDTLS_LIB,
-  WOLFSSL_LIB,
-  MICROECC_LIB
-};
+// Backends compiled into the image, selected in menuconfig under "CryptoAPI".
+// They can also be forced with e.g. -DCRYPTO_API_WITH_WOLFSSL=0.
+#ifndef CRYPTO_API_WITH_MBEDTLS
+#ifdef CONFIG_CRYPTO_API_BACKEND_MBEDTLS
+#define CRYPTO_API_WITH_MBEDTLS 1
+#else
+#define CRYPTO_API_WITH_MBEDTLS 0
+#endif
+#endif
+
+#ifndef CRYPTO_API_WITH_WOLFSSL
+#ifdef CONFIG_CRYPTO_API_BACKEND_WOLFSSL
+#define CRYPTO_API_WITH_WOLFSSL 1
+#else
+#define CRYPTO_API_WITH_WOLFSSL 0
+#endif
+#endif
+
+#ifndef CRYPTO_API_WITH_MICROECC
+#ifdef CONFIG_CRYPTO_API_BACKEND_MICROECC
+#define CRYPTO_API_WITH_MICROECC 1
+#else
+#define CRYPTO_API_WITH_MICROECC 0
+#endif
+#endif
+
+#define CRYPTO_API_BACKEND_COUNT (CRYPTO_API_WITH_MBEDTLS + CRYPTO_API_WITH_WOLFSSL + CRYPTO_API_WITH_MICROECC)
+
+#if CRYPTO_API_BACKEND_COUNT == 0
+#error "CryptoAPI needs at least one backend enabled"
+#endif
 
 class MbedtlsModule;
 class WolfsslModule;
 class MicroeccModule;
 
-class CryptoAPI : public ICryptoModule
+// With a single backend the active module has a concrete (final) type, so
+// every forwarded call is a direct call. Otherwise it goes through one
+// virtual call on the module bound at init().
+#if CRYPTO_API_BACKEND_COUNT == 1 && CRYPTO_API_WITH_MBEDTLS
+typedef MbedtlsModule CryptoBackend;
+#elif CRYPTO_API_BACKEND_COUNT == 1 && CRYPTO_API_WITH_WOLFSSL
+typedef WolfsslModule CryptoBackend;
+#elif CRYPTO_API_BACKEND_COUNT == 1 && CRYPTO_API_WITH_MICROECC
+typedef MicroeccModule CryptoBackend;
+#else
+typedef ICryptoModule CryptoBackend;
+#endif
+
+class CryptoAPI final : public ICryptoModule
 {
 public:
   CryptoAPI();
@@ -23,15 +64,48 @@ public:
 
   int init(Libraries lib, Algorithms algorithm, Hashes hash, size_t length_of_shake256);
   int init(Algorithms algorithm, Hashes hash, size_t length_of_shake256);
+  // Makes `library` the active backend again without touching its keys, as
+  // CryptoSession does when switching back to a library it already set up.
+  int bind(Libraries library, Algorithms algorithm, Hashes hash, size_t length_of_shake256);
+  // Whether `library` is built into this image and implements `algorithm`
+  // with `hash`. init() does not check; unsupported combinations fall back
+  // to a default curve or hash.
+  static bool is_supported(Libraries library, Algorithms algorithm, Hashes hash);
   int get_signature_size();
 
   int gen_rsa_keys(unsigned int rsa_key_size, int rsa_exponent);
   int gen_keys();
 
   int sign(const unsigned char *message, size_t message_length, unsigned char *signature, size_t *signature_length);
+  int sign_batch(const unsigned char *const *messages, const size_t *message_lengths, size_t count, unsigned char *const *signatures, size_t *signature_lengths);
   int verify(const unsigned char *message, size_t message_length, unsigned char *signature, size_t signature_length);
   void close();
 
+  int sign_init();
+  int sign_update(const unsigned char *data, size_t data_length);
+  int sign_final(unsigned char *signature, size_t *signature_length);
+  int verify_init();
+  int verify_update(const unsigned char *data, size_t data_length);
+  int verify_final(unsigned char *signature, size_t signature_length);
+
+  size_t get_digest_length();
+  int hash_message(const unsigned char *message, size_t message_length, unsigned char *hash);
+  int sign_hash(const unsigned char *hash, size_t hash_length, unsigned char *signature, size_t *signature_length);
+
+  // Same contract as sign_batch, but hashing runs on its own task (pinned to
+  // the other core) while this task signs, with a bounded queue in between.
+  int sign_pipelined(const unsigned char *const *messages, const size_t *message_lengths, size_t count, unsigned char *const *signatures, size_t *signature_lengths);
+
+  // Verifies a signature over `message` by someone else's key: with
+  // micro-ecc, a raw 64-byte secp256r1 public key (X then Y). Keys seen
+  // before are looked up in a cache of their precomputed multiples (LRU,
+  // CONFIG_CRYPTO_API_KEY_CACHE_BYTES), so repeat verifications against the
+  // same few keys skip that setup. Other libraries return -1.
+  int verify_with_key(const unsigned char *public_key, size_t public_key_length, const unsigned char *message, size_t message_length, const unsigned char *signature, size_t signature_length);
+  // Hits, misses and evictions of that cache; all zero without micro-ecc
+  KeyCacheStats get_key_cache_stats();
+  void clear_key_cache();
+
   size_t get_public_key_size();
   size_t get_public_key_pem_size();
   int get_public_key_pem(unsigned char *public_key_pem);
@@ -48,12 +122,41 @@ public:
   Algorithms get_chosen_algorithm();
   Libraries get_chosen_library();
 
+  // Every measured operation is kept as a BenchmarkRecord in a RAM ring
+  // buffer. Export writes them as CSV or JSON to file_path (a /littlefs/...
+  // path on the device) or to stdout when file_path is NULL.
+  int export_results(const char *file_path, ResultFormat format);
+  void clear_results();
+
+  // With CONFIG_CRYPTO_API_DEFERRED_LOG, the operation logs are written to a
+  // TraceLog and printed by a low-priority task. Prints whatever it has not
+  // printed yet, e.g. before reading the console at the end of a run.
+  void flush_log();
+
+  // With CONFIG_CRYPTO_API_SPAN_TRACE, writes the phases of the last
+  // operations (hashing, DRBG, key operations, encoding, LittleFS I/O) as a
+  // Chrome trace-event JSON file for Perfetto, to file_path or stdout.
+  int export_spans(const char *file_path);
+
+  // With CONFIG_CRYPTO_API_ALLOC_TRACE, what the last gen_keys(),
+  // gen_rsa_keys(), sign() or verify() allocated; all zero otherwise.
+  AllocationStats get_last_allocations();
+
 private:
   CryptoApiCommons commons;
   MbedtlsModule *mbedtls_module;
   WolfsslModule *wolfssl_module;
   MicroeccModule *microecc_module;
+  CryptoBackend *module;
   Libraries chosen_library;
+  AllocationStats last_allocations;
+
+  CryptoBackend *module_for(Libraries library);
+  bool has_module();
+  MbedtlsModule *get_mbedtls_module();
+  void set_batch_length(const size_t *message_lengths, size_t count);
+  void begin_allocation_trace();
+  void end_allocation_trace(const char *label);
 
   void print_init_configuration(Libraries library, Algorithms algorithm, Hashes hash, size_t length_of_shake256);
 };
@@ -2,12 +2,30 @@
 #include "freertos/task.h"
 #include "esp_system.h"
 #include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
 #include "esp_log.h"
 #include "esp_littlefs.h"
+#include "AllocationTracer.h"
+#include "BenchmarkLog.h"
+#include "TraceLog.h"
 
 #ifndef CRYPTO_API_COMMONS
 #define CRYPTO_API_COMMONS
 
+#ifdef CONFIG_CRYPTO_API_INSTRUMENTATION
+#define CRYPTO_API_INSTRUMENTATION 1
+#else
+#define CRYPTO_API_INSTRUMENTATION 0
+#endif
+
+enum Libraries
+{
+  MBEDTLS_LIB,
+  WOLFSSL_LIB,
+  MICROECC_LIB
+};
+
 enum Algorithms
 {
   ECDSA_BP256R1,
@@ -27,6 +45,14 @@ enum Hashes
   MY_SHAKE_256,
 };
 
+// One reading of both clocks: esp_timer in microseconds and the 32-bit CPU
+// cycle counter, which wraps every ~27 s at 160 MHz.
+struct Timestamp
+{
+  int64_t time_us;
+  uint32_t cycles;
+};
+
 class CryptoApiCommons
 {
 public:
@@ -36,13 +62,38 @@ public:
   Hashes get_chosen_hash();
   void set_chosen_hash(Hashes hash);
   void set_shake256_hash_length(size_t length);
+  void set_chosen_library(Libraries library);
+  // Bytes hashed by the operation being measured, for the result records
+  void set_message_length(size_t length);
+  void add_message_length(size_t length);
   void log_success(const char *msg);
   void log_error(const char *msg);
-  void print_elapsed_time(unsigned long start, unsigned long end, const char *label);
+  void print_elapsed_time(const Timestamp &start, const Timestamp &end, const char *label);
   void print_used_memory(unsigned long initial, unsigned long final, const char *label);
-  void print_total_cycles(unsigned long initial, unsigned long final, const char *label);
+  void print_total_cycles(const Timestamp &start, const Timestamp &end, const char *label);
+  void print_allocations(const AllocationStats &stats, const char *label);
+
+  static Timestamp get_timestamp();
+  // Cycles between two timestamps, counting counter wraps and minus the cost
+  // of one get_timestamp() call
+  static uint64_t elapsed_cycles(const Timestamp &start, const Timestamp &end);
+  static uint64_t elapsed_ns(const Timestamp &start, const Timestamp &end);
+  static uint64_t cycles_to_ns(uint64_t cycles);
+  // Measures the cycle counter rate against esp_timer and the probe cost.
+  // Runs once, on the first get_timestamp().
+  static void calibrate_timer();
+  static uint32_t get_probe_overhead_cycles();
   size_t get_hash_length();
 
+  // Every print_* above also fills in a BenchmarkRecord for its label; the
+  // record is stored once all three values are in or the label changes.
+  void flush_results();
+  void clear_results();
+  int export_results(const char *file_path, ResultFormat format);
+  BenchmarkLog &get_results();
+  // Writes the SpanTrace ring as Chrome trace-event JSON, same paths as above
+  int export_spans(const char *file_path);
+
   void init_littlefs();
   void close_littlefs();
   void write_file(const char *file_path, const unsigned char *data);
@@ -55,6 +106,128 @@ private:
   Hashes chosen_hash;
   size_t shake256_hash_length;
   esp_vfs_littlefs_conf_t conf;
+  bool littlefs_mounted;
+  int chosen_library;
+  size_t message_length;
+  BenchmarkLog results;
+  BenchmarkRecord pending;
+  unsigned int pending_fields;
+
+  // Opens file_path for an export, mounting LittleFS for /littlefs/ paths if
+  // it is not mounted; close_export() unmounts it again in that case
+  FILE *open_export(const char *file_path, bool *mounted_here);
+  void close_export(FILE *file, bool mounted_here);
+
+  BenchmarkRecord &pending_record(const char *label, unsigned int field);
+};
+
+// Probes for ScopedMeasure
+struct MeasureTime
+{
+  static constexpr unsigned int mask = 1 << 0;
+};
+
+struct MeasureHeap
+{
+  static constexpr unsigned int mask = 1 << 1;
+};
+
+struct MeasureCycles
+{
+  static constexpr unsigned int mask = 1 << 2;
 };
 
-#endif
\ No newline at end of file
+#if CRYPTO_API_INSTRUMENTATION
+
+// Measures the code between its construction and stop() with the given
+// probes and hands the results to the print_* calls of `commons`, which log
+// them and fill in the benchmark record for `label`. Leaving the scope
+// without stop(), as error paths do, records nothing but still ends the heap
+// monitor. Timestamps are taken inside the heap reads, so the heap probe's
+// cost is not part of the measured time.
+template <typename... Probes>
+class ScopedMeasure
+{
+public:
+  ScopedMeasure(CryptoApiCommons &commons, const char *label) : commons(commons), label(label), running(true), start(), initial_memory(0)
+  {
+    if (probes & MeasureHeap::mask)
+    {
+      heap_caps_monitor_local_minimum_free_size_start();
+      initial_memory = esp_get_minimum_free_heap_size();
+    }
+    if (probes & (MeasureTime::mask | MeasureCycles::mask))
+    {
+      start = CryptoApiCommons::get_timestamp();
+    }
+  }
+
+  ~ScopedMeasure()
+  {
+    if (running && (probes & MeasureHeap::mask))
+    {
+      heap_caps_monitor_local_minimum_free_size_stop();
+    }
+  }
+
+  ScopedMeasure(const ScopedMeasure &) = delete;
+  ScopedMeasure &operator=(const ScopedMeasure &) = delete;
+
+  void stop()
+  {
+    if (!running)
+    {
+      return;
+    }
+    running = false;
+
+    Timestamp end = {};
+    if (probes & (MeasureTime::mask | MeasureCycles::mask))
+    {
+      end = CryptoApiCommons::get_timestamp();
+    }
+    unsigned long final_memory = 0;
+    if (probes & MeasureHeap::mask)
+    {
+      final_memory = esp_get_minimum_free_heap_size();
+      heap_caps_monitor_local_minimum_free_size_stop();
+    }
+
+    if (probes & MeasureTime::mask)
+    {
+      commons.print_elapsed_time(start, end, label);
+    }
+    if (probes & MeasureHeap::mask)
+    {
+      commons.print_used_memory(initial_memory, final_memory, label);
+    }
+    if (probes & MeasureCycles::mask)
+    {
+      commons.print_total_cycles(start, end, label);
+    }
+  }
+
+private:
+  static constexpr unsigned int probes = (0u | ... | Probes::mask);
+
+  CryptoApiCommons &commons;
+  const char *label;
+  bool running;
+  Timestamp start;
+  unsigned long initial_memory;
+};
+
+#else
+
+// Instrumentation is disabled in menuconfig: no probes, no logging.
+template <typename... Probes>
+class ScopedMeasure
+{
+public:
+  ScopedMeasure(CryptoApiCommons &, const char *) {}
+  void stop() {}
+};
+
+#endif
+
+#endif
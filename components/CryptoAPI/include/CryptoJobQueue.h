@@ -0,0 +1,105 @@
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "CryptoAPI.h"
+
+#ifndef CRYPTO_JOB_QUEUE
+#define CRYPTO_JOB_QUEUE
+
+#ifdef CONFIG_CRYPTO_API_JOB_QUEUE_LENGTH
+#define CRYPTO_API_JOB_QUEUE_LENGTH CONFIG_CRYPTO_API_JOB_QUEUE_LENGTH
+#else
+#define CRYPTO_API_JOB_QUEUE_LENGTH 8
+#endif
+
+#ifdef CONFIG_CRYPTO_API_JOB_WORKER_CORE
+#define CRYPTO_API_JOB_WORKER_CORE CONFIG_CRYPTO_API_JOB_WORKER_CORE
+#else
+#define CRYPTO_API_JOB_WORKER_CORE 0
+#endif
+
+#ifdef CONFIG_CRYPTO_API_JOB_WORKER_PRIORITY
+#define CRYPTO_API_JOB_WORKER_PRIORITY CONFIG_CRYPTO_API_JOB_WORKER_PRIORITY
+#else
+#define CRYPTO_API_JOB_WORKER_PRIORITY 5
+#endif
+
+#ifdef CONFIG_CRYPTO_API_JOB_WORKER_STACK_SIZE
+#define CRYPTO_API_JOB_WORKER_STACK_SIZE CONFIG_CRYPTO_API_JOB_WORKER_STACK_SIZE
+#else
+#define CRYPTO_API_JOB_WORKER_STACK_SIZE 8192
+#endif
+
+enum CryptoJobType
+{
+  CRYPTO_JOB_SIGN,
+  CRYPTO_JOB_VERIFY
+};
+
+struct CryptoJob;
+
+// Runs on the worker task once the job has finished. status is what sign() or
+// verify() returned.
+typedef void (*CryptoJobCallback)(CryptoJob *job, int status, void *user_data);
+
+// One queued sign or verify call. The buffers belong to the caller and must
+// stay valid until the job has completed.
+struct CryptoJob
+{
+  CryptoJobType type;
+  const unsigned char *message;
+  size_t message_length;
+  unsigned char *signature;
+  size_t signature_length;
+  size_t *signature_length_out;
+  CryptoJobCallback callback;
+  void *user_data;
+  int status;
+  SemaphoreHandle_t done;
+};
+
+// Asynchronous front end to a CryptoAPI. submit_sign/submit_verify only take
+// a job from a fixed pool and queue it, so they return in microseconds; one
+// worker task, pinned to CRYPTO_API_JOB_WORKER_CORE, runs the jobs in order.
+//
+// A job submitted with a callback is recycled as soon as the callback returns.
+// Any other job is collected with poll() or wait(), which also recycle it.
+class CryptoJobQueue
+{
+public:
+  CryptoJobQueue(CryptoAPI &crypto_api);
+  ~CryptoJobQueue();
+
+  int init();
+  // Runs the jobs already queued, then stops the worker.
+  void close();
+
+  // Return NULL if all CRYPTO_API_JOB_QUEUE_LENGTH jobs are in use.
+  CryptoJob *submit_sign(const unsigned char *message, size_t message_length, unsigned char *signature, size_t *signature_length, CryptoJobCallback callback = NULL, void *user_data = NULL);
+  CryptoJob *submit_verify(const unsigned char *message, size_t message_length, unsigned char *signature, size_t signature_length, CryptoJobCallback callback = NULL, void *user_data = NULL);
+
+  // Returns true and stores the job's status if it has completed.
+  bool poll(CryptoJob *job, int *status);
+  // Blocks until the job completes and returns its status, or returns
+  // ESP_ERR_TIMEOUT (the job stays queued) after ticks_to_wait.
+  int wait(CryptoJob *job, TickType_t ticks_to_wait = portMAX_DELAY);
+
+private:
+  CryptoAPI &crypto_api;
+  CryptoJob jobs[CRYPTO_API_JOB_QUEUE_LENGTH];
+  QueueHandle_t free_jobs;
+  QueueHandle_t pending_jobs;
+  SemaphoreHandle_t stopped;
+  bool running;
+
+  CryptoJob *take_free_job();
+  CryptoJob *submit(CryptoJob *job);
+  void release(CryptoJob *job);
+
+  static void worker_task(void *arg);
+  void worker();
+};
+
+#endif
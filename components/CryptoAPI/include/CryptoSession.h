@@ -0,0 +1,49 @@
+#include "CryptoAPI.h"
+
+#ifndef CRYPTO_SESSION
+#define CRYPTO_SESSION
+
+#define CRYPTO_SESSION_RSA_KEY_SIZE 2048
+#define CRYPTO_SESSION_RSA_EXPONENT 65537
+
+// Long-lived use of a CryptoAPI. The first open() of a library pays for
+// LittleFS, the library context (mbedTLS DRBG seed, wolfCrypt_Init and RNG)
+// and key generation. Later opens redo only what changed:
+//
+//   same library, algorithm and key size   nothing; the keys stay resident
+//   different hash or SHAKE256 length      only the hash choice
+//   different algorithm or RSA key size    new key object and keys
+//
+// Each library keeps its own keys, so switching between libraries is warm
+// too. close() tears everything down.
+class CryptoSession
+{
+public:
+  CryptoSession(CryptoAPI &crypto_api);
+  ~CryptoSession();
+
+  int open(Libraries library, Algorithms algorithm, Hashes hash, size_t length_of_shake256, unsigned int rsa_key_size = CRYPTO_SESSION_RSA_KEY_SIZE, int rsa_exponent = CRYPTO_SESSION_RSA_EXPONENT);
+  void close();
+
+  // Number of open() calls that reused resident keys / had to build them.
+  unsigned long get_warm_opens();
+  unsigned long get_cold_opens();
+
+private:
+  struct ResidentKeys
+  {
+    bool initialized;
+    bool ready;
+    Algorithms algorithm;
+    Hashes hash;
+    size_t length_of_shake256;
+    unsigned int rsa_key_size;
+  };
+
+  CryptoAPI &crypto_api;
+  ResidentKeys resident[MICROECC_LIB + 1];
+  unsigned long warm_opens;
+  unsigned long cold_opens;
+};
+
+#endif
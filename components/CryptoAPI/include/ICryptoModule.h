@@ -15,9 +15,27 @@ public:
   virtual int gen_keys() = 0;
 
   virtual int sign(const unsigned char *message, size_t message_length, unsigned char *signature, size_t *signature_length) = 0;
+  // Signs `count` messages with the current key. signature_lengths holds each
+  // buffer's capacity on entry and the signature length on return.
+  virtual int sign_batch(const unsigned char *const *messages, const size_t *message_lengths, size_t count, unsigned char *const *signatures, size_t *signature_lengths) = 0;
   virtual int verify(const unsigned char *message, size_t message_length, unsigned char *signature, size_t signature_length) = 0;
   virtual void close() = 0;
 
+  // Streaming sign/verify: the message is fed in pieces of any size, so it
+  // never has to sit in RAM as a whole. Each *_final ends the stream.
+  virtual int sign_init() = 0;
+  virtual int sign_update(const unsigned char *data, size_t data_length) = 0;
+  virtual int sign_final(unsigned char *signature, size_t *signature_length) = 0;
+  virtual int verify_init() = 0;
+  virtual int verify_update(const unsigned char *data, size_t data_length) = 0;
+  virtual int verify_final(unsigned char *signature, size_t signature_length) = 0;
+
+  // The two halves of sign(). hash_message leaves the signing state alone, so
+  // one task may hash the next message while another signs this one.
+  virtual size_t get_digest_length() = 0;
+  virtual int hash_message(const unsigned char *message, size_t message_length, unsigned char *hash) = 0;
+  virtual int sign_hash(const unsigned char *hash, size_t hash_length, unsigned char *signature, size_t *signature_length) = 0;
+
   virtual size_t get_public_key_size() = 0;
   virtual size_t get_public_key_pem_size() = 0;
   virtual int get_public_key_pem(unsigned char *public_key_pem) = 0;
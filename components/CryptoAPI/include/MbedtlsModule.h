@@ -6,9 +6,20 @@
 #include <mbedtls/entropy.h>
 #include <mbedtls/ctr_drbg.h>
 #include <mbedtls/pk.h>
+#include <mbedtls/sha256.h>
+#include <mbedtls/sha512.h>
+#include <mbedtls/sha3.h>
 #include <string>
 
-class MbedtlsModule : public ICryptoModule
+// State of one message being hashed in pieces; which member is live depends on the chosen hash
+union MbedtlsHashContext
+{
+  mbedtls_sha256_context sha256;
+  mbedtls_sha512_context sha512;
+  mbedtls_sha3_context sha3;
+};
+
+class MbedtlsModule final : public ICryptoModule
 {
 public:
   MbedtlsModule(CryptoApiCommons &commons);
@@ -20,10 +31,24 @@ public:
   int gen_keys();
 
   int sign(const unsigned char *message, size_t message_length, unsigned char *signature, size_t *signature_length);
+  int sign_batch(const unsigned char *const *messages, const size_t *message_lengths, size_t count, unsigned char *const *signatures, size_t *signature_lengths);
   int verify(const unsigned char *message, size_t message_length, unsigned char *signature, size_t signature_length);
   void close();
 
+  int sign_init();
+  int sign_update(const unsigned char *data, size_t data_length);
+  int sign_final(unsigned char *signature, size_t *signature_length);
+  int verify_init();
+  int verify_update(const unsigned char *data, size_t data_length);
+  int verify_final(unsigned char *signature, size_t signature_length);
+
+  size_t get_digest_length();
   int hash_message(const unsigned char *message, size_t message_length, unsigned char *hash);
+  int sign_hash(const unsigned char *hash, size_t hash_length, unsigned char *signature, size_t *signature_length);
+
+  int hash_starts(MbedtlsHashContext *ctx);
+  int hash_update(MbedtlsHashContext *ctx, const unsigned char *data, size_t data_length);
+  int hash_finish(MbedtlsHashContext *ctx, unsigned char *hash);
   int base64_encode(unsigned char *dst, size_t dlen, size_t *olen, const unsigned char *src, size_t slen);
 
   size_t get_public_key_size();
@@ -45,9 +70,12 @@ private:
   mbedtls_ctr_drbg_context ctr_drbg;
   static const int ecdsa_sig_max_len = MBEDTLS_ECDSA_MAX_LEN;
   unsigned int rsa_key_size;
+  MbedtlsHashContext stream_ctx;
+  bool context_ready;
 
   mbedtls_md_type_t get_hash_type();
   mbedtls_ecp_group_id get_ecc_group_id();
+  int verify_hash(const unsigned char *hash, size_t hash_length, const unsigned char *signature, size_t signature_length);
 };
 
 #endif
\ No newline at end of file
@@ -3,14 +3,14 @@
 
 #include "ICryptoModule.h"
 #include "CryptoApiCommons.h"
+#include "MbedtlsModule.h"
+#include "VerifyKeyCache.h"
 #include "uECC.h"
 
 #define MY_ECC_256_PRIVATE_KEY_SIZE 32
 #define MY_ECC_256_PUBLIC_KEY_SIZE 64
 
-class MbedtlsModule;
-
-class MicroeccModule : public ICryptoModule
+class MicroeccModule final : public ICryptoModule
 {
 public:
   MicroeccModule(CryptoApiCommons &commons, MbedtlsModule &mbedtls_module);
@@ -22,15 +22,49 @@ public:
   int gen_keys();
 
   int sign(const unsigned char *message, size_t message_length, unsigned char *signature, size_t *_);
+  int sign_batch(const unsigned char *const *messages, const size_t *message_lengths, size_t count, unsigned char *const *signatures, size_t *signature_lengths);
   int verify(const unsigned char *message, size_t message_length, unsigned char *signature, size_t _);
   void close();
 
+  int sign_init();
+  int sign_update(const unsigned char *data, size_t data_length);
+  int sign_final(unsigned char *signature, size_t *signature_length);
+  int verify_init();
+  int verify_update(const unsigned char *data, size_t data_length);
+  int verify_final(unsigned char *signature, size_t signature_length);
+
+  size_t get_digest_length();
+  int hash_message(const unsigned char *message, size_t message_length, unsigned char *hash);
+  int sign_hash(const unsigned char *hash, size_t hash_length, unsigned char *signature, size_t *_);
+
+  // Verifies `count` secp256r1 signatures over precomputed digests. Keys,
+  // digests and signatures are each packed back to back in their own array;
+  // results (optional) gets 1 or 0 per signature. Returns 0 if all are valid.
+  int verify_batch(const unsigned char *public_keys, const unsigned char *digests, size_t digest_length, const unsigned char *signatures, size_t count, unsigned char *results);
+
+  // Verifies a signature over `message` made with `public_key` (64 bytes,
+  // X then Y) instead of this module's own key. The multiples of the key that
+  // verification needs are computed once and kept in a VerifyKeyCache of
+  // CONFIG_CRYPTO_API_KEY_CACHE_BYTES, so later signatures from the same key
+  // skip that work. Invalid keys are refused and not cached.
+  int verify_with_key(const unsigned char *public_key, const unsigned char *message, size_t message_length, const unsigned char *signature);
+  // The cache outlives close(), since its keys are not this module's
+  KeyCacheStats get_key_cache_stats();
+  void clear_key_cache();
+
   size_t get_public_key_size();
   size_t get_public_key_pem_size();
   int get_public_key_pem(unsigned char *public_key_pem);
 
   size_t get_private_key_size();
 
+#if uECC_ENABLE_OP_COUNTERS
+  // Field operations of the last micro-ecc call: the uECC_make_key(),
+  // uECC_sign(), uECC_verify() or uECC_verify_batch() of the last
+  // gen_keys(), sign_hash(), verify_hash() or verify_batch()
+  uECC_OpCounters get_last_op_counters();
+#endif
+
   void save_private_key(const char *file_path, unsigned char *private_key, size_t _);
   void save_public_key(const char *file_path, unsigned char *public_key, size_t _);
   void save_signature(const char *file_path, const unsigned char *signature, size_t sig_len);
@@ -42,9 +76,19 @@ private:
   MbedtlsModule &mbedtls_module;
   unsigned char *private_key;
   unsigned char *public_key;
+  MbedtlsHashContext stream_ctx;
+  VerifyKeyCache key_cache;
+#if uECC_ENABLE_OP_COUNTERS
+  uECC_OpCounters last_op_counters;
+#endif
   static int rng_function(unsigned char *dest, unsigned int size);
   int public_key_to_pem_format(unsigned char *public_key_buffer);
   int private_key_to_pem_format(unsigned char *private_key_buffer);
+  int verify_hash(const unsigned char *hash, size_t hash_length, const unsigned char *signature);
+  int verify_hash_with_key(const unsigned char *public_key, const unsigned char *hash, size_t hash_length, const unsigned char *signature);
+  void start_op_count();
+  void stop_op_count();
+  void log_op_counters(const char *label);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,66 @@
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "CryptoApiCommons.h"
+#include "ICryptoModule.h"
+
+#ifndef SIGN_PIPELINE
+#define SIGN_PIPELINE
+
+#ifdef CONFIG_CRYPTO_API_PIPELINE_DEPTH
+#define CRYPTO_API_PIPELINE_DEPTH CONFIG_CRYPTO_API_PIPELINE_DEPTH
+#else
+#define CRYPTO_API_PIPELINE_DEPTH 4
+#endif
+
+#ifdef CONFIG_CRYPTO_API_PIPELINE_HASH_CORE
+#define CRYPTO_API_PIPELINE_HASH_CORE CONFIG_CRYPTO_API_PIPELINE_HASH_CORE
+#else
+#define CRYPTO_API_PIPELINE_HASH_CORE 0
+#endif
+
+#ifdef CONFIG_CRYPTO_API_PIPELINE_HASH_STACK_SIZE
+#define CRYPTO_API_PIPELINE_HASH_STACK_SIZE CONFIG_CRYPTO_API_PIPELINE_HASH_STACK_SIZE
+#else
+#define CRYPTO_API_PIPELINE_HASH_STACK_SIZE 4096
+#endif
+
+// Signs a run of messages in two stages. A hash task hashes message N+1 into
+// one of CRYPTO_API_PIPELINE_DEPTH digest slots while the calling task signs
+// message N. Full slots travel to the signer on one queue and come back empty
+// on another, so the hash task never gets more than DEPTH messages ahead.
+class SignPipeline
+{
+public:
+  SignPipeline(CryptoApiCommons &commons, ICryptoModule &module);
+
+  int run(const unsigned char *const *messages, const size_t *message_lengths, size_t count, unsigned char *const *signatures, size_t *signature_lengths);
+
+private:
+  // A digest ready to sign, or (slot < 0) the end of the run with the status
+  // of the hash stage.
+  struct PipelineItem
+  {
+    size_t index;
+    int slot;
+    int status;
+  };
+
+  CryptoApiCommons &commons;
+  ICryptoModule &module;
+  const unsigned char *const *messages;
+  const size_t *message_lengths;
+  size_t count;
+  unsigned char *digests;
+  size_t digest_length;
+  QueueHandle_t free_slots;
+  QueueHandle_t ready_slots;
+  volatile bool aborted;
+
+  static void hash_task(void *arg);
+  void hash_stage();
+  int sign_stage(unsigned char *const *signatures, size_t *signature_lengths);
+};
+
+#endif
@@ -0,0 +1,87 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "CryptoApiCommons.h"
+
+#ifndef SPAN_TRACE
+#define SPAN_TRACE
+
+#ifdef CONFIG_CRYPTO_API_SPAN_TRACE
+#define CRYPTO_API_SPAN_TRACE 1
+#else
+#define CRYPTO_API_SPAN_TRACE 0
+#endif
+
+#ifdef CONFIG_CRYPTO_API_SPAN_TRACE_EVENTS
+#define CRYPTO_API_SPAN_TRACE_EVENTS CONFIG_CRYPTO_API_SPAN_TRACE_EVENTS
+#else
+#define CRYPTO_API_SPAN_TRACE_EVENTS 512
+#endif
+
+// One finished phase. name and category must be string literals.
+struct Span
+{
+  const char *name;
+  const char *category;
+  int64_t start_us;
+  uint64_t duration_ns;
+  uint32_t task_id;
+  uint8_t core;
+  char task[configMAX_TASK_NAME_LEN];
+};
+
+// Keeps the last CRYPTO_API_SPAN_TRACE_EVENTS spans in a ring and writes
+// them as Chrome trace-event JSON, which Perfetto (ui.perfetto.dev) and
+// chrome://tracing open as a timeline with one process per core and one
+// thread per task. record() only claims a slot with an atomic increment, so
+// spans from any task can be recorded at once; export while no operation is
+// running, or the spans being written may come out torn.
+class SpanTrace
+{
+public:
+  static void record(const char *name, const char *category, int64_t start_us, uint64_t duration_ns);
+  static void clear();
+  static size_t size();
+
+  // Writes {"traceEvents":[...]} with one complete ("X") event per span,
+  // plus process and thread name metadata. Returns 0, or -1 on a write error.
+  static int export_json(FILE *out);
+};
+
+#if CRYPTO_API_SPAN_TRACE
+
+// Records the time from its construction to the end of the scope as a span
+class ScopedSpan
+{
+public:
+  ScopedSpan(const char *name, const char *category) : name(name), category(category), start(CryptoApiCommons::get_timestamp()) {}
+
+  ~ScopedSpan()
+  {
+    Timestamp end = CryptoApiCommons::get_timestamp();
+    SpanTrace::record(name, category, start.time_us, CryptoApiCommons::elapsed_ns(start, end));
+  }
+
+  ScopedSpan(const ScopedSpan &) = delete;
+  ScopedSpan &operator=(const ScopedSpan &) = delete;
+
+private:
+  const char *name;
+  const char *category;
+  Timestamp start;
+};
+
+#else
+
+// Span tracing is disabled in menuconfig
+class ScopedSpan
+{
+public:
+  ScopedSpan(const char *, const char *) {}
+};
+
+#endif
+
+#endif
@@ -0,0 +1,44 @@
+#include <stddef.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#ifndef STACK_PROFILER
+#define STACK_PROFILER
+
+#ifdef CONFIG_CRYPTO_API_STACK_PROFILE_SIZE
+#define CRYPTO_API_STACK_PROFILE_SIZE CONFIG_CRYPTO_API_STACK_PROFILE_SIZE
+#else
+#define CRYPTO_API_STACK_PROFILE_SIZE 16384
+#endif
+
+// The operation to profile. Runs on the profiling task; returns 0 on success.
+typedef int (*StackProfiledOperation)(void *user_data);
+
+// Measures how much stack an operation needs by running it on a fresh task
+// whose stack FreeRTOS has filled with a known pattern, then reading
+// uxTaskGetStackHighWaterMark() before the task ends. The figure includes the
+// few hundred bytes of the task entry itself, so it can be used directly as a
+// task stack size plus whatever margin the caller wants.
+//
+// The calling task blocks until the operation is done. The profiling task
+// gets the caller's priority and is not pinned to a core.
+class StackProfiler
+{
+public:
+  StackProfiler(uint32_t stack_size = CRYPTO_API_STACK_PROFILE_SIZE);
+
+  // Stores the deepest stack use of `operation` in bytes in *used_bytes.
+  // Returns what the operation returned, or -1 if the task could not be
+  // created.
+  int run(const char *label, StackProfiledOperation operation, void *user_data, uint32_t *used_bytes);
+
+private:
+  uint32_t stack_size;
+
+  static void profile_task(void *parameters);
+};
+
+#endif
@@ -0,0 +1,72 @@
+#include <stddef.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+
+#ifndef TRACE_LOG
+#define TRACE_LOG
+
+#ifdef CONFIG_CRYPTO_API_DEFERRED_LOG
+#define CRYPTO_API_DEFERRED_LOG 1
+#else
+#define CRYPTO_API_DEFERRED_LOG 0
+#endif
+
+#ifdef CONFIG_CRYPTO_API_TRACE_LOG_EVENTS
+#define CRYPTO_API_TRACE_LOG_EVENTS CONFIG_CRYPTO_API_TRACE_LOG_EVENTS
+#else
+#define CRYPTO_API_TRACE_LOG_EVENTS 128
+#endif
+
+#ifdef CONFIG_CRYPTO_API_TRACE_DRAIN_PRIORITY
+#define CRYPTO_API_TRACE_DRAIN_PRIORITY CONFIG_CRYPTO_API_TRACE_DRAIN_PRIORITY
+#else
+#define CRYPTO_API_TRACE_DRAIN_PRIORITY 1
+#endif
+
+static_assert((CRYPTO_API_TRACE_LOG_EVENTS & (CRYPTO_API_TRACE_LOG_EVENTS - 1)) == 0,
+              "CONFIG_CRYPTO_API_TRACE_LOG_EVENTS must be a power of two");
+
+enum TraceEventType
+{
+  TRACE_SUCCESS,
+  TRACE_ELAPSED_NS,
+  TRACE_MEMORY_BYTES,
+  TRACE_CYCLES
+};
+
+// One deferred log line. label must outlive the drain, which string literals
+// (all the labels the modules use) do.
+struct TraceEvent
+{
+  uint64_t value;
+  const char *label;
+  uint8_t type;
+};
+
+// Fixed-size ring of binary events that hot paths write instead of calling
+// ESP_LOGx, so a measured operation never waits on the UART. write() takes no
+// lock and never blocks: it claims a slot with a compare-and-swap and, when
+// the ring is full, drops the event and counts it. Events are formatted and
+// logged by drain(), from the drain task or at the end of a run.
+class TraceLog
+{
+public:
+  static bool write(TraceEventType type, const char *label, uint64_t value);
+
+  // Logs every event written so far, oldest first, and returns how many.
+  // Safe to call from several tasks; each event is logged once.
+  static size_t drain();
+
+  // Starts a task at CRYPTO_API_TRACE_DRAIN_PRIORITY, not pinned to a core,
+  // that drains the ring periodically. Calling it again does nothing.
+  static int start_drain_task();
+
+  // Events lost to a full ring since the last drain()
+  static unsigned long get_dropped();
+
+private:
+  static void drain_task(void *parameters);
+  static void print_event(const TraceEvent &event);
+};
+
+#endif
@@ -0,0 +1,69 @@
+#include <stddef.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+
+#ifndef VERIFY_KEY_CACHE
+#define VERIFY_KEY_CACHE
+
+#ifdef CONFIG_CRYPTO_API_KEY_CACHE_BYTES
+#define CRYPTO_API_KEY_CACHE_BYTES CONFIG_CRYPTO_API_KEY_CACHE_BYTES
+#else
+#define CRYPTO_API_KEY_CACHE_BYTES 32768
+#endif
+
+// capacity is how many keys fit in the budget; hits and misses count the
+// lookups, evictions the entries dropped to make room for a new key
+struct KeyCacheStats
+{
+  size_t capacity;
+  size_t entries;
+  unsigned long hits;
+  unsigned long misses;
+  unsigned long evictions;
+};
+
+// Bounded map from public keys to what a backend precomputed for verifying
+// against them. Once `budget` bytes (keys, values and bookkeeping) are in use,
+// each new key replaces the least recently used one. The storage is allocated
+// on the first insert(), so an image that never verifies against a given key
+// pays nothing. Not thread-safe, like the module that owns it.
+class VerifyKeyCache
+{
+public:
+  VerifyKeyCache(size_t key_size, size_t value_size, size_t budget);
+  ~VerifyKeyCache();
+
+  // The value of `key`, which becomes the most recently used; NULL if the
+  // key is not cached
+  unsigned char *find(const unsigned char *key);
+  // Room for the value of `key`, which must not be cached yet, evicting the
+  // least recently used key when full. Values lie value_size apart from the
+  // start of one malloc() block. NULL when the budget holds no entry.
+  unsigned char *insert(const unsigned char *key);
+  // Forgets `key`, e.g. when its value could not be computed
+  void remove(const unsigned char *key);
+  void clear();
+
+  KeyCacheStats get_stats();
+
+private:
+  struct Entry
+  {
+    uint64_t last_used; // 0 for a free slot
+    uint32_t hash;
+  };
+
+  size_t key_size;
+  size_t value_size;
+  size_t capacity;
+  unsigned char *values;
+  unsigned char *keys;
+  Entry *entries;
+  uint64_t clock;
+  KeyCacheStats stats;
+
+  uint32_t hash_key(const unsigned char *key);
+  size_t index_of(const unsigned char *key, uint32_t hash);
+};
+
+#endif
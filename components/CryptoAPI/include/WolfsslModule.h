@@ -8,13 +8,24 @@
 #include <wolfssl/wolfcrypt/ecc.h>
 #include <wolfssl/wolfcrypt/ed448.h>
 #include <wolfssl/wolfcrypt/asn_public.h>
+#include <wolfssl/wolfcrypt/sha256.h>
+#include <wolfssl/wolfcrypt/sha512.h>
+#include <wolfssl/wolfcrypt/sha3.h>
 #include "CryptoApiCommons.h"
 #include "ICryptoModule.h"
 
 #define MY_ED25519_KEY_SIZE 32
 #define MY_ED448_KEY_SIZE 57
 
-class WolfsslModule : public ICryptoModule
+// State of one message being hashed in pieces; SHAKE256 shares the SHA-3 state
+union WolfsslHashContext
+{
+  wc_Sha256 sha256;
+  wc_Sha512 sha512;
+  wc_Sha3 sha3;
+};
+
+class WolfsslModule final : public ICryptoModule
 {
 public:
   WolfsslModule(CryptoApiCommons &commons);
@@ -26,10 +37,20 @@ public:
   int gen_keys();
 
   int sign(const unsigned char *message, size_t message_length, unsigned char *signature, size_t *signature_length);
+  int sign_batch(const unsigned char *const *messages, const size_t *message_lengths, size_t count, unsigned char *const *signatures, size_t *signature_lengths);
   int verify(const unsigned char *message, size_t message_length, unsigned char *signature, size_t signature_length);
   void close();
 
+  int sign_init();
+  int sign_update(const unsigned char *data, size_t data_length);
+  int sign_final(unsigned char *signature, size_t *signature_length);
+  int verify_init();
+  int verify_update(const unsigned char *data, size_t data_length);
+  int verify_final(unsigned char *signature, size_t signature_length);
+
+  size_t get_digest_length();
   int hash_message(const unsigned char *message, size_t message_length, unsigned char *hash);
+  int sign_hash(const unsigned char *hash, size_t hash_length, unsigned char *signature, size_t *signature_length);
 
   size_t get_public_key_size();
   size_t get_public_key_pem_size();
@@ -53,11 +74,17 @@ private:
   ecc_key *wolf_ecc_key;
   ed448_key *wolf_ed448_key;
   unsigned int rsa_key_size;
+  WolfsslHashContext stream_ctx;
 
   int get_key_size(int curve_id);
   int get_ecc_curve_id();
   size_t get_public_key_der_size();
   size_t get_private_key_der_size();
+  int verify_hash(const unsigned char *hash, size_t hash_length, const unsigned char *signature, size_t signature_length);
+  void free_keys();
+  int hash_starts();
+  int hash_update(const unsigned char *data, size_t data_length);
+  int hash_finish(unsigned char *hash);
 };
 
 #endif
\ No newline at end of file
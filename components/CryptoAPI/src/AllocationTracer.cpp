@@ -0,0 +1,173 @@
+#include "AllocationTracer.h"
+#include "CryptoAPI.h"
+
+#if CRYPTO_API_ALLOC_TRACE
+
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_heap_caps.h"
+
+#ifndef CONFIG_HEAP_USE_HOOKS
+#if CRYPTO_API_WITH_MBEDTLS || CRYPTO_API_WITH_MICROECC
+#include "mbedtls/platform.h"
+#endif
+#if CRYPTO_API_WITH_WOLFSSL
+#include "wolfssl/wolfcrypt/settings.h"
+#include "wolfssl/wolfcrypt/memory.h"
+#endif
+#endif
+
+struct TracedAllocation
+{
+  void *ptr;
+  uint32_t size;
+};
+
+// Allocations made since start() and not freed yet. Frees of anything else
+// are counted but do not change the byte figures.
+static TracedAllocation live[CRYPTO_API_ALLOC_TRACE_SLOTS];
+static size_t live_count = 0;
+static AllocationStats current;
+static uint32_t current_bytes = 0;
+static volatile bool tracing = false;
+static portMUX_TYPE trace_mux = portMUX_INITIALIZER_UNLOCKED;
+
+void AllocationTracer::on_alloc(void *ptr, size_t size)
+{
+  if (!tracing || ptr == NULL)
+  {
+    return;
+  }
+
+  portENTER_CRITICAL(&trace_mux);
+  current.allocations++;
+  if (live_count < CRYPTO_API_ALLOC_TRACE_SLOTS)
+  {
+    live[live_count].ptr = ptr;
+    live[live_count].size = size;
+    live_count++;
+    current_bytes += size;
+    if (current_bytes > current.peak_bytes)
+    {
+      current.peak_bytes = current_bytes;
+    }
+  }
+  else
+  {
+    current.untracked++;
+  }
+  portEXIT_CRITICAL(&trace_mux);
+}
+
+void AllocationTracer::on_free(void *ptr)
+{
+  if (!tracing || ptr == NULL)
+  {
+    return;
+  }
+
+  portENTER_CRITICAL(&trace_mux);
+  current.frees++;
+  for (size_t i = 0; i < live_count; i++)
+  {
+    if (live[i].ptr == ptr)
+    {
+      current_bytes -= live[i].size;
+      live[i] = live[--live_count];
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&trace_mux);
+}
+
+#ifdef CONFIG_HEAP_USE_HOOKS
+
+extern "C" void esp_heap_trace_alloc_hook(void *ptr, size_t size, uint32_t)
+{
+  AllocationTracer::on_alloc(ptr, size);
+}
+
+extern "C" void esp_heap_trace_free_hook(void *ptr)
+{
+  AllocationTracer::on_free(ptr);
+}
+
+static void install_library_allocators() {}
+
+#else
+
+// Without heap hooks, the libraries' own allocator callbacks are the only
+// place allocations can be seen. They forward to the C allocator, as both
+// libraries do by default.
+static void *traced_malloc(size_t size)
+{
+  void *ptr = malloc(size);
+  AllocationTracer::on_alloc(ptr, size);
+  return ptr;
+}
+
+static void *traced_calloc(size_t count, size_t size)
+{
+  void *ptr = calloc(count, size);
+  AllocationTracer::on_alloc(ptr, count * size);
+  return ptr;
+}
+
+static void *traced_realloc(void *ptr, size_t size)
+{
+  void *new_ptr = realloc(ptr, size);
+  if (new_ptr != NULL || size == 0)
+  {
+    AllocationTracer::on_free(ptr);
+    AllocationTracer::on_alloc(new_ptr, size);
+  }
+  return new_ptr;
+}
+
+static void traced_free(void *ptr)
+{
+  AllocationTracer::on_free(ptr);
+  free(ptr);
+}
+
+static void install_library_allocators()
+{
+  static bool installed = false;
+  if (installed)
+  {
+    return;
+  }
+  installed = true;
+
+#if (CRYPTO_API_WITH_MBEDTLS || CRYPTO_API_WITH_MICROECC) && defined(MBEDTLS_PLATFORM_MEMORY) && !defined(MBEDTLS_PLATFORM_CALLOC_MACRO)
+  mbedtls_platform_set_calloc_free(traced_calloc, traced_free);
+#endif
+#if CRYPTO_API_WITH_WOLFSSL && defined(USE_WOLFSSL_MEMORY) && !defined(WOLFSSL_STATIC_MEMORY) && !defined(WOLFSSL_DEBUG_MEMORY)
+  wolfSSL_SetAllocators(traced_malloc, traced_free, traced_realloc);
+#endif
+}
+
+#endif
+
+void AllocationTracer::start()
+{
+  install_library_allocators();
+
+  portENTER_CRITICAL(&trace_mux);
+  current = {};
+  current_bytes = 0;
+  live_count = 0;
+  tracing = true;
+  portEXIT_CRITICAL(&trace_mux);
+}
+
+void AllocationTracer::stop(AllocationStats *stats)
+{
+  portENTER_CRITICAL(&trace_mux);
+  tracing = false;
+  current.leaked_bytes = current_bytes;
+  *stats = current;
+  portEXIT_CRITICAL(&trace_mux);
+}
+
+#endif
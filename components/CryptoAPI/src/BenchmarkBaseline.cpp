@@ -0,0 +1,236 @@
+#include "BenchmarkBaseline.h"
+#include "esp_log.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "BenchmarkBaseline";
+
+#define BASELINE_HEADER "library,algorithm,hash,operation,samples,median_ns,mean_ns,stddev_ns"
+#define BASELINE_LINE_MAX 160
+
+static void copy_name(char *destination, const char *source, size_t size)
+{
+  strncpy(destination, source, size - 1);
+  destination[size - 1] = '\0';
+}
+
+static bool same_operation(const BaselineEntry &a, const BaselineEntry &b)
+{
+  return strcmp(a.library, b.library) == 0 && strcmp(a.algorithm, b.algorithm) == 0 &&
+         strcmp(a.hash, b.hash) == 0 && strcmp(a.operation, b.operation) == 0;
+}
+
+// Welch's t-test on the two means at 95%. Needs two samples on each side.
+static bool significant_difference(const BaselineEntry &a, const BaselineEntry &b)
+{
+  if (a.samples < 2 || b.samples < 2)
+  {
+    return false;
+  }
+
+  double variance_a = a.stddev_ns * a.stddev_ns / a.samples;
+  double variance_b = b.stddev_ns * b.stddev_ns / b.samples;
+  double variance = variance_a + variance_b;
+  if (variance == 0)
+  {
+    return a.mean_ns != b.mean_ns;
+  }
+
+  double t = fabs(a.mean_ns - b.mean_ns) / sqrt(variance);
+  double degrees = variance * variance /
+                   (variance_a * variance_a / (a.samples - 1) + variance_b * variance_b / (b.samples - 1));
+  return t > BenchmarkRunner::t_critical_95(degrees);
+}
+
+static void print_row(FILE *out, const BaselineEntry &entry, const char *baseline, const char *current, const char *change, const char *verdict)
+{
+  fprintf(out, "%-9s %-10s %-9s %-8s %12s %12s %9s  %s\n",
+          entry.library, entry.algorithm, entry.hash, entry.operation, baseline, current, change, verdict);
+}
+
+BenchmarkBaseline::BenchmarkBaseline() : entries(NULL), count(0), capacity(0) {}
+
+BenchmarkBaseline::~BenchmarkBaseline()
+{
+  free(entries);
+}
+
+int BenchmarkBaseline::append(const BaselineEntry &entry)
+{
+  if (count == capacity)
+  {
+    size_t new_capacity = capacity == 0 ? 16 : capacity * 2;
+    BaselineEntry *grown = (BaselineEntry *)realloc(entries, new_capacity * sizeof(BaselineEntry));
+    if (grown == NULL)
+    {
+      ESP_LOGE(TAG, "> Could not allocate %u baseline entries.", (unsigned)new_capacity);
+      return -1;
+    }
+    entries = grown;
+    capacity = new_capacity;
+  }
+  entries[count++] = entry;
+  return 0;
+}
+
+int BenchmarkBaseline::add(int library, int algorithm, int hash, const char *operation, const BenchmarkStats &stats)
+{
+  BaselineEntry entry;
+  copy_name(entry.library, library_name(library), sizeof(entry.library));
+  copy_name(entry.algorithm, algorithm_name(algorithm), sizeof(entry.algorithm));
+  copy_name(entry.hash, hash_name(hash), sizeof(entry.hash));
+  copy_name(entry.operation, operation, sizeof(entry.operation));
+  entry.samples = stats.samples;
+  entry.median_ns = stats.median_ns;
+  entry.mean_ns = stats.mean_ns;
+  entry.stddev_ns = stats.stddev_ns;
+  return append(entry);
+}
+
+void BenchmarkBaseline::clear()
+{
+  count = 0;
+}
+
+size_t BenchmarkBaseline::size()
+{
+  return count;
+}
+
+const BaselineEntry &BenchmarkBaseline::at(size_t index)
+{
+  return entries[index];
+}
+
+const BaselineEntry *BenchmarkBaseline::find(const BaselineEntry &key)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    if (same_operation(entries[i], key))
+    {
+      return &entries[i];
+    }
+  }
+  return NULL;
+}
+
+int BenchmarkBaseline::save(const char *file_path)
+{
+  FILE *file = fopen(file_path, "w");
+  if (file == NULL)
+  {
+    ESP_LOGE(TAG, "> Could not open %s for writing.", file_path);
+    return -1;
+  }
+
+  fprintf(file, BASELINE_HEADER "\n");
+  for (size_t i = 0; i < count; i++)
+  {
+    const BaselineEntry &entry = entries[i];
+    fprintf(file, "%s,%s,%s,%s,%lu,%llu,%.1f,%.1f\n",
+            entry.library, entry.algorithm, entry.hash, entry.operation,
+            (unsigned long)entry.samples, (unsigned long long)entry.median_ns, entry.mean_ns, entry.stddev_ns);
+  }
+
+  int ret = ferror(file) ? -1 : 0;
+  fclose(file);
+  if (ret != 0)
+  {
+    ESP_LOGE(TAG, "> Failed to write %s.", file_path);
+  }
+  return ret;
+}
+
+int BenchmarkBaseline::load(const char *file_path)
+{
+  FILE *file = fopen(file_path, "r");
+  if (file == NULL)
+  {
+    ESP_LOGE(TAG, "> Could not open %s for reading.", file_path);
+    return -1;
+  }
+
+  clear();
+  char line[BASELINE_LINE_MAX];
+  if (fgets(line, sizeof(line), file) == NULL || strncmp(line, BASELINE_HEADER, strlen(BASELINE_HEADER)) != 0)
+  {
+    ESP_LOGE(TAG, "> %s is not a baseline file.", file_path);
+    fclose(file);
+    return -1;
+  }
+
+  int ret = 0;
+  for (int line_number = 2; ret == 0 && fgets(line, sizeof(line), file) != NULL; line_number++)
+  {
+    BaselineEntry entry;
+    unsigned long samples;
+    unsigned long long median_ns;
+    // Field widths are BASELINE_NAME_MAX - 1 and BENCHMARK_OPERATION_MAX - 1
+    if (sscanf(line, "%11[^,],%11[^,],%11[^,],%23[^,],%lu,%llu,%lf,%lf",
+               entry.library, entry.algorithm, entry.hash, entry.operation,
+               &samples, &median_ns, &entry.mean_ns, &entry.stddev_ns) != 8)
+    {
+      ESP_LOGE(TAG, "> %s:%d is not a valid baseline entry.", file_path, line_number);
+      ret = -1;
+      break;
+    }
+    entry.samples = samples;
+    entry.median_ns = median_ns;
+    ret = append(entry);
+  }
+
+  fclose(file);
+  return ret;
+}
+
+int BenchmarkBaseline::compare(BenchmarkBaseline &current, double threshold_percent, FILE *out)
+{
+  int regressions = 0;
+  char baseline_ms[16];
+  char current_ms[16];
+  char change[16];
+
+  fprintf(out, "%-9s %-10s %-9s %-8s %12s %12s %9s  %s\n",
+          "library", "algorithm", "hash", "op", "base mean ms", "now mean ms", "change", "verdict");
+
+  for (size_t i = 0; i < count; i++)
+  {
+    const BaselineEntry &base = entries[i];
+    const BaselineEntry *now = current.find(base);
+    snprintf(baseline_ms, sizeof(baseline_ms), "%.3f", base.mean_ns / 1e6);
+    if (now == NULL)
+    {
+      print_row(out, base, baseline_ms, "-", "-", "missing");
+      continue;
+    }
+
+    double percent = base.mean_ns > 0 ? (now->mean_ns - base.mean_ns) * 100 / base.mean_ns : 0;
+    const char *verdict = "unchanged";
+    if (significant_difference(base, *now) && percent > threshold_percent)
+    {
+      verdict = "REGRESSION";
+      regressions++;
+    }
+    else if (significant_difference(base, *now) && percent < -threshold_percent)
+    {
+      verdict = "improvement";
+    }
+
+    snprintf(current_ms, sizeof(current_ms), "%.3f", now->mean_ns / 1e6);
+    snprintf(change, sizeof(change), "%+.1f%%", percent);
+    print_row(out, base, baseline_ms, current_ms, change, verdict);
+  }
+
+  for (size_t i = 0; i < current.count; i++)
+  {
+    const BaselineEntry &now = current.entries[i];
+    if (find(now) == NULL)
+    {
+      snprintf(current_ms, sizeof(current_ms), "%.3f", now.mean_ns / 1e6);
+      print_row(out, now, "-", current_ms, "-", "new");
+    }
+  }
+
+  return regressions;
+}
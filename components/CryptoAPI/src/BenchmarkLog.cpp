@@ -0,0 +1,151 @@
+#include "BenchmarkLog.h"
+#include "esp_log.h"
+#include <stdlib.h>
+
+static const char *TAG = "BenchmarkLog";
+
+// Indexed by the Libraries, Algorithms and Hashes enums
+static const char *const library_names[] = {"mbedtls", "wolfssl", "microecc"};
+static const char *const algorithm_names[] = {"bp256r1", "bp512r1", "secp256r1", "secp521r1", "ed25519", "ed448", "rsa"};
+static const char *const hash_names[] = {"sha256", "sha512", "sha3-256", "shake256"};
+
+static_assert(sizeof(library_names) / sizeof(library_names[0]) == BENCHMARK_LIBRARY_COUNT, "one name per library");
+static_assert(sizeof(algorithm_names) / sizeof(algorithm_names[0]) == BENCHMARK_ALGORITHM_COUNT, "one name per algorithm");
+static_assert(sizeof(hash_names) / sizeof(hash_names[0]) == BENCHMARK_HASH_COUNT, "one name per hash");
+
+template <size_t N>
+static const char *to_name(const char *const (&names)[N], int value)
+{
+  return value >= 0 && (size_t)value < N ? names[value] : "unknown";
+}
+
+const char *library_name(int library)
+{
+  return to_name(library_names, library);
+}
+
+const char *algorithm_name(int algorithm)
+{
+  return to_name(algorithm_names, algorithm);
+}
+
+const char *hash_name(int hash)
+{
+  return to_name(hash_names, hash);
+}
+
+BenchmarkLog::BenchmarkLog() : records(NULL), head(0), count(0), dropped(0) {}
+
+BenchmarkLog::~BenchmarkLog()
+{
+  free(records);
+}
+
+void BenchmarkLog::add(const BenchmarkRecord &record)
+{
+  if (records == NULL)
+  {
+    records = (BenchmarkRecord *)malloc(CRYPTO_API_RESULT_LOG_SIZE * sizeof(BenchmarkRecord));
+    if (records == NULL)
+    {
+      ESP_LOGE(TAG, "> Could not allocate %d result records.", CRYPTO_API_RESULT_LOG_SIZE);
+      dropped++;
+      return;
+    }
+  }
+
+  records[(head + count) % CRYPTO_API_RESULT_LOG_SIZE] = record;
+  if (count < CRYPTO_API_RESULT_LOG_SIZE)
+  {
+    count++;
+  }
+  else
+  {
+    head = (head + 1) % CRYPTO_API_RESULT_LOG_SIZE;
+    dropped++;
+  }
+}
+
+void BenchmarkLog::clear()
+{
+  head = 0;
+  count = 0;
+  dropped = 0;
+}
+
+size_t BenchmarkLog::size()
+{
+  return count;
+}
+
+unsigned long BenchmarkLog::get_dropped()
+{
+  return dropped;
+}
+
+const BenchmarkRecord &BenchmarkLog::at(size_t index)
+{
+  return records[(head + index) % CRYPTO_API_RESULT_LOG_SIZE];
+}
+
+int BenchmarkLog::write(FILE *out, ResultFormat format)
+{
+  if (format == RESULT_JSON)
+  {
+    write_json(out);
+  }
+  else
+  {
+    write_csv(out);
+  }
+
+  if (ferror(out))
+  {
+    ESP_LOGE(TAG, "> Failed to write the result records.");
+    return -1;
+  }
+  if (dropped > 0)
+  {
+    ESP_LOGW(TAG, "> %lu older records were overwritten.", dropped);
+  }
+  return 0;
+}
+
+void BenchmarkLog::write_csv(FILE *out)
+{
+  fprintf(out, "library,algorithm,hash,operation,message_length,elapsed_ns,cycles,peak_heap_bytes\n");
+  for (size_t i = 0; i < count; i++)
+  {
+    const BenchmarkRecord &record = at(i);
+    fprintf(out, "%s,%s,%s,%s,%lu,%llu,%llu,%lu\n",
+            library_name(record.library),
+            algorithm_name(record.algorithm),
+            hash_name(record.hash),
+            record.operation,
+            (unsigned long)record.message_length,
+            (unsigned long long)record.elapsed_ns,
+            (unsigned long long)record.cycles,
+            (unsigned long)record.peak_heap_bytes);
+  }
+}
+
+void BenchmarkLog::write_json(FILE *out)
+{
+  fprintf(out, "[");
+  for (size_t i = 0; i < count; i++)
+  {
+    const BenchmarkRecord &record = at(i);
+    fprintf(out, "%s\n  {\"library\": \"%s\", \"algorithm\": \"%s\", \"hash\": \"%s\", \"operation\": \"%s\", "
+                 "\"message_length\": %lu, \"elapsed_ns\": %llu, \"cycles\": %llu, \"peak_heap_bytes\": %lu}",
+            i == 0 ? "" : ",",
+            library_name(record.library),
+            algorithm_name(record.algorithm),
+            hash_name(record.hash),
+            record.operation,
+            (unsigned long)record.message_length,
+            (unsigned long long)record.elapsed_ns,
+            (unsigned long long)record.cycles,
+            (unsigned long)record.peak_heap_bytes);
+  }
+  fprintf(out, "\n]\n");
+}
@@ -0,0 +1,173 @@
+#include "BenchmarkMatrix.h"
+#include <stdlib.h>
+
+static const char *TAG = "BenchmarkMatrix";
+
+struct MatrixContext
+{
+  CryptoAPI *crypto_api;
+  const unsigned char *message;
+  size_t message_length;
+  unsigned char *signature;
+  size_t signature_size;
+  size_t signature_length;
+  bool rsa;
+  unsigned int rsa_key_size;
+  int rsa_exponent;
+};
+
+static int gen_keys_once(void *user_data)
+{
+  MatrixContext *context = (MatrixContext *)user_data;
+  return context->rsa ? context->crypto_api->gen_rsa_keys(context->rsa_key_size, context->rsa_exponent) : context->crypto_api->gen_keys();
+}
+
+static int sign_once(void *user_data)
+{
+  MatrixContext *context = (MatrixContext *)user_data;
+  context->signature_length = context->signature_size;
+  return context->crypto_api->sign(context->message, context->message_length, context->signature, &context->signature_length);
+}
+
+static int verify_once(void *user_data)
+{
+  MatrixContext *context = (MatrixContext *)user_data;
+  return context->crypto_api->verify(context->message, context->message_length, context->signature, context->signature_length);
+}
+
+BenchmarkMatrix::BenchmarkMatrix(CryptoAPI &crypto_api, int warmup, int iterations, int keygen_iterations)
+    : crypto_api(crypto_api), warmup(warmup), iterations(iterations), keygen_iterations(keygen_iterations), cells(NULL), count(0) {}
+
+BenchmarkMatrix::~BenchmarkMatrix()
+{
+  free(cells);
+}
+
+int BenchmarkMatrix::run(const unsigned char *message, size_t message_length, unsigned int rsa_key_size, int rsa_exponent, size_t shake_256_length)
+{
+  size_t supported = 0;
+  for (size_t library = 0; library < BENCHMARK_LIBRARY_COUNT; library++)
+  {
+    for (size_t algorithm = 0; algorithm < BENCHMARK_ALGORITHM_COUNT; algorithm++)
+    {
+      for (size_t hash = 0; hash < BENCHMARK_HASH_COUNT; hash++)
+      {
+        supported += CryptoAPI::is_supported((Libraries)library, (Algorithms)algorithm, (Hashes)hash);
+      }
+    }
+  }
+
+  free(cells);
+  count = 0;
+  cells = (MatrixCell *)calloc(supported, sizeof(MatrixCell));
+  if (cells == NULL)
+  {
+    ESP_LOGE(TAG, "> Could not allocate the result table.");
+    return -1;
+  }
+
+  int ret = 0;
+  for (size_t library = 0; library < BENCHMARK_LIBRARY_COUNT; library++)
+  {
+    for (size_t algorithm = 0; algorithm < BENCHMARK_ALGORITHM_COUNT; algorithm++)
+    {
+      for (size_t hash = 0; hash < BENCHMARK_HASH_COUNT; hash++)
+      {
+        if (!CryptoAPI::is_supported((Libraries)library, (Algorithms)algorithm, (Hashes)hash))
+        {
+          continue;
+        }
+
+        MatrixCell &cell = cells[count++];
+        cell.library = (Libraries)library;
+        cell.algorithm = (Algorithms)algorithm;
+        cell.hash = (Hashes)hash;
+        cell.status = run_cell(cell, message, message_length, rsa_key_size, rsa_exponent, shake_256_length);
+        if (cell.status != 0)
+        {
+          ESP_LOGE(TAG, "%s %s %s failed with status %d", library_name(library), algorithm_name(algorithm), hash_name(hash), cell.status);
+          if (ret == 0)
+          {
+            ret = cell.status;
+          }
+        }
+      }
+    }
+  }
+
+  ESP_LOGI(TAG, "%u combinations measured, %u not supported", (unsigned)count, (unsigned)(BENCHMARK_LIBRARY_COUNT * BENCHMARK_ALGORITHM_COUNT * BENCHMARK_HASH_COUNT - count));
+  return ret;
+}
+
+int BenchmarkMatrix::run_cell(MatrixCell &cell, const unsigned char *message, size_t message_length, unsigned int rsa_key_size, int rsa_exponent, size_t shake_256_length)
+{
+  int ret = crypto_api.init(cell.library, cell.algorithm, cell.hash, shake_256_length);
+  if (ret != 0)
+  {
+    return ret;
+  }
+
+  MatrixContext context;
+  context.crypto_api = &crypto_api;
+  context.message = message;
+  context.message_length = message_length;
+  context.signature_size = crypto_api.get_signature_size();
+  context.signature = (unsigned char *)malloc(context.signature_size * sizeof(unsigned char));
+  context.signature_length = context.signature_size;
+  context.rsa = cell.algorithm == Algorithms::RSA;
+  context.rsa_key_size = rsa_key_size;
+  context.rsa_exponent = rsa_exponent;
+  if (context.signature == NULL)
+  {
+    crypto_api.close();
+    return -1;
+  }
+
+  // The last generated key is the one sign and verify use
+  BenchmarkRunner keygen_runner(0, keygen_iterations);
+  BenchmarkRunner runner(warmup, iterations);
+
+  ret = keygen_runner.run("gen_keys", gen_keys_once, &context, &cell.keygen);
+  if (ret == 0)
+  {
+    ret = runner.run("sign", sign_once, &context, &cell.sign);
+  }
+  if (ret == 0)
+  {
+    ret = runner.run("verify", verify_once, &context, &cell.verify);
+  }
+
+  free(context.signature);
+  crypto_api.close();
+  return ret;
+}
+
+void BenchmarkMatrix::print_table(FILE *out)
+{
+  fprintf(out, "%-9s %-10s %-9s %10s %10s %10s %8s %10s %10s %8s\n",
+          "library", "algorithm", "hash", "keygen ms", "sign ms", "sign p95", "+/- ms", "verify ms", "verify p95", "+/- ms");
+  for (size_t i = 0; i < count; i++)
+  {
+    const MatrixCell &cell = cells[i];
+    fprintf(out, "%-9s %-10s %-9s ", library_name(cell.library), algorithm_name(cell.algorithm), hash_name(cell.hash));
+    if (cell.status != 0)
+    {
+      fprintf(out, "failed with status %d\n", cell.status);
+      continue;
+    }
+    fprintf(out, "%10.3f %10.3f %10.3f %8.3f %10.3f %10.3f %8.3f\n",
+            cell.keygen.median_ns / 1e6,
+            cell.sign.median_ns / 1e6, cell.sign.p95_ns / 1e6, cell.sign.ci95_ns / 1e6,
+            cell.verify.median_ns / 1e6, cell.verify.p95_ns / 1e6, cell.verify.ci95_ns / 1e6);
+  }
+}
+
+size_t BenchmarkMatrix::size()
+{
+  return count;
+}
+
+const MatrixCell &BenchmarkMatrix::at(size_t index)
+{
+  return cells[index];
+}
@@ -0,0 +1,180 @@
+#include "BenchmarkRunner.h"
+#include "CryptoApiCommons.h"
+#include <math.h>
+#include <stdlib.h>
+
+static const char *TAG = "BenchmarkRunner";
+
+// Samples whose modified z-score (0.6745 * |x - median| / MAD) is above this
+// are rejected, as recommended by Iglewicz and Hoaglin
+#define OUTLIER_Z_SCORE 3.5
+
+// Two-sided 95% Student t values for 1 to 30 degrees of freedom; above that
+// the normal value is close enough
+static const double t_95[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                              2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                              2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+
+static int compare_samples(const void *a, const void *b)
+{
+  uint64_t x = *(const uint64_t *)a;
+  uint64_t y = *(const uint64_t *)b;
+  return x < y ? -1 : x > y ? 1 : 0;
+}
+
+// Nearest-rank percentile of a sorted array
+static uint64_t percentile(const uint64_t *sorted, size_t count, unsigned int percent)
+{
+  size_t rank = (count * percent + 99) / 100;
+  return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static uint64_t median(const uint64_t *sorted, size_t count)
+{
+  if (count % 2 == 0)
+  {
+    return (sorted[count / 2 - 1] + sorted[count / 2]) / 2;
+  }
+  return sorted[count / 2];
+}
+
+BenchmarkRunner::BenchmarkRunner(int warmup, int iterations, esp_log_level_t log_level) : warmup(warmup < 0 ? 0 : warmup), iterations(iterations < 1 ? 1 : iterations), log_level(log_level) {}
+
+int BenchmarkRunner::run(const char *label, BenchmarkOperation operation, void *user_data, BenchmarkStats *stats)
+{
+  uint64_t *samples = (uint64_t *)malloc(iterations * sizeof(uint64_t));
+  if (samples == NULL)
+  {
+    ESP_LOGE(TAG, "Failed at %s: no memory for %d samples", label, iterations);
+    return -1;
+  }
+
+  esp_log_level_t previous_level = esp_log_level_get("*");
+  if (log_level < previous_level)
+  {
+    esp_log_level_set("*", log_level);
+  }
+
+  // The deferred logs of each call are drained between calls, while logging
+  // is still turned down, so they are dropped like direct ones would be and
+  // never fill the TraceLog
+  int ret = 0;
+  for (int i = 0; i < warmup && ret == 0; i++)
+  {
+    ret = operation(user_data);
+    TraceLog::drain();
+  }
+
+  for (int i = 0; i < iterations && ret == 0; i++)
+  {
+    Timestamp start = CryptoApiCommons::get_timestamp();
+    ret = operation(user_data);
+    Timestamp end = CryptoApiCommons::get_timestamp();
+    samples[i] = CryptoApiCommons::elapsed_ns(start, end);
+    TraceLog::drain();
+  }
+
+  esp_log_level_set("*", previous_level);
+
+  if (ret != 0)
+  {
+    ESP_LOGE(TAG, "Failed at %s with status %d", label, ret);
+    free(samples);
+    return ret;
+  }
+
+  summarize(samples, iterations, stats);
+  free(samples);
+  return 0;
+}
+
+void BenchmarkRunner::summarize(uint64_t *samples, size_t count, BenchmarkStats *stats)
+{
+  *stats = {};
+  if (count == 0)
+  {
+    return;
+  }
+
+  qsort(samples, count, sizeof(uint64_t), compare_samples);
+  uint64_t center = median(samples, count);
+
+  // MAD: median of the absolute deviations from the median
+  uint64_t *deviations = (uint64_t *)malloc(count * sizeof(uint64_t));
+  uint64_t mad = 0;
+  if (deviations != NULL)
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      deviations[i] = samples[i] > center ? samples[i] - center : center - samples[i];
+    }
+    qsort(deviations, count, sizeof(uint64_t), compare_samples);
+    mad = median(deviations, count);
+    free(deviations);
+  }
+
+  // The samples are sorted, so the ones kept form one contiguous range
+  size_t first = 0;
+  size_t last = count;
+  if (mad > 0)
+  {
+    double limit = OUTLIER_Z_SCORE * mad / 0.6745;
+    while (first < last && center - samples[first] > limit)
+    {
+      first++;
+    }
+    while (last > first && samples[last - 1] - center > limit)
+    {
+      last--;
+    }
+  }
+
+  const uint64_t *kept = samples + first;
+  size_t kept_count = last - first;
+
+  double sum = 0;
+  for (size_t i = 0; i < kept_count; i++)
+  {
+    sum += kept[i];
+  }
+  double mean = sum / kept_count;
+
+  double squares = 0;
+  for (size_t i = 0; i < kept_count; i++)
+  {
+    squares += (kept[i] - mean) * (kept[i] - mean);
+  }
+  double stddev = kept_count > 1 ? sqrt(squares / (kept_count - 1)) : 0;
+
+  double t = t_critical_95(kept_count - 1);
+
+  stats->samples = kept_count;
+  stats->rejected = count - kept_count;
+  stats->min_ns = kept[0];
+  stats->median_ns = median(kept, kept_count);
+  stats->p95_ns = percentile(kept, kept_count, 95);
+  stats->p99_ns = percentile(kept, kept_count, 99);
+  stats->max_ns = kept[kept_count - 1];
+  stats->mean_ns = mean;
+  stats->stddev_ns = stddev;
+  stats->ci95_ns = t * stddev / sqrt((double)kept_count);
+}
+
+double BenchmarkRunner::t_critical_95(double degrees)
+{
+  if (degrees < 1)
+  {
+    return 0;
+  }
+  size_t index = (size_t)degrees;
+  return index <= sizeof(t_95) / sizeof(t_95[0]) ? t_95[index - 1] : 1.96;
+}
+
+void BenchmarkRunner::print_stats(const char *label, const BenchmarkStats &stats)
+{
+  ESP_LOGI(TAG, "%s: %u samples (%u rejected), min %.3f ms, median %.3f ms, p95 %.3f ms, p99 %.3f ms, max %.3f ms",
+           label, (unsigned)stats.samples, (unsigned)stats.rejected,
+           stats.min_ns / 1e6, stats.median_ns / 1e6, stats.p95_ns / 1e6, stats.p99_ns / 1e6, stats.max_ns / 1e6);
+  ESP_LOGI(TAG, "%s: mean %.3f ms +/- %.3f ms (95%% CI), stddev %.3f ms",
+           label, stats.mean_ns / 1e6, stats.ci95_ns / 1e6, stats.stddev_ns / 1e6);
+}
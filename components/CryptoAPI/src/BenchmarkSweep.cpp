@@ -0,0 +1,317 @@
+#include "BenchmarkSweep.h"
+#include <stdlib.h>
+
+static const char *TAG = "BenchmarkSweep";
+
+// The smallest non-empty message; each next size is four times the last
+#define SWEEP_FIRST_SIZE 64
+
+static size_t size_at(size_t index)
+{
+  return index == 0 ? 0 : (size_t)SWEEP_FIRST_SIZE << (2 * (index - 1));
+}
+
+// Feeds `length` bytes of the repeating `chunk` to sign_update() or
+// verify_update()
+static int stream_message(CryptoAPI &crypto_api, bool verify, const unsigned char *chunk, size_t length)
+{
+  int ret = 0;
+  for (size_t offset = 0; offset < length && ret == 0; offset += BENCHMARK_SWEEP_CHUNK)
+  {
+    size_t piece = length - offset < BENCHMARK_SWEEP_CHUNK ? length - offset : BENCHMARK_SWEEP_CHUNK;
+    ret = verify ? crypto_api.verify_update(chunk, piece) : crypto_api.sign_update(chunk, piece);
+  }
+  return ret;
+}
+
+// "4 MB", "256 KB", "1.5 KB", "64 B"
+static void format_size(char *buffer, size_t buffer_size, size_t bytes)
+{
+  if (bytes >= 1024 * 1024)
+  {
+    snprintf(buffer, buffer_size, bytes % (1024 * 1024) == 0 ? "%.0f MB" : "%.1f MB", bytes / (1024.0 * 1024));
+  }
+  else if (bytes >= 1024)
+  {
+    snprintf(buffer, buffer_size, bytes % 1024 == 0 ? "%.0f KB" : "%.1f KB", bytes / 1024.0);
+  }
+  else
+  {
+    snprintf(buffer, buffer_size, "%u B", (unsigned)bytes);
+  }
+}
+
+BenchmarkSweep::BenchmarkSweep(CryptoAPI &crypto_api, size_t max_size, int iterations)
+    : crypto_api(crypto_api), max_size(max_size), iterations(iterations < 1 ? 1 : iterations), points(NULL), count(0) {}
+
+BenchmarkSweep::~BenchmarkSweep()
+{
+  free(points);
+}
+
+size_t BenchmarkSweep::sizes_per_combination()
+{
+  size_t sizes = 1;
+  while (size_at(sizes) <= max_size && size_at(sizes) > size_at(sizes - 1))
+  {
+    sizes++;
+  }
+  return sizes;
+}
+
+int BenchmarkSweep::run(Algorithms algorithm, unsigned int rsa_key_size, int rsa_exponent, size_t shake_256_length)
+{
+  size_t combinations = 0;
+  for (int library = 0; library < BENCHMARK_LIBRARY_COUNT; library++)
+  {
+    for (int hash = 0; hash < BENCHMARK_HASH_COUNT; hash++)
+    {
+      combinations += CryptoAPI::is_supported((Libraries)library, algorithm, (Hashes)hash);
+    }
+  }
+
+  size_t sizes = sizes_per_combination();
+  free(points);
+  count = 0;
+  points = (SweepPoint *)calloc(combinations * sizes, sizeof(SweepPoint));
+  if (points == NULL)
+  {
+    ESP_LOGE(TAG, "> Could not allocate the result table.");
+    return -1;
+  }
+
+  int ret = 0;
+  for (int library = 0; library < BENCHMARK_LIBRARY_COUNT; library++)
+  {
+    for (int hash = 0; hash < BENCHMARK_HASH_COUNT; hash++)
+    {
+      if (!CryptoAPI::is_supported((Libraries)library, algorithm, (Hashes)hash))
+      {
+        continue;
+      }
+
+      SweepPoint *first = &points[count];
+      for (size_t i = 0; i < sizes; i++)
+      {
+        first[i].library = (Libraries)library;
+        first[i].algorithm = algorithm;
+        first[i].hash = (Hashes)hash;
+        first[i].message_length = size_at(i);
+      }
+      count += sizes;
+
+      int status = run_combination(first, rsa_key_size, rsa_exponent, shake_256_length);
+      if (status != 0)
+      {
+        ESP_LOGE(TAG, "%s %s %s failed with status %d", library_name(library), algorithm_name(algorithm), hash_name(hash), status);
+        if (ret == 0)
+        {
+          ret = status;
+        }
+      }
+    }
+  }
+
+  ESP_LOGI(TAG, "%u combinations measured at %u sizes", (unsigned)combinations, (unsigned)sizes);
+  return ret;
+}
+
+int BenchmarkSweep::run_combination(SweepPoint *first, unsigned int rsa_key_size, int rsa_exponent, size_t shake_256_length)
+{
+  size_t sizes = sizes_per_combination();
+  int ret = crypto_api.init(first->library, first->algorithm, first->hash, shake_256_length);
+  if (ret == 0)
+  {
+    ret = first->algorithm == Algorithms::RSA ? crypto_api.gen_rsa_keys(rsa_key_size, rsa_exponent) : crypto_api.gen_keys();
+  }
+
+  size_t signature_size = ret == 0 ? crypto_api.get_signature_size() : 0;
+  unsigned char *signature = (unsigned char *)malloc(signature_size * sizeof(unsigned char));
+  unsigned char *chunk = (unsigned char *)malloc(BENCHMARK_SWEEP_CHUNK * sizeof(unsigned char));
+  if (ret == 0 && (signature == NULL || chunk == NULL))
+  {
+    ret = -1;
+  }
+
+  if (ret == 0)
+  {
+    // Not random, so every size of every library hashes the same bytes
+    for (size_t i = 0; i < BENCHMARK_SWEEP_CHUNK; i++)
+    {
+      chunk[i] = (unsigned char)(i * 31 + 7);
+    }
+  }
+
+  for (size_t i = 0; i < sizes; i++)
+  {
+    first[i].status = ret;
+    if (ret == 0)
+    {
+      first[i].status = run_point(first[i], chunk, signature, signature_size);
+      ret = first[i].status;
+    }
+  }
+
+  free(chunk);
+  free(signature);
+  crypto_api.close();
+  return ret;
+}
+
+int BenchmarkSweep::run_point(SweepPoint &point, unsigned char *chunk, unsigned char *signature, size_t signature_size)
+{
+  uint64_t *samples = (uint64_t *)malloc(3 * iterations * sizeof(uint64_t));
+  if (samples == NULL)
+  {
+    ESP_LOGE(TAG, "> No memory for %d samples.", iterations);
+    return -1;
+  }
+  uint64_t *hashing = samples;
+  uint64_t *sign = samples + iterations;
+  uint64_t *verify = samples + 2 * iterations;
+
+  // As in BenchmarkRunner, the per-operation logs are turned down and drained
+  // between runs so they are not part of what is measured
+  esp_log_level_t previous_level = esp_log_level_get("*");
+  if (ESP_LOG_WARN < previous_level)
+  {
+    esp_log_level_set("*", ESP_LOG_WARN);
+  }
+
+  // Run -1 is the unmeasured warmup
+  int ret = 0;
+  for (int i = -1; i < iterations && ret == 0; i++)
+  {
+    size_t signature_length = signature_size;
+    Timestamp start = CryptoApiCommons::get_timestamp();
+    ret = crypto_api.sign_init();
+    if (ret == 0)
+    {
+      ret = stream_message(crypto_api, false, chunk, point.message_length);
+    }
+    Timestamp hashed = CryptoApiCommons::get_timestamp();
+    if (ret == 0)
+    {
+      ret = crypto_api.sign_final(signature, &signature_length);
+    }
+    Timestamp signed_at = CryptoApiCommons::get_timestamp();
+    if (ret == 0)
+    {
+      ret = crypto_api.verify_init();
+    }
+    if (ret == 0)
+    {
+      ret = stream_message(crypto_api, true, chunk, point.message_length);
+    }
+    if (ret == 0)
+    {
+      ret = crypto_api.verify_final(signature, signature_length);
+    }
+    Timestamp verified = CryptoApiCommons::get_timestamp();
+    TraceLog::drain();
+
+    if (i >= 0)
+    {
+      hashing[i] = CryptoApiCommons::elapsed_ns(start, hashed);
+      sign[i] = CryptoApiCommons::elapsed_ns(start, signed_at);
+      verify[i] = CryptoApiCommons::elapsed_ns(signed_at, verified);
+    }
+  }
+
+  esp_log_level_set("*", previous_level);
+
+  if (ret == 0)
+  {
+    BenchmarkRunner::summarize(hashing, iterations, &point.hashing);
+    BenchmarkRunner::summarize(sign, iterations, &point.sign);
+    BenchmarkRunner::summarize(verify, iterations, &point.verify);
+  }
+  free(samples);
+  return ret;
+}
+
+size_t BenchmarkSweep::crossover(const SweepPoint &point, bool verify)
+{
+  size_t sizes = sizes_per_combination();
+  size_t index = &point - points;
+  if (points == NULL || index >= count)
+  {
+    return 0;
+  }
+
+  const SweepPoint &smallest = points[index - index % sizes];
+  const SweepPoint &largest = points[index - index % sizes + sizes - 1];
+  if (smallest.status != 0 || largest.status != 0 || largest.message_length == 0 || largest.hashing.median_ns == 0)
+  {
+    return 0;
+  }
+
+  // Hashing is linear in the message length, so bytes per ns at the largest
+  // size times the math time is where the two are equal
+  uint64_t total_ns = verify ? smallest.verify.median_ns : smallest.sign.median_ns;
+  uint64_t math_ns = total_ns > smallest.hashing.median_ns ? total_ns - smallest.hashing.median_ns : 0;
+  return (size_t)((double)math_ns * largest.message_length / largest.hashing.median_ns);
+}
+
+size_t BenchmarkSweep::sign_crossover(const SweepPoint &point)
+{
+  return crossover(point, false);
+}
+
+size_t BenchmarkSweep::verify_crossover(const SweepPoint &point)
+{
+  return crossover(point, true);
+}
+
+void BenchmarkSweep::print_table(FILE *out)
+{
+  char size[16];
+  char sign_size[16];
+  char verify_size[16];
+  size_t sizes = sizes_per_combination();
+
+  fprintf(out, "%-9s %-10s %-9s %8s %10s %12s %12s\n",
+          "library", "algorithm", "hash", "msg size", "hash MB/s", "sign ms", "verify ms");
+  for (size_t i = 0; i < count; i++)
+  {
+    const SweepPoint &point = points[i];
+    format_size(size, sizeof(size), point.message_length);
+    fprintf(out, "%-9s %-10s %-9s %8s ", library_name(point.library), algorithm_name(point.algorithm), hash_name(point.hash), size);
+    if (point.status != 0)
+    {
+      fprintf(out, "failed with status %d\n", point.status);
+      continue;
+    }
+    if (point.message_length == 0 || point.hashing.median_ns == 0)
+    {
+      fprintf(out, "%10s ", "-");
+    }
+    else
+    {
+      fprintf(out, "%10.2f ", point.message_length * 1e3 / point.hashing.median_ns);
+    }
+    fprintf(out, "%12.3f %12.3f\n", point.sign.median_ns / 1e6, point.verify.median_ns / 1e6);
+  }
+
+  fprintf(out, "\n%-9s %-10s %-9s %16s %16s\n", "library", "algorithm", "hash", "sign crossover", "verify crossover");
+  for (size_t i = 0; i < count; i += sizes)
+  {
+    const SweepPoint &point = points[i];
+    size_t sign_bytes = sign_crossover(point);
+    size_t verify_bytes = verify_crossover(point);
+    format_size(sign_size, sizeof(sign_size), sign_bytes);
+    format_size(verify_size, sizeof(verify_size), verify_bytes);
+    fprintf(out, "%-9s %-10s %-9s %16s %16s\n", library_name(point.library), algorithm_name(point.algorithm), hash_name(point.hash),
+            sign_bytes > 0 ? sign_size : "-", verify_bytes > 0 ? verify_size : "-");
+  }
+}
+
+size_t BenchmarkSweep::size()
+{
+  return count;
+}
+
+const SweepPoint &BenchmarkSweep::at(size_t index)
+{
+  return points[index];
+}
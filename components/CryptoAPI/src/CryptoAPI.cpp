@@ -1,269 +1,520 @@
 #include "CryptoAPI.h"
+#include "SignPipeline.h"
+#include "SpanTrace.h"
+#if CRYPTO_API_WITH_MBEDTLS || CRYPTO_API_WITH_MICROECC
 #include "MbedtlsModule.h"
+#endif
+#if CRYPTO_API_WITH_WOLFSSL
 #include "WolfsslModule.h"
+#endif
+#if CRYPTO_API_WITH_MICROECC
 #include "MicroeccModule.h"
+#endif
 
 static const char *TAG = "CryptoAPI";
 
-CryptoAPI::CryptoAPI()
-{
-  mbedtls_module = new MbedtlsModule(commons);
-  wolfssl_module = new WolfsslModule(commons);
-  microecc_module = new MicroeccModule(commons, *mbedtls_module);
-}
+// Modules are created on the first init() that selects them, so an image
+// only pays heap and start-up time for the libraries it actually uses.
+CryptoAPI::CryptoAPI() : mbedtls_module(nullptr), wolfssl_module(nullptr), microecc_module(nullptr), module(nullptr), chosen_library(Libraries::MBEDTLS_LIB), last_allocations() {}
 
 CryptoAPI::~CryptoAPI()
 {
-  delete mbedtls_module;
-  delete wolfssl_module;
+#if CRYPTO_API_WITH_MICROECC
   delete microecc_module;
+#endif
+#if CRYPTO_API_WITH_WOLFSSL
+  delete wolfssl_module;
+#endif
+#if CRYPTO_API_WITH_MBEDTLS || CRYPTO_API_WITH_MICROECC
+  delete mbedtls_module;
+#endif
 }
 
-int CryptoAPI::init(Algorithms algorithm, Hashes hash, size_t length_of_shake256)
+#if CRYPTO_API_WITH_MBEDTLS || CRYPTO_API_WITH_MICROECC
+MbedtlsModule *CryptoAPI::get_mbedtls_module()
 {
-  commons.init_littlefs();
+  if (mbedtls_module == nullptr)
+  {
+    mbedtls_module = new MbedtlsModule(commons);
+  }
+  return mbedtls_module;
+}
+#endif
+
+// False, with an error, until an init() has bound a library built into the image
+bool CryptoAPI::has_module()
+{
+  if (module == nullptr)
+  {
+    ESP_LOGE(TAG, "> No library initialized.");
+    return false;
+  }
+  return true;
+}
+
+CryptoBackend *CryptoAPI::module_for(Libraries library)
+{
+  switch (library)
+  {
+#if CRYPTO_API_WITH_MBEDTLS
+  case Libraries::MBEDTLS_LIB:
+    return get_mbedtls_module();
+#endif
+#if CRYPTO_API_WITH_WOLFSSL
+  case Libraries::WOLFSSL_LIB:
+    if (wolfssl_module == nullptr)
+    {
+      wolfssl_module = new WolfsslModule(commons);
+    }
+    return wolfssl_module;
+#endif
+#if CRYPTO_API_WITH_MICROECC
+  case Libraries::MICROECC_LIB:
+    if (microecc_module == nullptr)
+    {
+      // micro-ecc hashes and base64-encodes through the mbedtls module
+      microecc_module = new MicroeccModule(commons, *get_mbedtls_module());
+    }
+    return microecc_module;
+#endif
+  default:
+    return nullptr;
+  }
+}
+
+bool CryptoAPI::is_supported(Libraries library, Algorithms algorithm, Hashes hash)
+{
+  switch (library)
+  {
+  case Libraries::MBEDTLS_LIB:
+    // No EdDSA, and SHAKE256 would silently fall back to SHA-256
+    return CRYPTO_API_WITH_MBEDTLS && algorithm != Algorithms::EDDSA_25519 && algorithm != Algorithms::EDDSA_448 && hash != Hashes::MY_SHAKE_256;
+  case Libraries::WOLFSSL_LIB:
+    return CRYPTO_API_WITH_WOLFSSL;
+  case Libraries::MICROECC_LIB:
+    // secp256r1 only, hashed through mbedtls
+    return CRYPTO_API_WITH_MICROECC && algorithm == Algorithms::ECDSA_SECP256R1 && hash != Hashes::MY_SHAKE_256;
+  default:
+    return false;
+  }
+}
+
+int CryptoAPI::bind(Libraries library, Algorithms algorithm, Hashes hash, size_t length_of_shake256)
+{
+  CryptoBackend *backend = module_for(library);
+  if (backend == nullptr)
+  {
+    ESP_LOGE(TAG, "Library not available in this build");
+    return -1;
+  }
+
+  this->chosen_library = library;
+  this->module = backend;
+  commons.set_chosen_library(library);
+  commons.set_chosen_algorithm(algorithm);
+  commons.set_chosen_hash(hash);
+  commons.set_shake256_hash_length(length_of_shake256);
+  return 0;
+}
 
-  if (this->chosen_library == Libraries::MBEDTLS_LIB)
+int CryptoAPI::init(Algorithms algorithm, Hashes hash, size_t length_of_shake256)
+{
+  if (module == nullptr)
   {
-    return mbedtls_module->init(algorithm, hash, 0);
+    ESP_LOGE(TAG, "Library not available in this build");
+    return -1;
   }
 
-  if (this->chosen_library == Libraries::WOLFSSL_LIB)
+  commons.init_littlefs();
+#if CRYPTO_API_DEFERRED_LOG
+  TraceLog::start_drain_task();
+#endif
+
+  if (this->chosen_library == Libraries::MICROECC_LIB)
   {
-    return wolfssl_module->init(algorithm, hash, length_of_shake256);
+    algorithm = Algorithms::ECDSA_SECP256R1;
   }
 
-  return microecc_module->init(Algorithms::ECDSA_SECP256R1, hash, 0);
+  commons.set_chosen_library(this->chosen_library);
+  commons.set_chosen_algorithm(algorithm);
+  return module->init(algorithm, hash, length_of_shake256);
 }
 
 int CryptoAPI::init(Libraries library, Algorithms algorithm, Hashes hash, size_t length_of_shake256)
 {
+  ScopedSpan span("init", "api");
   this->print_init_configuration(library, algorithm, hash, length_of_shake256);
   this->chosen_library = library;
+  this->module = module_for(library);
 
   return init(algorithm, hash, length_of_shake256);
 }
 
 int CryptoAPI::get_signature_size()
 {
-  if (this->chosen_library == Libraries::MBEDTLS_LIB)
+  if (!has_module())
   {
-    return mbedtls_module->get_signature_size();
+    return 0;
   }
+  return module->get_signature_size();
+}
 
-  if (this->chosen_library == Libraries::WOLFSSL_LIB)
+// The message lengths set below go into the benchmark records of the
+// operation that follows.
+int CryptoAPI::gen_rsa_keys(unsigned int rsa_key_size, int rsa_exponent)
+{
+  ScopedSpan span("gen_rsa_keys", "api");
+  if (!has_module())
   {
-    return wolfssl_module->get_signature_size();
+    return -1;
   }
-
-  return microecc_module->get_signature_size();
+  commons.set_message_length(0);
+  begin_allocation_trace();
+  int ret = module->gen_rsa_keys(rsa_key_size, rsa_exponent);
+  end_allocation_trace("gen_rsa_keys");
+  return ret;
 }
 
-int CryptoAPI::gen_rsa_keys(unsigned int rsa_key_size, int rsa_exponent)
+int CryptoAPI::gen_keys()
 {
-  if (this->chosen_library == Libraries::MBEDTLS_LIB)
+  ScopedSpan span("gen_keys", "api");
+  if (!has_module())
   {
-    return mbedtls_module->gen_rsa_keys(rsa_key_size, rsa_exponent);
+    return -1;
   }
+  commons.set_message_length(0);
+  begin_allocation_trace();
+  int ret = module->gen_keys();
+  end_allocation_trace("gen_keys");
+  return ret;
+}
 
-  if (this->chosen_library == Libraries::WOLFSSL_LIB)
+int CryptoAPI::get_public_key_pem(unsigned char *public_key_pem)
+{
+  if (!has_module())
   {
-    return wolfssl_module->gen_rsa_keys(rsa_key_size, rsa_exponent);
+    return -1;
   }
-
-  return -1;
+  return module->get_public_key_pem(public_key_pem);
 }
 
-int CryptoAPI::gen_keys()
+int CryptoAPI::sign(const unsigned char *message, size_t message_length, unsigned char *signature, size_t *signature_length)
 {
-  if (this->chosen_library == Libraries::WOLFSSL_LIB)
+  ScopedSpan span("sign", "api");
+  if (!has_module())
   {
-    return wolfssl_module->gen_keys();
+    return -1;
   }
+  commons.set_message_length(message_length);
+  begin_allocation_trace();
+  int ret = module->sign(message, message_length, signature, signature_length);
+  end_allocation_trace("sign");
+  return ret;
+}
 
-  if (this->chosen_library == Libraries::MBEDTLS_LIB)
+int CryptoAPI::sign_batch(const unsigned char *const *messages, const size_t *message_lengths, size_t count, unsigned char *const *signatures, size_t *signature_lengths)
+{
+  ScopedSpan span("sign_batch", "api");
+  if (!has_module())
   {
-    return mbedtls_module->gen_keys();
+    return -1;
   }
-
-  return microecc_module->gen_keys();
+  set_batch_length(message_lengths, count);
+  return module->sign_batch(messages, message_lengths, count, signatures, signature_lengths);
 }
 
-int CryptoAPI::get_public_key_pem(unsigned char *public_key_pem)
+int CryptoAPI::verify(const unsigned char *message, size_t message_length, unsigned char *signature, size_t signature_length)
 {
-  if (this->chosen_library == Libraries::MBEDTLS_LIB)
+  ScopedSpan span("verify", "api");
+  if (!has_module())
   {
-    return mbedtls_module->get_public_key_pem(public_key_pem);
+    return -1;
   }
+  commons.set_message_length(message_length);
+  begin_allocation_trace();
+  int ret = module->verify(message, message_length, signature, signature_length);
+  end_allocation_trace("verify");
+  return ret;
+}
 
-  if (this->chosen_library == Libraries::WOLFSSL_LIB)
+int CryptoAPI::sign_init()
+{
+  if (!has_module())
   {
-    return wolfssl_module->get_public_key_pem(public_key_pem);
+    return -1;
   }
-
-  return microecc_module->get_public_key_pem(public_key_pem);
+  commons.set_message_length(0);
+  return module->sign_init();
 }
 
-int CryptoAPI::sign(const unsigned char *message, size_t message_length, unsigned char *signature, size_t *signature_length)
+int CryptoAPI::sign_update(const unsigned char *data, size_t data_length)
 {
-  if (this->chosen_library == Libraries::MBEDTLS_LIB)
+  if (!has_module())
   {
-    return mbedtls_module->sign(message, message_length, signature, signature_length);
+    return -1;
   }
+  commons.add_message_length(data_length);
+  return module->sign_update(data, data_length);
+}
 
-  if (this->chosen_library == Libraries::WOLFSSL_LIB)
+int CryptoAPI::sign_final(unsigned char *signature, size_t *signature_length)
+{
+  ScopedSpan span("sign_final", "api");
+  if (!has_module())
   {
-    return wolfssl_module->sign(message, message_length, signature, signature_length);
+    return -1;
   }
+  return module->sign_final(signature, signature_length);
+}
 
-  return microecc_module->sign(message, message_length, signature, 0);
+int CryptoAPI::verify_init()
+{
+  if (!has_module())
+  {
+    return -1;
+  }
+  commons.set_message_length(0);
+  return module->verify_init();
 }
 
-int CryptoAPI::verify(const unsigned char *message, size_t message_length, unsigned char *signature, size_t signature_length)
+int CryptoAPI::verify_update(const unsigned char *data, size_t data_length)
 {
-  if (this->chosen_library == Libraries::MBEDTLS_LIB)
+  if (!has_module())
   {
-    return mbedtls_module->verify(message, message_length, signature, signature_length);
+    return -1;
   }
+  commons.add_message_length(data_length);
+  return module->verify_update(data, data_length);
+}
 
-  if (this->chosen_library == Libraries::WOLFSSL_LIB)
+int CryptoAPI::verify_final(unsigned char *signature, size_t signature_length)
+{
+  ScopedSpan span("verify_final", "api");
+  if (!has_module())
   {
-    return wolfssl_module->verify(message, message_length, signature, signature_length);
+    return -1;
   }
+  return module->verify_final(signature, signature_length);
+}
 
-  return microecc_module->verify(message, message_length, signature, 0);
+size_t CryptoAPI::get_digest_length()
+{
+  if (!has_module())
+  {
+    return 0;
+  }
+  return module->get_digest_length();
 }
 
-void CryptoAPI::close()
+int CryptoAPI::hash_message(const unsigned char *message, size_t message_length, unsigned char *hash)
 {
-  commons.close_littlefs();
+  if (!has_module())
+  {
+    return -1;
+  }
+  return module->hash_message(message, message_length, hash);
+}
 
-  if (this->chosen_library == Libraries::MBEDTLS_LIB)
+int CryptoAPI::sign_hash(const unsigned char *hash, size_t hash_length, unsigned char *signature, size_t *signature_length)
+{
+  if (!has_module())
   {
-    mbedtls_module->close();
-    return;
+    return -1;
   }
+  return module->sign_hash(hash, hash_length, signature, signature_length);
+}
 
-  if (this->chosen_library == Libraries::WOLFSSL_LIB)
+int CryptoAPI::sign_pipelined(const unsigned char *const *messages, const size_t *message_lengths, size_t count, unsigned char *const *signatures, size_t *signature_lengths)
+{
+  ScopedSpan span("sign_pipelined", "api");
+  if (!has_module())
   {
-    wolfssl_module->close();
-    return;
+    return -1;
   }
+  set_batch_length(message_lengths, count);
+  SignPipeline pipeline(commons, *module);
+  return pipeline.run(messages, message_lengths, count, signatures, signature_lengths);
+}
 
-  microecc_module->close();
+int CryptoAPI::verify_with_key(const unsigned char *public_key, size_t public_key_length, const unsigned char *message, size_t message_length, const unsigned char *signature, size_t signature_length)
+{
+  ScopedSpan span("verify_with_key", "api");
+#if CRYPTO_API_WITH_MICROECC
+  if (get_chosen_library() == Libraries::MICROECC_LIB && microecc_module != nullptr)
+  {
+    if (public_key_length != MY_ECC_256_PUBLIC_KEY_SIZE || signature_length < (size_t)microecc_module->get_signature_size())
+    {
+      ESP_LOGE(TAG, "> verify_with_key needs a %d-byte public key and signature.", MY_ECC_256_PUBLIC_KEY_SIZE);
+      return -1;
+    }
+    commons.set_message_length(message_length);
+    begin_allocation_trace();
+    int ret = microecc_module->verify_with_key(public_key, message, message_length, signature);
+    end_allocation_trace("verify_with_key");
+    return ret;
+  }
+#endif
+  ESP_LOGE(TAG, "> verify_with_key is only implemented for micro-ecc.");
+  return -1;
 }
 
-void CryptoAPI::save_private_key(const char *file_path, unsigned char *private_key, size_t private_key_size)
+KeyCacheStats CryptoAPI::get_key_cache_stats()
 {
-  if (get_chosen_library() == Libraries::MBEDTLS_LIB)
+#if CRYPTO_API_WITH_MICROECC
+  if (microecc_module != nullptr)
   {
-    this->mbedtls_module->save_private_key(file_path, private_key, private_key_size);
-    return;
+    return microecc_module->get_key_cache_stats();
   }
+#endif
+  return KeyCacheStats();
+}
 
-  if (get_chosen_library() == Libraries::WOLFSSL_LIB)
+void CryptoAPI::clear_key_cache()
+{
+#if CRYPTO_API_WITH_MICROECC
+  if (microecc_module != nullptr)
   {
-    this->wolfssl_module->save_private_key(file_path, private_key, private_key_size);
-    return;
+    microecc_module->clear_key_cache();
   }
-
-  this->microecc_module->save_private_key(file_path, private_key, private_key_size);
+#endif
 }
 
-void CryptoAPI::save_public_key(const char *file_path, unsigned char *public_key, size_t public_key_size)
+void CryptoAPI::set_batch_length(const size_t *message_lengths, size_t count)
 {
-  if (get_chosen_library() == Libraries::MBEDTLS_LIB)
+  size_t total = 0;
+  for (size_t i = 0; i < count; i++)
   {
-    this->mbedtls_module->save_public_key(file_path, public_key, public_key_size);
-    return;
+    total += message_lengths[i];
   }
+  commons.set_message_length(total);
+}
 
-  if (get_chosen_library() == Libraries::WOLFSSL_LIB)
+void CryptoAPI::begin_allocation_trace()
+{
+#if CRYPTO_API_ALLOC_TRACE
+  AllocationTracer::start();
+#endif
+}
+
+void CryptoAPI::end_allocation_trace(const char *label)
+{
+#if CRYPTO_API_ALLOC_TRACE
+  AllocationTracer::stop(&last_allocations);
+  commons.print_allocations(last_allocations, label);
+#endif
+}
+
+AllocationStats CryptoAPI::get_last_allocations()
+{
+  return last_allocations;
+}
+
+int CryptoAPI::export_results(const char *file_path, ResultFormat format)
+{
+  return commons.export_results(file_path, format);
+}
+
+void CryptoAPI::clear_results()
+{
+  commons.clear_results();
+}
+
+void CryptoAPI::flush_log()
+{
+  TraceLog::drain();
+}
+
+int CryptoAPI::export_spans(const char *file_path)
+{
+  return commons.export_spans(file_path);
+}
+
+void CryptoAPI::close()
+{
+  ScopedSpan span("close", "api");
+  commons.close_littlefs();
+  // Also the cleanup after a failed init(), when there may be no module
+  if (module != nullptr)
   {
-    this->wolfssl_module->save_public_key(file_path, public_key, public_key_size);
-    return;
+    module->close();
   }
-
-  this->microecc_module->save_public_key(file_path, public_key, public_key_size);
 }
 
-void CryptoAPI::save_signature(const char *file_path, const unsigned char *signature, size_t sig_len)
+void CryptoAPI::save_private_key(const char *file_path, unsigned char *private_key, size_t private_key_size)
 {
-  if (get_chosen_library() == Libraries::MBEDTLS_LIB)
+  if (!has_module())
   {
-    this->mbedtls_module->save_signature(file_path, signature, sig_len);
     return;
   }
+  module->save_private_key(file_path, private_key, private_key_size);
+}
 
-  if (get_chosen_library() == Libraries::WOLFSSL_LIB)
+void CryptoAPI::save_public_key(const char *file_path, unsigned char *public_key, size_t public_key_size)
+{
+  if (!has_module())
   {
-    this->wolfssl_module->save_signature(file_path, signature, sig_len);
     return;
   }
-
-  this->microecc_module->save_signature(file_path, signature, sig_len);
+  module->save_public_key(file_path, public_key, public_key_size);
 }
 
-void CryptoAPI::load_file(const char *file_path, unsigned char *buffer, size_t buffer_size)
+void CryptoAPI::save_signature(const char *file_path, const unsigned char *signature, size_t sig_len)
 {
-  if (get_chosen_library() == Libraries::MBEDTLS_LIB)
+  if (!has_module())
   {
-    this->mbedtls_module->load_file(file_path, buffer, buffer_size);
     return;
   }
+  module->save_signature(file_path, signature, sig_len);
+}
 
-  if (get_chosen_library() == Libraries::WOLFSSL_LIB)
+void CryptoAPI::load_file(const char *file_path, unsigned char *buffer, size_t buffer_size)
+{
+  if (!has_module())
   {
-    this->wolfssl_module->load_file(file_path, buffer, buffer_size);
     return;
   }
-
-  this->microecc_module->load_file(file_path, buffer, buffer_size);
+  module->load_file(file_path, buffer, buffer_size);
 }
 
+// The key size getters below size the buffers handed to save_*_key, which
+// holds PEM text for mbedtls and wolfssl but raw key bytes for micro-ecc.
 size_t CryptoAPI::get_private_key_size()
 {
-  if (get_chosen_library() == Libraries::MBEDTLS_LIB)
+  if (!has_module())
   {
-    return this->mbedtls_module->get_private_key_size();
+    return 0;
   }
-
+#if CRYPTO_API_WITH_WOLFSSL
   if (get_chosen_library() == Libraries::WOLFSSL_LIB)
   {
     return this->wolfssl_module->get_private_key_pem_size();
   }
+#endif
 
-  return this->microecc_module->get_private_key_size();
+  return module->get_private_key_size();
 }
 
 size_t CryptoAPI::get_public_key_size()
 {
-  if (get_chosen_library() == Libraries::MBEDTLS_LIB)
+  if (!has_module())
   {
-    return this->mbedtls_module->get_public_key_pem_size();
+    return 0;
   }
-
-  if (get_chosen_library() == Libraries::WOLFSSL_LIB)
+  if (get_chosen_library() == Libraries::MICROECC_LIB)
   {
-    return this->wolfssl_module->get_public_key_pem_size();
+    return module->get_public_key_size();
   }
 
-  return this->microecc_module->get_public_key_size();
+  return module->get_public_key_pem_size();
 }
 
 size_t CryptoAPI::get_public_key_pem_size()
 {
-  if (get_chosen_library() == Libraries::MBEDTLS_LIB)
+  if (!has_module())
   {
-    return this->mbedtls_module->get_public_key_pem_size();
+    return 0;
   }
-
-  if (get_chosen_library() == Libraries::WOLFSSL_LIB)
-  {
-    return this->wolfssl_module->get_public_key_pem_size();
-  }
-
-  return this->microecc_module->get_public_key_pem_size();
+  return module->get_public_key_pem_size();
 }
 
 Algorithms CryptoAPI::get_chosen_algorithm()
@@ -1,8 +1,31 @@
 #include "CryptoApiCommons.h"
+#include "SpanTrace.h"
+#include <string.h>
 
 static const char *TAG = "CryptoApiCommons";
 
-CryptoApiCommons::CryptoApiCommons() {}
+#define RECORD_ELAPSED (1 << 0)
+#define RECORD_MEMORY (1 << 1)
+#define RECORD_CYCLES (1 << 2)
+#define RECORD_COMPLETE (RECORD_ELAPSED | RECORD_MEMORY | RECORD_CYCLES)
+
+// How long calibrate_timer() counts cycles against esp_timer, and how many
+// back-to-back probes it takes the cheapest of
+#define TIMER_CALIBRATION_US 2000
+#define TIMER_CALIBRATION_PROBES 64
+
+static uint32_t cycles_per_us = 0;
+static uint32_t probe_overhead_cycles = 0;
+
+CryptoApiCommons::CryptoApiCommons() : littlefs_mounted(false), chosen_library(-1), message_length(0), pending_fields(0) {}
+
+static Timestamp read_clocks()
+{
+  Timestamp timestamp;
+  timestamp.time_us = esp_timer_get_time();
+  timestamp.cycles = esp_cpu_get_cycle_count();
+  return timestamp;
+}
 
 Algorithms CryptoApiCommons::get_chosen_algorithm()
 {
@@ -29,6 +52,21 @@ void CryptoApiCommons::set_shake256_hash_length(size_t length)
   shake256_hash_length = length;
 }
 
+void CryptoApiCommons::set_chosen_library(Libraries library)
+{
+  chosen_library = library;
+}
+
+void CryptoApiCommons::set_message_length(size_t length)
+{
+  message_length = length;
+}
+
+void CryptoApiCommons::add_message_length(size_t length)
+{
+  message_length += length;
+}
+
 size_t CryptoApiCommons::get_hash_length()
 {
   switch (chosen_hash)
@@ -46,13 +84,24 @@ size_t CryptoApiCommons::get_hash_length()
   }
 }
 
+// Mounting is skipped while the partition is still registered from an
+// earlier init, so only the first init after close_littlefs() pays for it.
 void CryptoApiCommons::init_littlefs()
 {
+  if (littlefs_mounted)
+  {
+    return;
+  }
+
+  ScopedSpan span("mount_littlefs", "fs");
   conf = {
       .base_path = "/littlefs",
       .partition_label = "littlefs",
+      .partition = NULL,
       .format_if_mount_failed = true,
-      .dont_mount = false};
+      .read_only = false,
+      .dont_mount = false,
+      .grow_on_mount = false};
 
   esp_err_t ret = esp_vfs_littlefs_register(&conf);
 
@@ -72,6 +121,7 @@ void CryptoApiCommons::init_littlefs()
     }
     return;
   }
+  littlefs_mounted = true;
 
   size_t total = 0, used = 0;
   ret = esp_littlefs_info(conf.partition_label, &total, &used);
@@ -81,17 +131,25 @@ void CryptoApiCommons::init_littlefs()
   }
   else
   {
-    ESP_LOGI(TAG, "Partition size: total: %d, used: %d", total, used);
+    ESP_LOGI(TAG, "Partition size: total: %zu, used: %zu", total, used);
   }
 }
 
 void CryptoApiCommons::close_littlefs()
 {
+  if (!littlefs_mounted)
+  {
+    return;
+  }
+
+  ScopedSpan span("unmount_littlefs", "fs");
   esp_vfs_littlefs_unregister(conf.partition_label);
+  littlefs_mounted = false;
 }
 
 void CryptoApiCommons::write_file(const char *file_path, const unsigned char *data)
 {
+  ScopedSpan span("write_file", "fs");
   // Open the file for writing
   FILE *file = fopen(file_path, "w");
   if (file != NULL)
@@ -109,6 +167,7 @@ void CryptoApiCommons::write_file(const char *file_path, const unsigned char *da
 
 void CryptoApiCommons::write_binary_file(const char *file_path, const unsigned char *data, size_t data_len)
 {
+  ScopedSpan span("write_binary_file", "fs");
   // Open the file for writing in binary mode
   FILE *file = fopen(file_path, "wb");
   if (file != NULL)
@@ -135,6 +194,7 @@ void CryptoApiCommons::write_binary_file(const char *file_path, const unsigned c
 
 void CryptoApiCommons::read_file(const char *file_path, unsigned char *buffer, size_t buffer_size)
 {
+  ScopedSpan span("read_file", "fs");
   FILE *file = fopen(file_path, "r");
   if (file != NULL)
   {
@@ -158,6 +218,7 @@ void CryptoApiCommons::read_file(const char *file_path, unsigned char *buffer, s
 
 long CryptoApiCommons::get_file_size(const char *file_path)
 {
+  ScopedSpan span("get_file_size", "fs");
   FILE *file = fopen(file_path, "rb");
   if (file == NULL)
   {
@@ -182,7 +243,11 @@ long CryptoApiCommons::get_file_size(const char *file_path)
 
 void CryptoApiCommons::log_success(const char *msg)
 {
+#if CRYPTO_API_DEFERRED_LOG
+  TraceLog::write(TRACE_SUCCESS, msg, 0);
+#else
   ESP_LOGI(TAG, "SUCCESS AT %s", msg);
+#endif
 }
 
 void CryptoApiCommons::log_error(const char *msg)
@@ -190,17 +255,240 @@ void CryptoApiCommons::log_error(const char *msg)
   ESP_LOGE(TAG, "Failed at %s", msg);
 }
 
-void CryptoApiCommons::print_elapsed_time(unsigned long start, unsigned long end, const char *label)
+void CryptoApiCommons::print_elapsed_time(const Timestamp &start, const Timestamp &end, const char *label)
 {
-  ESP_LOGI(TAG, "\n\n%s time: %lu ms", label, end - start);
+  uint64_t elapsed = elapsed_ns(start, end);
+#if CRYPTO_API_DEFERRED_LOG
+  TraceLog::write(TRACE_ELAPSED_NS, label, elapsed);
+#else
+  ESP_LOGI(TAG, "\n\n%s time: %llu.%03llu ms", label, (unsigned long long)(elapsed / 1000000), (unsigned long long)(elapsed / 1000 % 1000));
+#endif
+  pending_record(label, RECORD_ELAPSED).elapsed_ns = elapsed;
 }
 
 void CryptoApiCommons::print_used_memory(unsigned long initial, unsigned long final, const char *label)
 {
+#if CRYPTO_API_DEFERRED_LOG
+  TraceLog::write(TRACE_MEMORY_BYTES, label, initial - final);
+#else
   ESP_LOGI(TAG, "%s memory: %lu bytes", label, initial - final);
+#endif
+  pending_record(label, RECORD_MEMORY).peak_heap_bytes = initial - final;
+}
+
+void CryptoApiCommons::print_total_cycles(const Timestamp &start, const Timestamp &end, const char *label)
+{
+  uint64_t cycles = elapsed_cycles(start, end);
+#if CRYPTO_API_DEFERRED_LOG
+  TraceLog::write(TRACE_CYCLES, label, cycles);
+#else
+  ESP_LOGI(TAG, "%s clock cycle count: %llu", label, (unsigned long long)cycles);
+#endif
+  pending_record(label, RECORD_CYCLES).cycles = cycles;
+  if (pending_fields == RECORD_COMPLETE)
+  {
+    flush_results();
+  }
+}
+
+void CryptoApiCommons::print_allocations(const AllocationStats &stats, const char *label)
+{
+  ESP_LOGI(TAG, "%s allocations: %lu (%lu frees), peak %lu bytes, %lu bytes not freed",
+           label, (unsigned long)stats.allocations, (unsigned long)stats.frees, (unsigned long)stats.peak_bytes, (unsigned long)stats.leaked_bytes);
+  if (stats.untracked > 0)
+  {
+    ESP_LOGW(TAG, "%s: %lu allocations did not fit in the trace table", label, (unsigned long)stats.untracked);
+  }
+}
+
+Timestamp CryptoApiCommons::get_timestamp()
+{
+  if (cycles_per_us == 0)
+  {
+    calibrate_timer();
+  }
+  return read_clocks();
+}
+
+// The counter only holds the low 32 bits, so the number of wraps is taken
+// from esp_timer: of all counts with the same low bits, the one closest to
+// the esp_timer estimate is used.
+uint64_t CryptoApiCommons::elapsed_cycles(const Timestamp &start, const Timestamp &end)
+{
+  uint64_t cycles = (uint32_t)(end.cycles - start.cycles);
+  int64_t elapsed_us = end.time_us - start.time_us;
+  uint64_t estimate = elapsed_us > 0 ? (uint64_t)elapsed_us * cycles_per_us : 0;
+
+  if (estimate > cycles)
+  {
+    cycles += (estimate - cycles + (1ULL << 31)) & ~0xFFFFFFFFULL;
+  }
+
+  return cycles > probe_overhead_cycles ? cycles - probe_overhead_cycles : 0;
+}
+
+uint64_t CryptoApiCommons::elapsed_ns(const Timestamp &start, const Timestamp &end)
+{
+  return cycles_to_ns(elapsed_cycles(start, end));
+}
+
+uint64_t CryptoApiCommons::cycles_to_ns(uint64_t cycles)
+{
+  if (cycles_per_us == 0)
+  {
+    return 0;
+  }
+  return cycles * 1000 / cycles_per_us;
+}
+
+void CryptoApiCommons::calibrate_timer()
+{
+  Timestamp start = read_clocks();
+  Timestamp end = start;
+  while (end.time_us - start.time_us < TIMER_CALIBRATION_US)
+  {
+    end = read_clocks();
+  }
+  int64_t elapsed_us = end.time_us - start.time_us;
+  cycles_per_us = ((uint32_t)(end.cycles - start.cycles) + elapsed_us / 2) / elapsed_us;
+  if (cycles_per_us == 0)
+  {
+    cycles_per_us = 1;
+  }
+
+  uint32_t cheapest = UINT32_MAX;
+  for (int i = 0; i < TIMER_CALIBRATION_PROBES; i++)
+  {
+    Timestamp first = read_clocks();
+    Timestamp second = read_clocks();
+    uint32_t cost = second.cycles - first.cycles;
+    if (cost < cheapest)
+    {
+      cheapest = cost;
+    }
+  }
+  probe_overhead_cycles = cheapest;
+
+  ESP_LOGI(TAG, "Timer: %lu cycles per us, %lu cycles per probe", (unsigned long)cycles_per_us, (unsigned long)probe_overhead_cycles);
+}
+
+uint32_t CryptoApiCommons::get_probe_overhead_cycles()
+{
+  return probe_overhead_cycles;
+}
+
+// Returns the record being assembled for `label`. A new one is started when
+// the label changes or `field` has already been set, which is when the
+// previous operation's measurements are over.
+BenchmarkRecord &CryptoApiCommons::pending_record(const char *label, unsigned int field)
+{
+  if (pending_fields != 0 && ((pending_fields & field) != 0 || strncmp(pending.operation, label, BENCHMARK_OPERATION_MAX - 1) != 0))
+  {
+    flush_results();
+  }
+
+  if (pending_fields == 0)
+  {
+    memset(&pending, 0, sizeof(pending));
+    pending.library = chosen_library;
+    pending.algorithm = chosen_algorithm;
+    pending.hash = chosen_hash;
+    pending.message_length = message_length;
+    strncpy(pending.operation, label, BENCHMARK_OPERATION_MAX - 1);
+  }
+
+  pending_fields |= field;
+  return pending;
+}
+
+void CryptoApiCommons::flush_results()
+{
+  if (pending_fields != 0)
+  {
+    results.add(pending);
+    pending_fields = 0;
+  }
+}
+
+void CryptoApiCommons::clear_results()
+{
+  pending_fields = 0;
+  results.clear();
+}
+
+BenchmarkLog &CryptoApiCommons::get_results()
+{
+  return results;
 }
 
-void CryptoApiCommons::print_total_cycles(unsigned long initial, unsigned long final, const char *label)
+// Writes the records to `file_path`, or to stdout when it is NULL. Paths on
+// the LittleFS partition are mounted for the write if they are not already.
+int CryptoApiCommons::export_results(const char *file_path, ResultFormat format)
 {
-  ESP_LOGI(TAG, "%s clock cycle count: %lu", label, final - initial);
+  flush_results();
+
+  if (file_path == NULL)
+  {
+    return results.write(stdout, format);
+  }
+
+  bool mounted_here = false;
+  FILE *file = open_export(file_path, &mounted_here);
+  if (file == NULL)
+  {
+    return -1;
+  }
+  int ret = results.write(file, format);
+  close_export(file, mounted_here);
+  ESP_LOGI(TAG, "%u result records written to %s", (unsigned)results.size(), file_path);
+  return ret;
+}
+
+int CryptoApiCommons::export_spans(const char *file_path)
+{
+  if (file_path == NULL)
+  {
+    return SpanTrace::export_json(stdout);
+  }
+
+  bool mounted_here = false;
+  FILE *file = open_export(file_path, &mounted_here);
+  if (file == NULL)
+  {
+    return -1;
+  }
+  int ret = SpanTrace::export_json(file);
+  close_export(file, mounted_here);
+  ESP_LOGI(TAG, "%u spans written to %s", (unsigned)SpanTrace::size(), file_path);
+  return ret;
+}
+
+FILE *CryptoApiCommons::open_export(const char *file_path, bool *mounted_here)
+{
+  *mounted_here = false;
+  if (!littlefs_mounted && strncmp(file_path, "/littlefs/", strlen("/littlefs/")) == 0)
+  {
+    init_littlefs();
+    *mounted_here = littlefs_mounted;
+  }
+
+  FILE *file = fopen(file_path, "w");
+  if (file == NULL)
+  {
+    ESP_LOGE(TAG, "Failed to open %s for writing", file_path);
+    close_export(NULL, *mounted_here);
+  }
+  return file;
+}
+
+void CryptoApiCommons::close_export(FILE *file, bool mounted_here)
+{
+  if (file != NULL)
+  {
+    fclose(file);
+  }
+  if (mounted_here)
+  {
+    close_littlefs();
+  }
 }
\ No newline at end of file
@@ -0,0 +1,225 @@
+#include "CryptoJobQueue.h"
+
+static const char *TAG = "CryptoJobQueue";
+
+CryptoJobQueue::CryptoJobQueue(CryptoAPI &crypto_api) : crypto_api(crypto_api), free_jobs(NULL), pending_jobs(NULL), stopped(NULL), running(false)
+{
+  for (int i = 0; i < CRYPTO_API_JOB_QUEUE_LENGTH; i++)
+  {
+    jobs[i].done = NULL;
+  }
+}
+
+CryptoJobQueue::~CryptoJobQueue()
+{
+  close();
+}
+
+int CryptoJobQueue::init()
+{
+  if (running)
+  {
+    return 0;
+  }
+
+  // The pending queue has room for every job plus the stop marker, so neither
+  // submit nor close ever blocks on it.
+  free_jobs = xQueueCreate(CRYPTO_API_JOB_QUEUE_LENGTH, sizeof(CryptoJob *));
+  pending_jobs = xQueueCreate(CRYPTO_API_JOB_QUEUE_LENGTH + 1, sizeof(CryptoJob *));
+  stopped = xSemaphoreCreateBinary();
+  if (free_jobs == NULL || pending_jobs == NULL || stopped == NULL)
+  {
+    ESP_LOGE(TAG, "> Could not allocate the job queues.");
+    close();
+    return -1;
+  }
+
+  for (int i = 0; i < CRYPTO_API_JOB_QUEUE_LENGTH; i++)
+  {
+    jobs[i].done = xSemaphoreCreateBinary();
+    if (jobs[i].done == NULL)
+    {
+      ESP_LOGE(TAG, "> Could not allocate the job queues.");
+      close();
+      return -1;
+    }
+
+    CryptoJob *job = &jobs[i];
+    xQueueSend(free_jobs, &job, 0);
+  }
+
+#ifdef CONFIG_FREERTOS_UNICORE
+  BaseType_t core = tskNO_AFFINITY;
+#else
+  BaseType_t core = CRYPTO_API_JOB_WORKER_CORE;
+#endif
+  if (xTaskCreatePinnedToCore(worker_task, "crypto_jobs", CRYPTO_API_JOB_WORKER_STACK_SIZE, this, CRYPTO_API_JOB_WORKER_PRIORITY, NULL, core) != pdPASS)
+  {
+    ESP_LOGE(TAG, "> Could not start the worker task.");
+    close();
+    return -1;
+  }
+  running = true;
+
+  ESP_LOGI(TAG, "> Worker started on core %d, %d jobs.", (int)core, CRYPTO_API_JOB_QUEUE_LENGTH);
+  return 0;
+}
+
+void CryptoJobQueue::close()
+{
+  if (running)
+  {
+    CryptoJob *stop = NULL;
+    xQueueSend(pending_jobs, &stop, portMAX_DELAY);
+    xSemaphoreTake(stopped, portMAX_DELAY);
+    running = false;
+  }
+
+  for (int i = 0; i < CRYPTO_API_JOB_QUEUE_LENGTH; i++)
+  {
+    if (jobs[i].done != NULL)
+    {
+      vSemaphoreDelete(jobs[i].done);
+      jobs[i].done = NULL;
+    }
+  }
+
+  if (pending_jobs != NULL)
+  {
+    vQueueDelete(pending_jobs);
+    pending_jobs = NULL;
+  }
+  if (free_jobs != NULL)
+  {
+    vQueueDelete(free_jobs);
+    free_jobs = NULL;
+  }
+  if (stopped != NULL)
+  {
+    vSemaphoreDelete(stopped);
+    stopped = NULL;
+  }
+}
+
+CryptoJob *CryptoJobQueue::submit_sign(const unsigned char *message, size_t message_length, unsigned char *signature, size_t *signature_length, CryptoJobCallback callback, void *user_data)
+{
+  CryptoJob *job = take_free_job();
+  if (job == NULL)
+  {
+    return NULL;
+  }
+
+  job->type = CRYPTO_JOB_SIGN;
+  job->message = message;
+  job->message_length = message_length;
+  job->signature = signature;
+  job->signature_length = *signature_length;
+  job->signature_length_out = signature_length;
+  job->callback = callback;
+  job->user_data = user_data;
+  return submit(job);
+}
+
+CryptoJob *CryptoJobQueue::submit_verify(const unsigned char *message, size_t message_length, unsigned char *signature, size_t signature_length, CryptoJobCallback callback, void *user_data)
+{
+  CryptoJob *job = take_free_job();
+  if (job == NULL)
+  {
+    return NULL;
+  }
+
+  job->type = CRYPTO_JOB_VERIFY;
+  job->message = message;
+  job->message_length = message_length;
+  job->signature = signature;
+  job->signature_length = signature_length;
+  job->signature_length_out = NULL;
+  job->callback = callback;
+  job->user_data = user_data;
+  return submit(job);
+}
+
+bool CryptoJobQueue::poll(CryptoJob *job, int *status)
+{
+  if (xSemaphoreTake(job->done, 0) != pdPASS)
+  {
+    return false;
+  }
+
+  *status = job->status;
+  release(job);
+  return true;
+}
+
+int CryptoJobQueue::wait(CryptoJob *job, TickType_t ticks_to_wait)
+{
+  if (xSemaphoreTake(job->done, ticks_to_wait) != pdPASS)
+  {
+    return ESP_ERR_TIMEOUT;
+  }
+
+  int status = job->status;
+  release(job);
+  return status;
+}
+
+CryptoJob *CryptoJobQueue::take_free_job()
+{
+  CryptoJob *job = NULL;
+  if (free_jobs == NULL || xQueueReceive(free_jobs, &job, 0) != pdPASS)
+  {
+    ESP_LOGW(TAG, "> No free job, %d already in flight.", CRYPTO_API_JOB_QUEUE_LENGTH);
+    return NULL;
+  }
+  return job;
+}
+
+CryptoJob *CryptoJobQueue::submit(CryptoJob *job)
+{
+  job->status = 0;
+  xQueueSend(pending_jobs, &job, 0);
+  return job;
+}
+
+void CryptoJobQueue::release(CryptoJob *job)
+{
+  xQueueSend(free_jobs, &job, 0);
+}
+
+void CryptoJobQueue::worker_task(void *arg)
+{
+  ((CryptoJobQueue *)arg)->worker();
+  vTaskDelete(NULL);
+}
+
+// Runs jobs until close() queues the NULL stop marker. Nothing may touch the
+// queue object after `stopped` is given: close() deletes it right away.
+void CryptoJobQueue::worker()
+{
+  CryptoJob *job = NULL;
+
+  while (xQueueReceive(pending_jobs, &job, portMAX_DELAY) == pdPASS && job != NULL)
+  {
+    if (job->type == CRYPTO_JOB_SIGN)
+    {
+      job->status = crypto_api.sign(job->message, job->message_length, job->signature, &job->signature_length);
+      *job->signature_length_out = job->signature_length;
+    }
+    else
+    {
+      job->status = crypto_api.verify(job->message, job->message_length, job->signature, job->signature_length);
+    }
+
+    if (job->callback != NULL)
+    {
+      job->callback(job, job->status, job->user_data);
+      release(job);
+    }
+    else
+    {
+      xSemaphoreGive(job->done);
+    }
+  }
+
+  xSemaphoreGive(stopped);
+}
@@ -0,0 +1,101 @@
+#include "CryptoSession.h"
+
+static const char *TAG = "CryptoSession";
+
+CryptoSession::CryptoSession(CryptoAPI &crypto_api) : crypto_api(crypto_api), warm_opens(0), cold_opens(0)
+{
+  for (ResidentKeys &keys : resident)
+  {
+    keys.initialized = false;
+    keys.ready = false;
+  }
+}
+
+CryptoSession::~CryptoSession()
+{
+  close();
+}
+
+int CryptoSession::open(Libraries library, Algorithms algorithm, Hashes hash, size_t length_of_shake256, unsigned int rsa_key_size, int rsa_exponent)
+{
+  if (library == Libraries::MICROECC_LIB)
+  {
+    algorithm = Algorithms::ECDSA_SECP256R1;
+  }
+
+  ResidentKeys &keys = resident[library];
+  if (keys.ready && keys.algorithm == algorithm && (algorithm != Algorithms::RSA || keys.rsa_key_size == rsa_key_size))
+  {
+    int ret = crypto_api.bind(library, algorithm, hash, length_of_shake256);
+    if (ret != 0)
+    {
+      return ret;
+    }
+
+    keys.hash = hash;
+    keys.length_of_shake256 = length_of_shake256;
+    warm_opens++;
+    return 0;
+  }
+
+  // init() reuses the library context when the module already has one, so
+  // only the key object and the keys are rebuilt here.
+  keys.ready = false;
+  int ret = crypto_api.init(library, algorithm, hash, length_of_shake256);
+  keys.initialized = true;
+  keys.algorithm = algorithm;
+  keys.hash = hash;
+  keys.length_of_shake256 = length_of_shake256;
+  if (ret != 0)
+  {
+    return ret;
+  }
+
+  if (algorithm == Algorithms::RSA)
+  {
+    ret = crypto_api.gen_rsa_keys(rsa_key_size, rsa_exponent);
+  }
+  else
+  {
+    ret = crypto_api.gen_keys();
+  }
+  if (ret != 0)
+  {
+    return ret;
+  }
+
+  keys.ready = true;
+  keys.rsa_key_size = rsa_key_size;
+  cold_opens++;
+  ESP_LOGI(TAG, "> Keys resident for library %d, algorithm %d.", library, algorithm);
+  return 0;
+}
+
+void CryptoSession::close()
+{
+  for (int library = 0; library <= Libraries::MICROECC_LIB; library++)
+  {
+    ResidentKeys &keys = resident[library];
+    if (!keys.initialized)
+    {
+      continue;
+    }
+
+    if (crypto_api.bind((Libraries)library, keys.algorithm, keys.hash, keys.length_of_shake256) == 0)
+    {
+      crypto_api.close();
+    }
+    keys.initialized = false;
+    keys.ready = false;
+  }
+}
+
+unsigned long CryptoSession::get_warm_opens()
+{
+  return warm_opens;
+}
+
+unsigned long CryptoSession::get_cold_opens()
+{
+  return cold_opens;
+}
@@ -1,19 +1,27 @@
 #include "MbedtlsModule.h"
+#include "SpanTrace.h"
 #include <mbedtls/platform.h>
-#include <mbedtls/sha256.h>
 #include <mbedtls/error.h>
 #include <mbedtls/base64.h>
 
 static const char *TAG = "MbedtlsModule";
 
-MbedtlsModule::MbedtlsModule(CryptoApiCommons &commons) : commons(commons) {}
-
-int MbedtlsModule::init(Algorithms algorithm, Hashes hash, size_t _)
+#if CRYPTO_API_SPAN_TRACE
+// The DRBG callback handed to mbedtls, so its calls show up nested in the
+// key generation and signing spans
+static int drbg_random(void *ctr_drbg, unsigned char *output, size_t output_length)
 {
-  int initial_memory = esp_get_minimum_free_heap_size();
-  unsigned long start_time = esp_timer_get_time() / 1000;
-  size_t cycle_count_before = esp_cpu_get_cycle_count();
+  ScopedSpan span("ctr_drbg_random", "drbg");
+  return mbedtls_ctr_drbg_random(ctr_drbg, output, output_length);
+}
+#else
+#define drbg_random mbedtls_ctr_drbg_random
+#endif
+
+MbedtlsModule::MbedtlsModule(CryptoApiCommons &commons) : commons(commons), context_ready(false) {}
 
+int MbedtlsModule::init(Algorithms algorithm, Hashes hash, size_t)
+{
   commons.set_chosen_algorithm(algorithm);
   commons.set_chosen_hash(hash);
 
@@ -27,19 +35,33 @@ int MbedtlsModule::init(Algorithms algorithm, Hashes hash, size_t _)
     pk_type = MBEDTLS_PK_ECKEY;
   }
 
-  mbedtls_pk_init(&pk_ctx);
-  mbedtls_ctr_drbg_init(&ctr_drbg);
-  mbedtls_entropy_init(&entropy);
-
-  const unsigned char pers[] = "seed";
-
-  int ret = mbedtls_ctr_drbg_seed(&ctr_drbg, mbedtls_entropy_func, &entropy, pers, sizeof(pers));
-  if (ret != 0)
+  // The DRBG is seeded once and kept until close(); a later init() only
+  // replaces the key context.
+  int ret;
+  if (context_ready)
   {
-    commons.log_error("mbedtls_ctr_drbg_seed");
-    return ret;
+    mbedtls_pk_free(&pk_ctx);
+  }
+  else
+  {
+    mbedtls_ctr_drbg_init(&ctr_drbg);
+    mbedtls_entropy_init(&entropy);
+
+    const unsigned char pers[] = "seed";
+
+    ScopedSpan seed_span("ctr_drbg_seed", "drbg");
+    ret = mbedtls_ctr_drbg_seed(&ctr_drbg, mbedtls_entropy_func, &entropy, pers, sizeof(pers));
+    if (ret != 0)
+    {
+      commons.log_error("mbedtls_ctr_drbg_seed");
+      mbedtls_ctr_drbg_free(&ctr_drbg);
+      mbedtls_entropy_free(&entropy);
+      return ret;
+    }
+    context_ready = true;
   }
 
+  mbedtls_pk_init(&pk_ctx);
   ret = mbedtls_pk_setup(&pk_ctx, mbedtls_pk_info_from_type(pk_type));
   if (ret != 0)
   {
@@ -47,14 +69,6 @@ int MbedtlsModule::init(Algorithms algorithm, Hashes hash, size_t _)
     return ret;
   }
 
-  unsigned long end_time = esp_timer_get_time() / 1000;
-  int final_memory = esp_get_minimum_free_heap_size();
-  size_t cycle_count_after = esp_cpu_get_cycle_count();
-
-  // commons.print_elapsed_time(start_time, end_time, "init");
-  // commons.print_used_memory(initial_memory, final_memory, "init");
-  // commons.print_total_cycles(cycle_count_before, cycle_count_after, "init");
-
   commons.log_success("init");
   return 0;
 }
@@ -63,26 +77,17 @@ int MbedtlsModule::gen_keys()
 {
   mbedtls_ecp_group_id group_id = get_ecc_group_id();
 
-  heap_caps_monitor_local_minimum_free_size_start();
-  int initial_memory = esp_get_minimum_free_heap_size();
-  unsigned long start_time = esp_timer_get_time() / 1000;
-  unsigned long cycle_count_before = esp_cpu_get_cycle_count();
+  ScopedMeasure<MeasureTime, MeasureHeap, MeasureCycles> measure(commons, "mbedtls_gen_keys");
+  ScopedSpan span("ecp_gen_key", "pk");
 
-  int ret = mbedtls_ecp_gen_key(group_id, mbedtls_pk_ec(pk_ctx), mbedtls_ctr_drbg_random, &ctr_drbg);
+  int ret = mbedtls_ecp_gen_key(group_id, mbedtls_pk_ec(pk_ctx), drbg_random, &ctr_drbg);
   if (ret != 0)
   {
     commons.log_error("mbedtls_ecp_gen_key");
     return ret;
   }
 
-  unsigned long end_time = esp_timer_get_time() / 1000;
-  int final_memory = esp_get_minimum_free_heap_size();
-  unsigned long cycle_count_after = esp_cpu_get_cycle_count();
-  heap_caps_monitor_local_minimum_free_size_stop();
-
-  commons.print_elapsed_time(start_time, end_time, "mbedtls_gen_keys");
-  commons.print_used_memory(initial_memory, final_memory, "mbedtls_gen_keys");
-  commons.print_total_cycles(cycle_count_before, cycle_count_after, "mbedtls_gen_keys");
+  measure.stop();
 
   commons.log_success("gen_keys");
   return 0;
@@ -92,27 +97,17 @@ int MbedtlsModule::gen_rsa_keys(unsigned int rsa_key_size, int rsa_exponent)
 {
   this->rsa_key_size = rsa_key_size;
 
-  heap_caps_monitor_local_minimum_free_size_start();
-  int initial_memory = esp_get_minimum_free_heap_size();
-  unsigned long start_time = esp_timer_get_time() / 1000;
-
-  size_t cycle_count_before = esp_cpu_get_cycle_count();
+  ScopedMeasure<MeasureTime, MeasureHeap, MeasureCycles> measure(commons, "mbedtls_gen_keys");
+  ScopedSpan span("rsa_gen_key", "pk");
 
-  int ret = mbedtls_rsa_gen_key(mbedtls_pk_rsa(pk_ctx), mbedtls_ctr_drbg_random, &ctr_drbg, rsa_key_size, rsa_exponent);
+  int ret = mbedtls_rsa_gen_key(mbedtls_pk_rsa(pk_ctx), drbg_random, &ctr_drbg, rsa_key_size, rsa_exponent);
   if (ret != 0)
   {
     commons.log_error("mbedtls_rsa_gen_key");
     return ret;
   }
 
-  unsigned long end_time = esp_timer_get_time() / 1000;
-  int final_memory = esp_get_minimum_free_heap_size();
-  size_t cycle_count_after = esp_cpu_get_cycle_count();
-  heap_caps_monitor_local_minimum_free_size_stop();
-
-  commons.print_elapsed_time(start_time, end_time, "mbedtls_gen_keys");
-  commons.print_used_memory(initial_memory, final_memory, "mbedtls_gen_keys");
-  commons.print_total_cycles(cycle_count_before, cycle_count_after, "mbedtls_gen_keys");
+  measure.stop();
 
   commons.log_success("gen_keys");
   return 0;
@@ -120,46 +115,35 @@ int MbedtlsModule::gen_rsa_keys(unsigned int rsa_key_size, int rsa_exponent)
 
 int MbedtlsModule::sign(const unsigned char *message, size_t message_length, unsigned char *signature, size_t *signature_length)
 {
-  int hash_initial_memory = esp_get_minimum_free_heap_size();
-  unsigned long hash_start_time = esp_timer_get_time() / 1000;
+  ScopedMeasure<MeasureTime, MeasureHeap> hash_measure(commons, "hash_message");
 
   size_t hash_length = commons.get_hash_length();
   unsigned char *hash = (unsigned char *)malloc(hash_length * sizeof(unsigned char));
+  if (hash == NULL)
+  {
+    return -1;
+  }
 
   int ret = hash_message(message, message_length, hash);
   if (ret != 0)
   {
     commons.log_error("hash_message");
+    free(hash);
     return ret;
   }
 
-  unsigned long hash_end_time = esp_timer_get_time() / 1000;
-  int hash_final_memory = esp_get_minimum_free_heap_size();
-
-  commons.print_elapsed_time(hash_start_time, hash_end_time, "hash_message");
-  commons.print_used_memory(hash_initial_memory, hash_final_memory, "hash_message");
-
-  heap_caps_monitor_local_minimum_free_size_start();
-  int initial_memory = esp_get_minimum_free_heap_size();
-  unsigned long start_time = esp_timer_get_time() / 1000;
+  hash_measure.stop();
 
-  size_t cycle_count_before = esp_cpu_get_cycle_count();
+  ScopedMeasure<MeasureTime, MeasureHeap, MeasureCycles> measure(commons, "mbedtls_sign");
 
-  ret = mbedtls_pk_sign(&pk_ctx, get_hash_type(), hash, hash_length, signature, get_signature_size(), signature_length, mbedtls_ctr_drbg_random, &ctr_drbg);
+  ret = sign_hash(hash, hash_length, signature, signature_length);
   if (ret != 0)
   {
-    commons.log_error("mbedtls_pk_sign");
+    free(hash);
     return ret;
   }
 
-  unsigned long end_time = esp_timer_get_time() / 1000;
-  int final_memory = esp_get_minimum_free_heap_size();
-  size_t cycle_count_after = esp_cpu_get_cycle_count();
-  heap_caps_monitor_local_minimum_free_size_stop();
-
-  commons.print_elapsed_time(start_time, end_time, "mbedtls_sign");
-  commons.print_used_memory(initial_memory, final_memory, "mbedtls_sign");
-  commons.print_total_cycles(cycle_count_before, cycle_count_after, "mbedtls_sign");
+  measure.stop();
 
   free(hash);
 
@@ -167,57 +151,181 @@ int MbedtlsModule::sign(const unsigned char *message, size_t message_length, uns
   return 0;
 }
 
+int MbedtlsModule::sign_batch(const unsigned char *const *messages, const size_t *message_lengths, size_t count, unsigned char *const *signatures, size_t *signature_lengths)
+{
+  ScopedMeasure<MeasureTime, MeasureHeap, MeasureCycles> measure(commons, "mbedtls_sign_batch");
+
+  // One hash buffer serves the whole batch; the key context and DRBG are reused as they are
+  size_t hash_length = commons.get_hash_length();
+  unsigned char *hash = (unsigned char *)malloc(hash_length * sizeof(unsigned char));
+  if (hash == NULL)
+  {
+    return -1;
+  }
+
+  int ret = 0;
+  for (size_t i = 0; i < count && ret == 0; i++)
+  {
+    ret = hash_message(messages[i], message_lengths[i], hash);
+    if (ret != 0)
+    {
+      commons.log_error("hash_message");
+      break;
+    }
+
+    ret = sign_hash(hash, hash_length, signatures[i], &signature_lengths[i]);
+  }
+
+  free(hash);
+
+  if (ret != 0)
+  {
+    return ret;
+  }
+
+  measure.stop();
+
+  commons.log_success("sign_batch");
+  return 0;
+}
+
+int MbedtlsModule::sign_hash(const unsigned char *hash, size_t hash_length, unsigned char *signature, size_t *signature_length)
+{
+  ScopedSpan span("pk_sign", "pk");
+  // *signature_length is the capacity of `signature` on entry, as for wolfSSL;
+  // mbedtls_pk_sign() refuses a buffer too small for the key
+  int ret = mbedtls_pk_sign(&pk_ctx, get_hash_type(), hash, hash_length, signature, *signature_length, signature_length, drbg_random, &ctr_drbg);
+  if (ret != 0)
+  {
+    commons.log_error("mbedtls_pk_sign");
+  }
+  return ret;
+}
+
 int MbedtlsModule::verify(const unsigned char *message, size_t message_length, unsigned char *signature, size_t signature_length)
 {
-  int hash_initial_memory = esp_get_minimum_free_heap_size();
-  unsigned long hash_start_time = esp_timer_get_time() / 1000;
+  ScopedMeasure<MeasureTime, MeasureHeap> hash_measure(commons, "hash_message");
 
   size_t hash_length = commons.get_hash_length();
   unsigned char *hash = (unsigned char *)malloc(hash_length * sizeof(unsigned char));
+  if (hash == NULL)
+  {
+    return -1;
+  }
 
   int ret = hash_message(message, message_length, hash);
   if (ret != 0)
   {
     commons.log_error("hash_message");
+    free(hash);
     return ret;
   }
 
-  unsigned long hash_end_time = esp_timer_get_time() / 1000;
-  int hash_final_memory = esp_get_minimum_free_heap_size();
+  hash_measure.stop();
+
+  ScopedMeasure<MeasureTime, MeasureHeap, MeasureCycles> measure(commons, "mbedtls_verify");
 
-  commons.print_elapsed_time(hash_start_time, hash_end_time, "hash_message");
-  commons.print_used_memory(hash_initial_memory, hash_final_memory, "hash_message");
+  ret = verify_hash(hash, hash_length, signature, signature_length);
+  if (ret != 0)
+  {
+    free(hash);
+    return ret;
+  }
 
-  heap_caps_monitor_local_minimum_free_size_start();
-  int initial_memory = esp_get_minimum_free_heap_size();
-  unsigned long start_time = esp_timer_get_time() / 1000;
+  measure.stop();
 
-  size_t cycle_count_before = esp_cpu_get_cycle_count();
+  free(hash);
+
+  commons.log_success("verify");
+  return 0;
+}
 
-  ret = mbedtls_pk_verify(&pk_ctx, get_hash_type(), hash, hash_length, signature, signature_length);
+int MbedtlsModule::verify_hash(const unsigned char *hash, size_t hash_length, const unsigned char *signature, size_t signature_length)
+{
+  ScopedSpan span("pk_verify", "pk");
+  int ret = mbedtls_pk_verify(&pk_ctx, get_hash_type(), hash, hash_length, signature, signature_length);
   if (ret != 0)
   {
     commons.log_error("mbedtls_pk_verify");
+  }
+  return ret;
+}
+
+int MbedtlsModule::sign_init()
+{
+  return hash_starts(&stream_ctx);
+}
+
+int MbedtlsModule::sign_update(const unsigned char *data, size_t data_length)
+{
+  return hash_update(&stream_ctx, data, data_length);
+}
+
+int MbedtlsModule::sign_final(unsigned char *signature, size_t *signature_length)
+{
+  unsigned char hash[MBEDTLS_MD_MAX_SIZE];
+  size_t hash_length = get_digest_length();
+
+  int ret = hash_finish(&stream_ctx, hash);
+  if (ret != 0)
+  {
+    commons.log_error("hash_finish");
     return ret;
   }
 
-  unsigned long end_time = esp_timer_get_time() / 1000;
-  int final_memory = esp_get_minimum_free_heap_size();
-  size_t cycle_count_after = esp_cpu_get_cycle_count();
-  heap_caps_monitor_local_minimum_free_size_stop();
+  ScopedMeasure<MeasureTime, MeasureHeap, MeasureCycles> measure(commons, "mbedtls_sign");
 
-  commons.print_elapsed_time(start_time, end_time, "mbedtls_verify");
-  commons.print_used_memory(initial_memory, final_memory, "mbedtls_verify");
-  commons.print_total_cycles(cycle_count_before, cycle_count_after, "mbedtls_verify");
+  ret = sign_hash(hash, hash_length, signature, signature_length);
+  if (ret != 0)
+  {
+    return ret;
+  }
 
-  free(hash);
+  measure.stop();
 
-  commons.log_success("verify");
+  commons.log_success("sign_final");
+  return 0;
+}
+
+int MbedtlsModule::verify_init()
+{
+  return hash_starts(&stream_ctx);
+}
+
+int MbedtlsModule::verify_update(const unsigned char *data, size_t data_length)
+{
+  return hash_update(&stream_ctx, data, data_length);
+}
+
+int MbedtlsModule::verify_final(unsigned char *signature, size_t signature_length)
+{
+  unsigned char hash[MBEDTLS_MD_MAX_SIZE];
+  size_t hash_length = get_digest_length();
+
+  int ret = hash_finish(&stream_ctx, hash);
+  if (ret != 0)
+  {
+    commons.log_error("hash_finish");
+    return ret;
+  }
+
+  ScopedMeasure<MeasureTime, MeasureHeap, MeasureCycles> measure(commons, "mbedtls_verify");
+
+  ret = verify_hash(hash, hash_length, signature, signature_length);
+  if (ret != 0)
+  {
+    return ret;
+  }
+
+  measure.stop();
+
+  commons.log_success("verify_final");
   return 0;
 }
 
 int MbedtlsModule::hash_message(const unsigned char *message, size_t message_length, unsigned char *hash)
 {
+  ScopedSpan span("hash_message", "hash");
   switch (commons.get_chosen_hash())
   {
   case Hashes::MY_SHA_256:
@@ -231,6 +339,68 @@ int MbedtlsModule::hash_message(const unsigned char *message, size_t message_len
   }
 }
 
+// hash_starts/hash_update/hash_finish produce the same digest as
+// hash_message, with the message fed in pieces.
+int MbedtlsModule::hash_starts(MbedtlsHashContext *ctx)
+{
+  switch (commons.get_chosen_hash())
+  {
+  case Hashes::MY_SHA_512:
+    mbedtls_sha512_init(&ctx->sha512);
+    return mbedtls_sha512_starts(&ctx->sha512, 0);
+  case Hashes::MY_SHA3_256:
+    mbedtls_sha3_init(&ctx->sha3);
+    return mbedtls_sha3_starts(&ctx->sha3, MBEDTLS_SHA3_256);
+  case Hashes::MY_SHA_256:
+  default:
+    mbedtls_sha256_init(&ctx->sha256);
+    return mbedtls_sha256_starts(&ctx->sha256, 0);
+  }
+}
+
+int MbedtlsModule::hash_update(MbedtlsHashContext *ctx, const unsigned char *data, size_t data_length)
+{
+  ScopedSpan span("hash_update", "hash");
+  switch (commons.get_chosen_hash())
+  {
+  case Hashes::MY_SHA_512:
+    return mbedtls_sha512_update(&ctx->sha512, data, data_length);
+  case Hashes::MY_SHA3_256:
+    return mbedtls_sha3_update(&ctx->sha3, data, data_length);
+  case Hashes::MY_SHA_256:
+  default:
+    return mbedtls_sha256_update(&ctx->sha256, data, data_length);
+  }
+}
+
+int MbedtlsModule::hash_finish(MbedtlsHashContext *ctx, unsigned char *hash)
+{
+  ScopedSpan span("hash_finish", "hash");
+  int ret;
+  switch (commons.get_chosen_hash())
+  {
+  case Hashes::MY_SHA_512:
+    ret = mbedtls_sha512_finish(&ctx->sha512, hash);
+    mbedtls_sha512_free(&ctx->sha512);
+    return ret;
+  case Hashes::MY_SHA3_256:
+    ret = mbedtls_sha3_finish(&ctx->sha3, hash, 32);
+    mbedtls_sha3_free(&ctx->sha3);
+    return ret;
+  case Hashes::MY_SHA_256:
+  default:
+    ret = mbedtls_sha256_finish(&ctx->sha256, hash);
+    mbedtls_sha256_free(&ctx->sha256);
+    return ret;
+  }
+}
+
+// SHAKE256 is not available in mbedtls and falls back to SHA-256, as in hash_message
+size_t MbedtlsModule::get_digest_length()
+{
+  return commons.get_chosen_hash() == Hashes::MY_SHA_512 ? 64 : 32;
+}
+
 mbedtls_md_type_t MbedtlsModule::get_hash_type()
 {
   switch (commons.get_chosen_hash())
@@ -263,6 +433,7 @@ mbedtls_ecp_group_id MbedtlsModule::get_ecc_group_id()
 
 int MbedtlsModule::get_public_key_pem(unsigned char *public_key_pem)
 {
+  ScopedSpan span("write_pubkey_pem", "encode");
   int ret = mbedtls_pk_write_pubkey_pem(&pk_ctx, public_key_pem, get_public_key_pem_size());
   if (ret != 0)
   {
@@ -281,9 +452,15 @@ int MbedtlsModule::get_signature_size()
 
 void MbedtlsModule::close()
 {
+  if (!context_ready)
+  {
+    return;
+  }
+
   mbedtls_pk_free(&pk_ctx);
   mbedtls_ctr_drbg_free(&ctr_drbg);
   mbedtls_entropy_free(&entropy);
+  context_ready = false;
   ESP_LOGI(TAG, "> mbedtls closed.");
 }
 
@@ -294,6 +471,7 @@ int MbedtlsModule::base64_encode(unsigned char *dst, size_t dlen, size_t *olen,
 
 void MbedtlsModule::save_private_key(const char *file_path, unsigned char *private_key, size_t private_key_size)
 {
+  ScopedSpan span("save_private_key", "encode");
   int ret = mbedtls_pk_write_key_pem(&pk_ctx, private_key, private_key_size);
   if (ret == 0)
   {
@@ -307,6 +485,7 @@ void MbedtlsModule::save_private_key(const char *file_path, unsigned char *priva
 
 void MbedtlsModule::save_public_key(const char *file_path, unsigned char *public_key, size_t public_key_size)
 {
+  ScopedSpan span("save_public_key", "encode");
   int ret = mbedtls_pk_write_pubkey_pem(&pk_ctx, public_key, public_key_size);
   if (ret == 0)
   {
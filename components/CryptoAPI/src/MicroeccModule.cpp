@@ -1,41 +1,34 @@
 #include "MicroeccModule.h"
 #include "MbedtlsModule.h"
+#include "SpanTrace.h"
 #include "esp_random.h"
 #include <string.h>
 
 static const char *TAG = "MicroeccModule";
 
-MicroeccModule::MicroeccModule(CryptoApiCommons &commons, MbedtlsModule &mbedtls_module) : commons(commons), mbedtls_module(mbedtls_module)
+MicroeccModule::MicroeccModule(CryptoApiCommons &commons, MbedtlsModule &mbedtls_module) : commons(commons), mbedtls_module(mbedtls_module), private_key(NULL), public_key(NULL),
+      key_cache(MY_ECC_256_PUBLIC_KEY_SIZE, uECC_verify_precomp_size(), CRYPTO_API_KEY_CACHE_BYTES)
 {
+#if uECC_ENABLE_OP_COUNTERS
+  last_op_counters = uECC_OpCounters();
+#endif
 }
 
 const struct uECC_Curve_t *curve = uECC_secp256r1();
 
-int MicroeccModule::init(Algorithms _, Hashes hash, size_t __)
+int MicroeccModule::init(Algorithms, Hashes hash, size_t)
 {
-  int initial_memory = esp_get_minimum_free_heap_size();
-  unsigned long start_time = esp_timer_get_time() / 1000;
-  unsigned long cycle_count_before = esp_cpu_get_cycle_count();
-
   commons.set_chosen_hash(hash);
 
   unsigned int seed = esp_random();
   srandom(seed);
   uECC_set_rng(&MicroeccModule::rng_function);
 
-  unsigned long end_time = esp_timer_get_time() / 1000;
-  int final_memory = esp_get_minimum_free_heap_size();
-  unsigned long cycle_count_after = esp_cpu_get_cycle_count();
-
-  // commons.print_elapsed_time(start_time, end_time, "init");
-  // commons.print_used_memory(initial_memory, final_memory, "init");
-  // commons.print_total_cycles(cycle_count_before, cycle_count_after, "init");
-
   commons.log_success("init");
   return 0;
 }
 
-int MicroeccModule::gen_rsa_keys(unsigned int rsa_key_size, int rsa_exponent)
+int MicroeccModule::gen_rsa_keys(unsigned int, int)
 {
   return -1;
 }
@@ -47,35 +40,33 @@ int MicroeccModule::get_signature_size()
 
 int MicroeccModule::gen_keys()
 {
-  heap_caps_monitor_local_minimum_free_size_start();
-  int initial_memory = esp_get_minimum_free_heap_size();
-  unsigned long start_time = esp_timer_get_time() / 1000;
-  unsigned long cycle_count_before = esp_cpu_get_cycle_count();
+  ScopedMeasure<MeasureTime, MeasureHeap, MeasureCycles> measure(commons, "micro_gen_keys");
 
   size_t private_key_size = MY_ECC_256_PRIVATE_KEY_SIZE;
   size_t public_key_size = MY_ECC_256_PUBLIC_KEY_SIZE;
 
-  private_key = (unsigned char *)malloc(private_key_size * sizeof(unsigned char));
-  public_key = (unsigned char *)malloc(public_key_size * sizeof(unsigned char));
+  // Key buffers are kept until close(), so generating again reuses them
+  if (private_key == NULL)
+  {
+    private_key = (unsigned char *)malloc(private_key_size * sizeof(unsigned char));
+    public_key = (unsigned char *)malloc(public_key_size * sizeof(unsigned char));
+  }
 
+  ScopedSpan span("uECC_make_key", "pk");
+  start_op_count();
   int ret = uECC_make_key(public_key, private_key, uECC_secp256r1());
+  stop_op_count();
   if (ret == 0)
   {
     commons.log_error("uECC_make_key");
     return -1;
   }
 
-  unsigned long end_time = esp_timer_get_time() / 1000;
-  int final_memory = esp_get_minimum_free_heap_size();
-  unsigned long cycle_count_after = esp_cpu_get_cycle_count();
-  heap_caps_monitor_local_minimum_free_size_stop();
-
-  commons.print_elapsed_time(start_time, end_time, "micro_gen_keys");
-  commons.print_used_memory(initial_memory, final_memory, "micro_gen_keys");
-  commons.print_total_cycles(cycle_count_before, cycle_count_after, "micro_gen_keys");
+  measure.stop();
+  log_op_counters("gen_keys");
 
-  ESP_LOG_BUFFER_HEX("public_key", this->public_key, public_key_size);
-  ESP_LOG_BUFFER_HEX("private_key", this->private_key, private_key_size);
+  ESP_LOG_BUFFER_HEX_LEVEL("public_key", this->public_key, public_key_size, ESP_LOG_DEBUG);
+  ESP_LOG_BUFFER_HEX_LEVEL("private_key", this->private_key, private_key_size, ESP_LOG_DEBUG);
 
   commons.log_success("gen_keys");
   return 0;
@@ -88,6 +79,7 @@ int MicroeccModule::get_public_key_pem(unsigned char *public_key_pem)
 
 int MicroeccModule::public_key_to_pem_format(unsigned char *public_key_buffer)
 {
+  ScopedSpan span("public_key_pem", "encode");
   size_t base64_len = 89;
   unsigned char *base64_output = (unsigned char *)malloc(base64_len * sizeof(unsigned char));
 
@@ -122,6 +114,7 @@ size_t MicroeccModule::get_public_key_pem_size()
 
 int MicroeccModule::private_key_to_pem_format(unsigned char *private_key_buffer)
 {
+  ScopedSpan span("private_key_pem", "encode");
   size_t base64_len = 89; // Adjust size based on expected private key size
   unsigned char *base64_output = (unsigned char *)malloc(base64_len * sizeof(unsigned char));
 
@@ -154,104 +147,344 @@ int MicroeccModule::private_key_to_pem_format(unsigned char *private_key_buffer)
 
 int MicroeccModule::sign(const unsigned char *message, size_t message_length, unsigned char *signature, size_t *_)
 {
-  int hash_initial_memory = esp_get_minimum_free_heap_size();
-  unsigned long hash_start_time = esp_timer_get_time() / 1000;
+  ScopedMeasure<MeasureTime, MeasureHeap> hash_measure(commons, "hash_message");
 
   size_t hash_length = commons.get_hash_length();
   unsigned char *hash = (unsigned char *)malloc(hash_length * sizeof(unsigned char));
+  if (hash == NULL)
+  {
+    return -1;
+  }
 
   int ret = mbedtls_module.hash_message(message, message_length, hash);
   if (ret != 0)
   {
     commons.log_error("hash_message");
+    free(hash);
     return ret;
   }
 
-  unsigned long hash_end_time = esp_timer_get_time() / 1000;
-  int hash_final_memory = esp_get_minimum_free_heap_size();
+  hash_measure.stop();
 
-  commons.print_elapsed_time(hash_start_time, hash_end_time, "hash_message");
-  commons.print_used_memory(hash_initial_memory, hash_final_memory, "hash_message");
+  ScopedMeasure<MeasureTime, MeasureHeap, MeasureCycles> measure(commons, "micro_sign");
 
-  heap_caps_monitor_local_minimum_free_size_start();
-  int initial_memory = esp_get_minimum_free_heap_size();
-  unsigned long start_time = esp_timer_get_time() / 1000;
-  unsigned long cycle_count_before = esp_cpu_get_cycle_count();
+  ret = sign_hash(hash, hash_length, signature, _);
+  if (ret != 0)
+  {
+    free(hash);
+    return ret;
+  }
 
-  ret = uECC_sign(private_key, hash, hash_length, signature, uECC_secp256r1());
-  if (ret == 0)
+  measure.stop();
+  log_op_counters("sign");
+
+  free(hash);
+
+  commons.log_success("sign");
+  return 0;
+}
+
+int MicroeccModule::sign_batch(const unsigned char *const *messages, const size_t *message_lengths, size_t count, unsigned char *const *signatures, size_t *signature_lengths)
+{
+  ScopedMeasure<MeasureTime, MeasureHeap, MeasureCycles> measure(commons, "micro_sign_batch");
+
+  // One hash buffer serves the whole batch; the private key stays loaded
+  size_t hash_length = commons.get_hash_length();
+  unsigned char *hash = (unsigned char *)malloc(hash_length * sizeof(unsigned char));
+  if (hash == NULL)
   {
-    commons.log_error("uECC_sign");
     return -1;
   }
 
-  unsigned long end_time = esp_timer_get_time() / 1000;
-  int final_memory = esp_get_minimum_free_heap_size();
-  unsigned long cycle_count_after = esp_cpu_get_cycle_count();
-  heap_caps_monitor_local_minimum_free_size_stop();
-
-  commons.print_elapsed_time(start_time, end_time, "micro_sign");
-  commons.print_used_memory(initial_memory, final_memory, "micro_sign");
-  commons.print_total_cycles(cycle_count_before, cycle_count_after, "mbedtls_gen_keys");
+  int ret = 0;
+  for (size_t i = 0; i < count && ret == 0; i++)
+  {
+    ret = mbedtls_module.hash_message(messages[i], message_lengths[i], hash);
+    if (ret != 0)
+    {
+      commons.log_error("hash_message");
+      break;
+    }
+
+    ret = sign_hash(hash, hash_length, signatures[i], &signature_lengths[i]);
+  }
 
   free(hash);
 
-  commons.log_success("sign");
+  if (ret != 0)
+  {
+    return ret;
+  }
+
+  measure.stop();
+
+  commons.log_success("sign_batch");
   return 0;
 }
 
-int MicroeccModule::verify(const unsigned char *message, size_t message_length, unsigned char *signature, size_t __)
+size_t MicroeccModule::get_digest_length()
+{
+  return mbedtls_module.get_digest_length();
+}
+
+int MicroeccModule::hash_message(const unsigned char *message, size_t message_length, unsigned char *hash)
 {
-  int hash_initial_memory = esp_get_minimum_free_heap_size();
-  unsigned long hash_start_time = esp_timer_get_time() / 1000;
+  return mbedtls_module.hash_message(message, message_length, hash);
+}
+
+// The signature is always the raw 64-byte r || s; signature_length, when
+// given, is set to that.
+int MicroeccModule::sign_hash(const unsigned char *hash, size_t hash_length, unsigned char *signature, size_t *signature_length)
+{
+  ScopedSpan span("uECC_sign", "pk");
+  start_op_count();
+  int ret = uECC_sign(private_key, hash, hash_length, signature, curve);
+  stop_op_count();
+  if (ret == 0)
+  {
+    commons.log_error("uECC_sign");
+    return -1;
+  }
+  if (signature_length != NULL)
+  {
+    *signature_length = get_signature_size();
+  }
+  return 0;
+}
+
+int MicroeccModule::verify(const unsigned char *message, size_t message_length, unsigned char *signature, size_t)
+{
+  ScopedMeasure<MeasureTime, MeasureHeap> hash_measure(commons, "hash_message");
 
   size_t hash_length = commons.get_hash_length();
   unsigned char *hash = (unsigned char *)malloc(hash_length * sizeof(unsigned char));
+  if (hash == NULL)
+  {
+    return -1;
+  }
 
   int ret = mbedtls_module.hash_message(message, message_length, hash);
   if (ret != 0)
   {
     commons.log_error("hash_message");
+    free(hash);
     return ret;
   }
 
-  unsigned long hash_end_time = esp_timer_get_time() / 1000;
-  int hash_final_memory = esp_get_minimum_free_heap_size();
+  hash_measure.stop();
 
-  commons.print_elapsed_time(hash_start_time, hash_end_time, "hash_message");
-  commons.print_used_memory(hash_initial_memory, hash_final_memory, "hash_message");
+  ScopedMeasure<MeasureTime, MeasureHeap, MeasureCycles> measure(commons, "micro_verify");
 
-  heap_caps_monitor_local_minimum_free_size_start();
-  int initial_memory = esp_get_minimum_free_heap_size();
-  unsigned long start_time = esp_timer_get_time() / 1000;
-  unsigned long cycle_count_before = esp_cpu_get_cycle_count();
+  ret = verify_hash(hash, hash_length, signature);
+  if (ret != 0)
+  {
+    free(hash);
+    return ret;
+  }
+
+  measure.stop();
+  log_op_counters("verify");
+
+  free(hash);
+
+  commons.log_success("verify");
+  return 0;
+}
 
-  ret = uECC_verify(public_key, hash, hash_length, signature, uECC_secp256r1());
+int MicroeccModule::verify_hash(const unsigned char *hash, size_t hash_length, const unsigned char *signature)
+{
+  ScopedSpan span("uECC_verify", "pk");
+  start_op_count();
+  int ret = uECC_verify(public_key, hash, hash_length, signature, curve);
+  stop_op_count();
   if (ret != 1)
   {
     commons.log_error("uECC_verify");
     return -1;
   }
+  return 0;
+}
+
+// The streaming calls hash through the mbedtls module, same as sign/verify
+int MicroeccModule::sign_init()
+{
+  return mbedtls_module.hash_starts(&stream_ctx);
+}
+
+int MicroeccModule::sign_update(const unsigned char *data, size_t data_length)
+{
+  return mbedtls_module.hash_update(&stream_ctx, data, data_length);
+}
+
+int MicroeccModule::sign_final(unsigned char *signature, size_t *_)
+{
+  unsigned char hash[MBEDTLS_MD_MAX_SIZE];
+  size_t hash_length = mbedtls_module.get_digest_length();
+
+  int ret = mbedtls_module.hash_finish(&stream_ctx, hash);
+  if (ret != 0)
+  {
+    commons.log_error("hash_finish");
+    return ret;
+  }
+
+  ScopedMeasure<MeasureTime, MeasureHeap, MeasureCycles> measure(commons, "micro_sign");
+
+  ret = sign_hash(hash, hash_length, signature, _);
+  if (ret != 0)
+  {
+    return ret;
+  }
+
+  measure.stop();
+  log_op_counters("sign_final");
+
+  commons.log_success("sign_final");
+  return 0;
+}
+
+int MicroeccModule::verify_init()
+{
+  return mbedtls_module.hash_starts(&stream_ctx);
+}
+
+int MicroeccModule::verify_update(const unsigned char *data, size_t data_length)
+{
+  return mbedtls_module.hash_update(&stream_ctx, data, data_length);
+}
+
+int MicroeccModule::verify_final(unsigned char *signature, size_t)
+{
+  unsigned char hash[MBEDTLS_MD_MAX_SIZE];
+  size_t hash_length = mbedtls_module.get_digest_length();
+
+  int ret = mbedtls_module.hash_finish(&stream_ctx, hash);
+  if (ret != 0)
+  {
+    commons.log_error("hash_finish");
+    return ret;
+  }
+
+  ScopedMeasure<MeasureTime, MeasureHeap, MeasureCycles> measure(commons, "micro_verify");
+
+  ret = verify_hash(hash, hash_length, signature);
+  if (ret != 0)
+  {
+    return ret;
+  }
+
+  measure.stop();
+  log_op_counters("verify_final");
+
+  commons.log_success("verify_final");
+  return 0;
+}
+
+int MicroeccModule::verify_batch(const unsigned char *public_keys, const unsigned char *digests, size_t digest_length, const unsigned char *signatures, size_t count, unsigned char *results)
+{
+  ScopedMeasure<MeasureTime, MeasureHeap, MeasureCycles> measure(commons, "micro_verify_batch");
+  ScopedSpan span("uECC_verify_batch", "pk");
+
+  start_op_count();
+  int ret = uECC_verify_batch(public_keys, digests, digest_length, signatures, count, curve, results);
+  stop_op_count();
+  if (ret != 1)
+  {
+    commons.log_error("uECC_verify_batch");
+    return -1;
+  }
 
-  unsigned long end_time = esp_timer_get_time() / 1000;
-  int final_memory = esp_get_minimum_free_heap_size();
-  unsigned long cycle_count_after = esp_cpu_get_cycle_count();
-  heap_caps_monitor_local_minimum_free_size_stop();
+  measure.stop();
+  log_op_counters("verify_batch");
 
-  commons.print_elapsed_time(start_time, end_time, "micro_verify");
-  commons.print_used_memory(initial_memory, final_memory, "micro_verify");
-  commons.print_total_cycles(cycle_count_before, cycle_count_after, "mbedtls_gen_keys");
+  commons.log_success("verify_batch");
+  return 0;
+}
+
+int MicroeccModule::verify_with_key(const unsigned char *public_key, const unsigned char *message, size_t message_length, const unsigned char *signature)
+{
+  ScopedMeasure<MeasureTime, MeasureHeap> hash_measure(commons, "hash_message");
 
+  size_t hash_length = commons.get_hash_length();
+  unsigned char *hash = (unsigned char *)malloc(hash_length * sizeof(unsigned char));
+  if (hash == NULL)
+  {
+    return -1;
+  }
+
+  int ret = mbedtls_module.hash_message(message, message_length, hash);
+  if (ret != 0)
+  {
+    commons.log_error("hash_message");
+    free(hash);
+    return ret;
+  }
+
+  hash_measure.stop();
+
+  ScopedMeasure<MeasureTime, MeasureHeap, MeasureCycles> measure(commons, "micro_verify_key");
+
+  ret = verify_hash_with_key(public_key, hash, hash_length, signature);
   free(hash);
+  if (ret != 0)
+  {
+    return ret;
+  }
 
-  commons.log_success("verify");
+  measure.stop();
+  log_op_counters("verify_with_key");
+
+  commons.log_success("verify_with_key");
+  return 0;
+}
+
+int MicroeccModule::verify_hash_with_key(const unsigned char *public_key, const unsigned char *hash, size_t hash_length, const unsigned char *signature)
+{
+  ScopedSpan span("uECC_verify_precomputed", "pk");
+  start_op_count();
+
+  // A miss computes the key's multiples into the slot it is given; with no
+  // room at all (a budget of 0) it falls back to plain uECC_verify()
+  unsigned char *precomp = key_cache.find(public_key);
+  if (precomp == NULL)
+  {
+    precomp = key_cache.insert(public_key);
+    if (precomp != NULL && !uECC_verify_precompute(public_key, precomp, curve))
+    {
+      key_cache.remove(public_key);
+      stop_op_count();
+      commons.log_error("uECC_verify_precompute");
+      return -1;
+    }
+  }
+
+  int ret = precomp != NULL ? uECC_verify_precomputed(precomp, hash, hash_length, signature, curve)
+                            : uECC_verify(public_key, hash, hash_length, signature, curve);
+  stop_op_count();
+  if (ret != 1)
+  {
+    commons.log_error("uECC_verify_precomputed");
+    return -1;
+  }
   return 0;
 }
 
+KeyCacheStats MicroeccModule::get_key_cache_stats()
+{
+  return key_cache.get_stats();
+}
+
+void MicroeccModule::clear_key_cache()
+{
+  key_cache.clear();
+}
+
 void MicroeccModule::close()
 {
   free(private_key);
   free(public_key);
+  private_key = NULL;
+  public_key = NULL;
   ESP_LOGI(TAG, "> microecc closed.");
 }
 
@@ -265,8 +498,43 @@ size_t MicroeccModule::get_private_key_size()
   return MY_ECC_256_PRIVATE_KEY_SIZE;
 }
 
+// With uECC_ENABLE_OP_COUNTERS (CONFIG_UECC_ENABLE_OP_COUNTERS), counts
+// the field operations of the micro-ecc call between start and stop
+void MicroeccModule::start_op_count()
+{
+#if uECC_ENABLE_OP_COUNTERS
+  uECC_reset_op_counters();
+#endif
+}
+
+void MicroeccModule::stop_op_count()
+{
+#if uECC_ENABLE_OP_COUNTERS
+  uECC_get_op_counters(&last_op_counters);
+#endif
+}
+
+void MicroeccModule::log_op_counters(const char *label)
+{
+#if uECC_ENABLE_OP_COUNTERS
+  ESP_LOGI(TAG, "%s field ops: %lu mult, %lu square, %lu inv, %lu double, %lu add, %lu addC, %lu affine", label,
+           (unsigned long)last_op_counters.mod_mult, (unsigned long)last_op_counters.mod_square,
+           (unsigned long)last_op_counters.mod_inv, (unsigned long)last_op_counters.double_jacobian,
+           (unsigned long)last_op_counters.xycz_add, (unsigned long)last_op_counters.xycz_addc,
+           (unsigned long)last_op_counters.affine_add);
+#endif
+}
+
+#if uECC_ENABLE_OP_COUNTERS
+uECC_OpCounters MicroeccModule::get_last_op_counters()
+{
+  return last_op_counters;
+}
+#endif
+
 int MicroeccModule::rng_function(unsigned char *dest, unsigned int size)
 {
+  ScopedSpan span("esp_random", "drbg");
   // Fill dest with `size` random bytes
   while (size--)
   {
@@ -275,7 +543,7 @@ int MicroeccModule::rng_function(unsigned char *dest, unsigned int size)
   return 1; // Return 1 to indicate success
 }
 
-void MicroeccModule::save_private_key(const char *file_path, unsigned char *private_key, size_t _)
+void MicroeccModule::save_private_key(const char *file_path, unsigned char *private_key, size_t)
 {
   int ret = private_key_to_pem_format(private_key);
   if (ret == 0)
@@ -288,7 +556,7 @@ void MicroeccModule::save_private_key(const char *file_path, unsigned char *priv
   }
 }
 
-void MicroeccModule::save_public_key(const char *file_path, unsigned char *public_key, size_t _)
+void MicroeccModule::save_public_key(const char *file_path, unsigned char *public_key, size_t)
 {
   int ret = public_key_to_pem_format(public_key);
   if (ret == 0)
@@ -0,0 +1,140 @@
+#include "SignPipeline.h"
+
+static const char *TAG = "SignPipeline";
+
+SignPipeline::SignPipeline(CryptoApiCommons &commons, ICryptoModule &module) : commons(commons), module(module), messages(NULL), message_lengths(NULL), count(0), digests(NULL), digest_length(0), free_slots(NULL), ready_slots(NULL), aborted(false)
+{
+}
+
+int SignPipeline::run(const unsigned char *const *messages, const size_t *message_lengths, size_t count, unsigned char *const *signatures, size_t *signature_lengths)
+{
+  if (count == 0)
+  {
+    return 0;
+  }
+
+  this->messages = messages;
+  this->message_lengths = message_lengths;
+  this->count = count;
+  this->aborted = false;
+
+  ScopedMeasure<MeasureTime, MeasureHeap, MeasureCycles> measure(commons, "sign_pipelined");
+
+  // The ready queue has room for every slot plus the end marker, so the hash
+  // task never blocks on it and is gone once the marker has been received.
+  digest_length = module.get_digest_length();
+  digests = (unsigned char *)malloc(CRYPTO_API_PIPELINE_DEPTH * digest_length * sizeof(unsigned char));
+  free_slots = xQueueCreate(CRYPTO_API_PIPELINE_DEPTH, sizeof(int));
+  ready_slots = xQueueCreate(CRYPTO_API_PIPELINE_DEPTH + 1, sizeof(PipelineItem));
+
+  int ret = -1;
+  if (digests == NULL || free_slots == NULL || ready_slots == NULL)
+  {
+    ESP_LOGE(TAG, "> Could not allocate the pipeline buffers.");
+  }
+  else
+  {
+    for (int slot = 0; slot < CRYPTO_API_PIPELINE_DEPTH; slot++)
+    {
+      xQueueSend(free_slots, &slot, 0);
+    }
+
+#ifdef CONFIG_FREERTOS_UNICORE
+    BaseType_t core = tskNO_AFFINITY;
+#else
+    BaseType_t core = CRYPTO_API_PIPELINE_HASH_CORE;
+#endif
+    if (xTaskCreatePinnedToCore(hash_task, "crypto_hash", CRYPTO_API_PIPELINE_HASH_STACK_SIZE, this, uxTaskPriorityGet(NULL), NULL, core) != pdPASS)
+    {
+      commons.log_error("xTaskCreatePinnedToCore");
+    }
+    else
+    {
+      ret = sign_stage(signatures, signature_lengths);
+    }
+  }
+
+  if (ready_slots != NULL)
+  {
+    vQueueDelete(ready_slots);
+  }
+  if (free_slots != NULL)
+  {
+    vQueueDelete(free_slots);
+  }
+  free(digests);
+  ready_slots = NULL;
+  free_slots = NULL;
+  digests = NULL;
+
+  if (ret != 0)
+  {
+    return ret;
+  }
+
+  measure.stop();
+
+  commons.log_success("sign_pipelined");
+  return 0;
+}
+
+// Signs each digest as it arrives and hands its slot back. After a failure the
+// remaining digests are still drained, so the hash task can run to its end
+// marker instead of blocking on a slot that never comes back.
+int SignPipeline::sign_stage(unsigned char *const *signatures, size_t *signature_lengths)
+{
+  int ret = 0;
+  PipelineItem item;
+
+  while (xQueueReceive(ready_slots, &item, portMAX_DELAY) == pdPASS)
+  {
+    if (item.slot < 0)
+    {
+      return ret != 0 ? ret : item.status;
+    }
+
+    if (ret == 0)
+    {
+      ret = module.sign_hash(digests + item.slot * digest_length, digest_length, signatures[item.index], &signature_lengths[item.index]);
+      if (ret != 0)
+      {
+        aborted = true;
+      }
+    }
+
+    xQueueSend(free_slots, &item.slot, portMAX_DELAY);
+  }
+
+  return -1;
+}
+
+void SignPipeline::hash_task(void *arg)
+{
+  ((SignPipeline *)arg)->hash_stage();
+  vTaskDelete(NULL);
+}
+
+// Nothing may touch the pipeline after the end marker is sent: the signer
+// deletes the queues as soon as it has it.
+void SignPipeline::hash_stage()
+{
+  PipelineItem item = {0, 0, 0};
+
+  for (size_t i = 0; i < count && !aborted; i++)
+  {
+    xQueueReceive(free_slots, &item.slot, portMAX_DELAY);
+
+    item.index = i;
+    item.status = module.hash_message(messages[i], message_lengths[i], digests + item.slot * digest_length);
+    if (item.status != 0)
+    {
+      commons.log_error("hash_message");
+      break;
+    }
+
+    xQueueSend(ready_slots, &item, portMAX_DELAY);
+  }
+
+  PipelineItem end = {count, -1, item.status};
+  xQueueSend(ready_slots, &end, portMAX_DELAY);
+}
@@ -0,0 +1,81 @@
+#include "SpanTrace.h"
+#include <atomic>
+#include <string.h>
+#include "freertos/task.h"
+
+#define SPAN_TRACE_MAX_CORES 256
+
+static Span spans[CRYPTO_API_SPAN_TRACE_EVENTS];
+// Number of spans ever recorded; the slot of span n is n % EVENTS, so once
+// the ring is full each new span replaces the oldest
+static std::atomic<uint32_t> recorded(0);
+
+void SpanTrace::record(const char *name, const char *category, int64_t start_us, uint64_t duration_ns)
+{
+  uint32_t sequence = recorded.fetch_add(1, std::memory_order_relaxed);
+  Span &span = spans[sequence % CRYPTO_API_SPAN_TRACE_EVENTS];
+  span.name = name;
+  span.category = category;
+  span.start_us = start_us;
+  span.duration_ns = duration_ns;
+  span.task_id = (uint32_t)(uintptr_t)xTaskGetCurrentTaskHandle();
+  span.core = (uint8_t)esp_cpu_get_core_id();
+  strncpy(span.task, pcTaskGetName(NULL), sizeof(span.task) - 1);
+  span.task[sizeof(span.task) - 1] = '\0';
+}
+
+void SpanTrace::clear()
+{
+  recorded.store(0, std::memory_order_relaxed);
+}
+
+size_t SpanTrace::size()
+{
+  uint32_t count = recorded.load(std::memory_order_relaxed);
+  return count < CRYPTO_API_SPAN_TRACE_EVENTS ? count : CRYPTO_API_SPAN_TRACE_EVENTS;
+}
+
+int SpanTrace::export_json(FILE *out)
+{
+  size_t count = size();
+  size_t first = recorded.load(std::memory_order_relaxed) - count;
+  bool core_named[SPAN_TRACE_MAX_CORES] = {};
+  const char *separator = "";
+
+  fprintf(out, "{\"traceEvents\":[");
+  for (size_t i = 0; i < count; i++)
+  {
+    const Span &span = spans[(first + i) % CRYPTO_API_SPAN_TRACE_EVENTS];
+
+    // Perfetto groups by pid then tid: one process per core, one thread per
+    // task on it. Name each the first time it appears.
+    if (!core_named[span.core])
+    {
+      core_named[span.core] = true;
+      fprintf(out, "%s\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,\"args\":{\"name\":\"core %u\"}}",
+              separator, span.core, span.core);
+      separator = ",";
+    }
+    bool task_named = false;
+    for (size_t j = 0; j < i && !task_named; j++)
+    {
+      const Span &earlier = spans[(first + j) % CRYPTO_API_SPAN_TRACE_EVENTS];
+      task_named = earlier.core == span.core && earlier.task_id == span.task_id;
+    }
+    if (!task_named)
+    {
+      fprintf(out, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%lu,\"args\":{\"name\":\"%s\"}}",
+              separator, span.core, (unsigned long)span.task_id, span.task);
+      separator = ",";
+    }
+
+    fprintf(out, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%llu.%03llu,\"pid\":%u,\"tid\":%lu}",
+            separator, span.name, span.category, (long long)span.start_us,
+            (unsigned long long)(span.duration_ns / 1000), (unsigned long long)(span.duration_ns % 1000),
+            span.core, (unsigned long)span.task_id);
+    separator = ",";
+  }
+  fprintf(out, "\n],\"displayTimeUnit\":\"ns\"}\n");
+
+  return ferror(out) ? -1 : 0;
+}
@@ -0,0 +1,59 @@
+#include "StackProfiler.h"
+#include "esp_log.h"
+
+static const char *TAG = "StackProfiler";
+
+struct StackProfile
+{
+  StackProfiledOperation operation;
+  void *user_data;
+  SemaphoreHandle_t done;
+  int status;
+  uint32_t high_water_mark;
+};
+
+StackProfiler::StackProfiler(uint32_t stack_size) : stack_size(stack_size) {}
+
+void StackProfiler::profile_task(void *parameters)
+{
+  StackProfile *profile = (StackProfile *)parameters;
+  profile->status = profile->operation(profile->user_data);
+  profile->high_water_mark = uxTaskGetStackHighWaterMark(NULL);
+  xSemaphoreGive(profile->done);
+  vTaskDelete(NULL);
+}
+
+int StackProfiler::run(const char *label, StackProfiledOperation operation, void *user_data, uint32_t *used_bytes)
+{
+  StackProfile profile = {
+      .operation = operation,
+      .user_data = user_data,
+      .done = xSemaphoreCreateBinary(),
+      .status = -1,
+      .high_water_mark = 0,
+  };
+  if (profile.done == NULL)
+  {
+    ESP_LOGE(TAG, "Failed at %s: xSemaphoreCreateBinary", label);
+    return -1;
+  }
+
+  if (xTaskCreatePinnedToCore(profile_task, "stack_profile", stack_size, &profile, uxTaskPriorityGet(NULL), NULL, tskNO_AFFINITY) != pdPASS)
+  {
+    ESP_LOGE(TAG, "Failed at %s: could not create a task with %lu bytes of stack", label, (unsigned long)stack_size);
+    vSemaphoreDelete(profile.done);
+    return -1;
+  }
+
+  xSemaphoreTake(profile.done, portMAX_DELAY);
+  vSemaphoreDelete(profile.done);
+
+  *used_bytes = stack_size - profile.high_water_mark;
+  if (profile.high_water_mark == 0)
+  {
+    ESP_LOGW(TAG, "%s used all %lu bytes of stack; raise CONFIG_CRYPTO_API_STACK_PROFILE_SIZE", label, (unsigned long)stack_size);
+  }
+  ESP_LOGI(TAG, "%s stack: %lu of %lu bytes used", label, (unsigned long)*used_bytes, (unsigned long)stack_size);
+
+  return profile.status;
+}
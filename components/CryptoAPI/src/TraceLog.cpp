@@ -0,0 +1,117 @@
+#include "TraceLog.h"
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+static const char *TAG = "TraceLog";
+
+#define TRACE_DRAIN_PERIOD_MS 100
+#define TRACE_DRAIN_STACK_SIZE 3072
+#define TRACE_LOG_MASK (CRYPTO_API_TRACE_LOG_EVENTS - 1)
+
+static TraceEvent events[CRYPTO_API_TRACE_LOG_EVENTS];
+// ready[i] holds the sequence number + 1 of the event last completed in
+// events[i], so drain() can tell a finished slot from one still being written
+static std::atomic<uint32_t> ready[CRYPTO_API_TRACE_LOG_EVENTS];
+// Next sequence number to claim and next one to drain; both only grow
+static std::atomic<uint32_t> head(0);
+static std::atomic<uint32_t> tail(0);
+static std::atomic<uint32_t> dropped(0);
+static std::atomic<bool> drain_task_started(false);
+
+bool TraceLog::write(TraceEventType type, const char *label, uint64_t value)
+{
+  uint32_t sequence = head.load(std::memory_order_relaxed);
+  do
+  {
+    if (sequence - tail.load(std::memory_order_acquire) >= CRYPTO_API_TRACE_LOG_EVENTS)
+    {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+  } while (!head.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+  TraceEvent &event = events[sequence & TRACE_LOG_MASK];
+  event.label = label;
+  event.value = value;
+  event.type = type;
+  ready[sequence & TRACE_LOG_MASK].store(sequence + 1, std::memory_order_release);
+  return true;
+}
+
+size_t TraceLog::drain()
+{
+  size_t drained = 0;
+  uint32_t sequence = tail.load(std::memory_order_acquire);
+  while (ready[sequence & TRACE_LOG_MASK].load(std::memory_order_acquire) == sequence + 1)
+  {
+    // Copy first, then claim: the slot cannot be reused before tail moves
+    // past it, so the copy is intact whenever the claim succeeds
+    TraceEvent event = events[sequence & TRACE_LOG_MASK];
+    if (!tail.compare_exchange_strong(sequence, sequence + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+    {
+      continue;
+    }
+    print_event(event);
+    sequence++;
+    drained++;
+  }
+
+  uint32_t lost = dropped.exchange(0, std::memory_order_relaxed);
+  if (lost > 0)
+  {
+    // Logged at the level of the events lost, so it is quiet when they would be
+    ESP_LOGI(TAG, "%lu events dropped; raise CONFIG_CRYPTO_API_TRACE_LOG_EVENTS", (unsigned long)lost);
+  }
+  return drained;
+}
+
+void TraceLog::print_event(const TraceEvent &event)
+{
+  switch (event.type)
+  {
+  case TRACE_SUCCESS:
+    ESP_LOGI(TAG, "SUCCESS AT %s", event.label);
+    break;
+  case TRACE_ELAPSED_NS:
+    ESP_LOGI(TAG, "\n\n%s time: %llu.%03llu ms", event.label, (unsigned long long)(event.value / 1000000), (unsigned long long)(event.value / 1000 % 1000));
+    break;
+  case TRACE_MEMORY_BYTES:
+    ESP_LOGI(TAG, "%s memory: %llu bytes", event.label, (unsigned long long)event.value);
+    break;
+  case TRACE_CYCLES:
+    ESP_LOGI(TAG, "%s clock cycle count: %llu", event.label, (unsigned long long)event.value);
+    break;
+  }
+}
+
+void TraceLog::drain_task(void *)
+{
+  while (true)
+  {
+    drain();
+    vTaskDelay(pdMS_TO_TICKS(TRACE_DRAIN_PERIOD_MS));
+  }
+}
+
+int TraceLog::start_drain_task()
+{
+  if (drain_task_started.exchange(true))
+  {
+    return 0;
+  }
+
+  if (xTaskCreatePinnedToCore(drain_task, "trace_drain", TRACE_DRAIN_STACK_SIZE, NULL, CRYPTO_API_TRACE_DRAIN_PRIORITY, NULL, tskNO_AFFINITY) != pdPASS)
+  {
+    ESP_LOGE(TAG, "> Could not start the drain task.");
+    drain_task_started.store(false);
+    return -1;
+  }
+  return 0;
+}
+
+unsigned long TraceLog::get_dropped()
+{
+  return dropped.load(std::memory_order_relaxed);
+}
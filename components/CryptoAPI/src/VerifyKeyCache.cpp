@@ -0,0 +1,129 @@
+#include "VerifyKeyCache.h"
+#include "esp_log.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "VerifyKeyCache";
+
+VerifyKeyCache::VerifyKeyCache(size_t key_size, size_t value_size, size_t budget)
+    : key_size(key_size), value_size(value_size), capacity(budget / (key_size + value_size + sizeof(Entry))),
+      values(NULL), keys(NULL), entries(NULL), clock(0), stats()
+{
+  stats.capacity = capacity;
+}
+
+VerifyKeyCache::~VerifyKeyCache()
+{
+  free(values);
+  free(entries);
+}
+
+// FNV-1a, so most entries are skipped without comparing whole keys
+uint32_t VerifyKeyCache::hash_key(const unsigned char *key)
+{
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < key_size; i++)
+  {
+    hash = (hash ^ key[i]) * 16777619u;
+  }
+  return hash;
+}
+
+// A linear scan: with a few hundred entries it costs far less than the
+// verification it saves, and needs no memory beyond the entries
+size_t VerifyKeyCache::index_of(const unsigned char *key, uint32_t hash)
+{
+  for (size_t i = 0; entries != NULL && i < capacity; i++)
+  {
+    if (entries[i].last_used != 0 && entries[i].hash == hash && memcmp(keys + i * key_size, key, key_size) == 0)
+    {
+      return i;
+    }
+  }
+  return capacity;
+}
+
+unsigned char *VerifyKeyCache::find(const unsigned char *key)
+{
+  size_t index = index_of(key, hash_key(key));
+  if (index == capacity)
+  {
+    stats.misses++;
+    return NULL;
+  }
+  stats.hits++;
+  entries[index].last_used = ++clock;
+  return values + index * value_size;
+}
+
+unsigned char *VerifyKeyCache::insert(const unsigned char *key)
+{
+  if (capacity == 0)
+  {
+    return NULL;
+  }
+  if (entries == NULL)
+  {
+    // Values first, so that each one keeps the alignment of the block
+    values = (unsigned char *)malloc(capacity * (value_size + key_size));
+    entries = (Entry *)calloc(capacity, sizeof(Entry));
+    if (values == NULL || entries == NULL)
+    {
+      ESP_LOGE(TAG, "> Could not allocate %u cached keys.", (unsigned)capacity);
+      free(values);
+      free(entries);
+      values = NULL;
+      entries = NULL;
+      return NULL;
+    }
+    keys = values + capacity * value_size;
+  }
+
+  // A free slot, or else the least recently used one
+  size_t index = 0;
+  for (size_t i = 0; i < capacity && entries[index].last_used != 0; i++)
+  {
+    if (entries[i].last_used < entries[index].last_used)
+    {
+      index = i;
+    }
+  }
+  if (entries[index].last_used != 0)
+  {
+    stats.evictions++;
+  }
+  else
+  {
+    stats.entries++;
+  }
+
+  memcpy(keys + index * key_size, key, key_size);
+  entries[index].hash = hash_key(key);
+  entries[index].last_used = ++clock;
+  return values + index * value_size;
+}
+
+void VerifyKeyCache::remove(const unsigned char *key)
+{
+  size_t index = index_of(key, hash_key(key));
+  if (index < capacity)
+  {
+    entries[index].last_used = 0;
+    stats.entries--;
+  }
+}
+
+void VerifyKeyCache::clear()
+{
+  if (entries != NULL)
+  {
+    memset(entries, 0, capacity * sizeof(Entry));
+  }
+  stats = KeyCacheStats();
+  stats.capacity = capacity;
+}
+
+KeyCacheStats VerifyKeyCache::get_stats()
+{
+  return stats;
+}
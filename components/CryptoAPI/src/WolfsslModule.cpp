@@ -1,38 +1,39 @@
 #include "WolfsslModule.h"
+#include "SpanTrace.h"
+#include <string.h>
 
 static const char *TAG = "WolfsslModule";
 
-WolfsslModule::WolfsslModule(CryptoApiCommons &commons) : commons(commons) {}
+WolfsslModule::WolfsslModule(CryptoApiCommons &commons) : commons(commons), rng(NULL), wolf_ed25519_key(NULL), wolf_rsa_key(NULL), wolf_ecc_key(NULL), wolf_ed448_key(NULL) {}
 
 int WolfsslModule::init(Algorithms algorithm, Hashes hash, size_t length_of_shake256)
 {
-  int initial_memory = esp_get_minimum_free_heap_size();
-  unsigned long start_time = esp_timer_get_time() / 1000;
-
   commons.set_chosen_algorithm(algorithm);
   commons.set_chosen_hash(hash);
   commons.set_shake256_hash_length(length_of_shake256);
 
-  wolfCrypt_Init();
-
-  rng = (WC_RNG *)malloc(sizeof(WC_RNG));
-  int ret = wc_InitRng(rng);
-  if (ret != 0)
+  // wolfCrypt and the RNG are set up once and kept until close(); a later
+  // init() only replaces the key object.
+  int ret;
+  if (rng != NULL)
   {
-    commons.log_error("wc_InitRng");
-    return ret;
+    free_keys();
   }
+  else
+  {
+    wolfCrypt_Init();
 
-  unsigned long end_time = esp_timer_get_time() / 1000;
-  int final_memory = esp_get_minimum_free_heap_size();
-
-  // commons.print_elapsed_time(start_time, end_time, "init rng");
-  // commons.print_used_memory(initial_memory, final_memory, "init rng");
-
-  heap_caps_monitor_local_minimum_free_size_start();
-  initial_memory = esp_get_minimum_free_heap_size();
-  start_time = esp_timer_get_time() / 1000;
-  size_t cycle_count_before = esp_cpu_get_cycle_count();
+    rng = (WC_RNG *)malloc(sizeof(WC_RNG));
+    ScopedSpan rng_span("wc_InitRng", "drbg");
+    ret = wc_InitRng(rng);
+    if (ret != 0)
+    {
+      commons.log_error("wc_InitRng");
+      free(rng);
+      rng = NULL;
+      return ret;
+    }
+  }
 
   switch (commons.get_chosen_algorithm())
   {
@@ -77,15 +78,6 @@ int WolfsslModule::init(Algorithms algorithm, Hashes hash, size_t length_of_shak
     break;
   }
 
-  end_time = esp_timer_get_time() / 1000;
-  final_memory = esp_get_minimum_free_heap_size();
-  size_t cycle_count_after = esp_cpu_get_cycle_count();
-  heap_caps_monitor_local_minimum_free_size_stop();
-
-  // commons.print_elapsed_time(start_time, end_time, "init key");
-  // commons.print_used_memory(initial_memory, final_memory, "init key");
-  // commons.print_total_cycles(cycle_count_before, cycle_count_after, "init key");
-
   commons.log_success("init");
   return 0;
 }
@@ -96,10 +88,8 @@ int WolfsslModule::gen_keys()
   int curve_id = get_ecc_curve_id();
   int key_size = get_key_size(curve_id);
 
-  heap_caps_monitor_local_minimum_free_size_start();
-  int initial_memory = esp_get_minimum_free_heap_size();
-  unsigned long start_time = esp_timer_get_time() / 1000;
-  size_t cycle_count_before = esp_cpu_get_cycle_count();
+  ScopedMeasure<MeasureTime, MeasureHeap, MeasureCycles> measure(commons, "gen_keys");
+  ScopedSpan span("make_key", "pk");
 
   switch (commons.get_chosen_algorithm())
   {
@@ -133,14 +123,7 @@ int WolfsslModule::gen_keys()
     break;
   }
 
-  unsigned long end_time = esp_timer_get_time() / 1000;
-  int final_memory = esp_get_minimum_free_heap_size();
-  size_t cycle_count_after = esp_cpu_get_cycle_count();
-  heap_caps_monitor_local_minimum_free_size_stop();
-
-  commons.print_elapsed_time(start_time, end_time, "gen_keys");
-  commons.print_used_memory(initial_memory, final_memory, "gen_keys");
-  commons.print_total_cycles(cycle_count_before, cycle_count_after, "gen_keys");
+  measure.stop();
 
   commons.log_success("gen_keys");
   return 0;
@@ -148,10 +131,8 @@ int WolfsslModule::gen_keys()
 
 int WolfsslModule::gen_rsa_keys(unsigned int rsa_key_size, int rsa_exponent)
 {
-  heap_caps_monitor_local_minimum_free_size_start();
-  int initial_memory = esp_get_minimum_free_heap_size();
-  unsigned long start_time = esp_timer_get_time() / 1000;
-  unsigned long cycle_count_before = esp_cpu_get_cycle_count();
+  ScopedMeasure<MeasureTime, MeasureHeap, MeasureCycles> measure(commons, "gen_keys");
+  ScopedSpan span("make_rsa_key", "pk");
 
   this->rsa_key_size = rsa_key_size;
 
@@ -162,14 +143,7 @@ int WolfsslModule::gen_rsa_keys(unsigned int rsa_key_size, int rsa_exponent)
     return ret;
   }
 
-  unsigned long end_time = esp_timer_get_time() / 1000;
-  int final_memory = esp_get_minimum_free_heap_size();
-  size_t cycle_count_after = esp_cpu_get_cycle_count();
-  heap_caps_monitor_local_minimum_free_size_stop();
-
-  commons.print_elapsed_time(start_time, end_time, "gen_keys");
-  commons.print_used_memory(initial_memory, final_memory, "gen_keys");
-  commons.print_total_cycles(cycle_count_before, cycle_count_after, "gen_keys");
+  measure.stop();
 
   commons.log_success("gen_keys");
   return 0;
@@ -177,112 +151,172 @@ int WolfsslModule::gen_rsa_keys(unsigned int rsa_key_size, int rsa_exponent)
 
 int WolfsslModule::sign(const unsigned char *message, size_t message_length, unsigned char *signature, size_t *signature_length)
 {
-  int hash_initial_memory = esp_get_minimum_free_heap_size();
-  unsigned long hash_start_time = esp_timer_get_time() / 1000;
+  ScopedMeasure<MeasureTime, MeasureHeap> hash_measure(commons, "hash_message");
 
   size_t hash_length = commons.get_hash_length();
   byte *hash = (byte *)malloc(hash_length * sizeof(byte));
+  if (hash == NULL)
+  {
+    return -1;
+  }
 
   int ret = hash_message(message, message_length, hash);
   if (ret != 0)
   {
     commons.log_error("hash_message");
+    free(hash);
+    return ret;
+  }
+
+  hash_measure.stop();
+
+  ScopedMeasure<MeasureTime, MeasureHeap, MeasureCycles> measure(commons, "sign");
+
+  ret = sign_hash(hash, hash_length, signature, signature_length);
+  if (ret != 0)
+  {
+    free(hash);
+    return ret;
+  }
+
+  measure.stop();
+
+  free(hash);
+
+  commons.log_success("sign");
+  return 0;
+}
+
+int WolfsslModule::sign_batch(const unsigned char *const *messages, const size_t *message_lengths, size_t count, unsigned char *const *signatures, size_t *signature_lengths)
+{
+  ScopedMeasure<MeasureTime, MeasureHeap, MeasureCycles> measure(commons, "sign_batch");
+
+  // One hash buffer serves the whole batch; the key and WC_RNG are reused as they are
+  size_t hash_length = commons.get_hash_length();
+  byte *hash = (byte *)malloc(hash_length * sizeof(byte));
+  if (hash == NULL)
+  {
+    return -1;
+  }
+
+  int ret = 0;
+  for (size_t i = 0; i < count && ret == 0; i++)
+  {
+    ret = hash_message(messages[i], message_lengths[i], hash);
+    if (ret != 0)
+    {
+      commons.log_error("hash_message");
+      break;
+    }
+
+    ret = sign_hash(hash, hash_length, signatures[i], &signature_lengths[i]);
+  }
+
+  free(hash);
+
+  if (ret != 0)
+  {
     return ret;
   }
 
-  unsigned long hash_end_time = esp_timer_get_time() / 1000;
-  int hash_final_memory = esp_get_minimum_free_heap_size();
+  measure.stop();
 
-  commons.print_elapsed_time(hash_start_time, hash_end_time, "hash_message");
-  commons.print_used_memory(hash_initial_memory, hash_final_memory, "hash_message");
+  commons.log_success("sign_batch");
+  return 0;
+}
 
-  heap_caps_monitor_local_minimum_free_size_start();
-  int initial_memory = esp_get_minimum_free_heap_size();
-  unsigned long start_time = esp_timer_get_time() / 1000;
-  unsigned long cycle_count_before = esp_cpu_get_cycle_count();
+int WolfsslModule::sign_hash(const unsigned char *hash, size_t hash_length, unsigned char *signature, size_t *signature_length)
+{
+  ScopedSpan span("sign_hash", "pk");
+  int ret = 0;
+  word32 sig_len = *signature_length;
 
   switch (commons.get_chosen_algorithm())
   {
   case EDDSA_25519:
-    ret = wc_ed25519ph_sign_hash(hash, hash_length, signature, signature_length, wolf_ed25519_key, NULL, 0);
+    ret = wc_ed25519ph_sign_hash(hash, hash_length, signature, &sig_len, wolf_ed25519_key, NULL, 0);
     if (ret != 0)
     {
       commons.log_error("wc_ed25519ph_sign_hash");
-      return ret;
     }
     break;
   case RSA:
     ret = wc_RsaSSL_Sign(hash, hash_length, signature, *signature_length, wolf_rsa_key, rng);
-    if (ret != *signature_length)
+    if (ret != (int)*signature_length)
     {
       commons.log_error("wc_RsaSSL_Sign");
-      return ret;
+      break;
     }
+    ret = 0;
     break;
   case ECDSA_BP256R1:
   case ECDSA_BP512R1:
   case ECDSA_SECP256R1:
   case ECDSA_SECP521R1:
-    ret = wc_ecc_sign_hash(hash, hash_length, signature, signature_length, rng, wolf_ecc_key);
+    ret = wc_ecc_sign_hash(hash, hash_length, signature, &sig_len, rng, wolf_ecc_key);
     if (ret != 0)
     {
       commons.log_error("wc_ecc_sign_hash");
-      return ret;
     }
     break;
   case EDDSA_448:
-    ret = wc_ed448ph_sign_hash(hash, hash_length, signature, signature_length, wolf_ed448_key, NULL, 0);
+    ret = wc_ed448ph_sign_hash(hash, hash_length, signature, &sig_len, wolf_ed448_key, NULL, 0);
     if (ret != 0)
     {
       commons.log_error("wc_ed448ph_sign_hash");
-      return ret;
     }
     break;
   }
 
-  unsigned long end_time = esp_timer_get_time() / 1000;
-  int final_memory = esp_get_minimum_free_heap_size();
-  size_t cycle_count_after = esp_cpu_get_cycle_count();
-  heap_caps_monitor_local_minimum_free_size_stop();
-
-  commons.print_elapsed_time(start_time, end_time, "sign");
-  commons.print_used_memory(initial_memory, final_memory, "sign");
-  commons.print_total_cycles(cycle_count_before, cycle_count_after, "sign");
-
-  free(hash);
-
-  commons.log_success("sign");
-  return 0;
+  if (ret == 0)
+  {
+    *signature_length = sig_len;
+  }
+  return ret;
 }
 
 int WolfsslModule::verify(const unsigned char *message, size_t message_length, unsigned char *signature, size_t signature_length)
 {
-  unsigned long hash_start_time = esp_timer_get_time() / 1000;
-  int hash_initial_memory = esp_get_minimum_free_heap_size();
+  ScopedMeasure<MeasureTime, MeasureHeap> hash_measure(commons, "hash_message");
 
   size_t hash_length = commons.get_hash_length();
   byte *hash = (byte *)malloc(hash_length * sizeof(byte));
+  if (hash == NULL)
+  {
+    return -1;
+  }
 
   int ret = hash_message(message, message_length, hash);
   if (ret != 0)
   {
     commons.log_error("hash_message");
+    free(hash);
     return ret;
   }
 
-  int hash_final_memory = esp_get_minimum_free_heap_size();
-  unsigned long hash_end_time = esp_timer_get_time() / 1000;
+  hash_measure.stop();
+
+  ScopedMeasure<MeasureTime, MeasureHeap, MeasureCycles> measure(commons, "verify");
+
+  ret = verify_hash(hash, hash_length, signature, signature_length);
+  if (ret != 0)
+  {
+    free(hash);
+    return ret;
+  }
 
-  commons.print_elapsed_time(hash_start_time, hash_end_time, "hash_message");
-  commons.print_used_memory(hash_initial_memory, hash_final_memory, "hash_message");
+  measure.stop();
 
-  heap_caps_monitor_local_minimum_free_size_start();
-  int initial_memory = esp_get_minimum_free_heap_size();
-  unsigned long start_time = esp_timer_get_time() / 1000;
-  unsigned long cycle_count_before = esp_cpu_get_cycle_count();
+  free(hash);
 
-  byte *decrypted_signature = (byte *)malloc(hash_length * sizeof(byte));
+  commons.log_success("verify");
+  return 0;
+}
 
+int WolfsslModule::verify_hash(const unsigned char *hash, size_t hash_length, const unsigned char *signature, size_t signature_length)
+{
+  ScopedSpan span("verify_hash", "pk");
+  int ret = 0;
   int verify_status = 0;
   switch (commons.get_chosen_algorithm())
   {
@@ -291,28 +325,42 @@ int WolfsslModule::verify(const unsigned char *message, size_t message_length, u
     if (ret != 0)
     {
       commons.log_error("wc_ed25519ph_verify_hash");
-      return ret;
+      break;
     }
 
     if (verify_status != 1)
     {
       ESP_LOGE(TAG, "> Signature not valid.");
+      ret = -1;
     }
     break;
   case RSA:
+  {
+    byte *decrypted_signature = (byte *)malloc(hash_length * sizeof(byte));
+    if (decrypted_signature == NULL)
+    {
+      ESP_LOGE(TAG, "> Could not allocate the decrypted signature.");
+      ret = -1;
+      break;
+    }
     ret = wc_RsaSSL_Verify(signature, signature_length, decrypted_signature, hash_length, wolf_rsa_key);
-    if (ret != hash_length)
+    if (ret != (int)hash_length)
     {
       commons.log_error("wc_RsaSSL_Verify");
-      return ret;
+      free(decrypted_signature);
+      break;
     }
+    ret = 0;
 
     verify_status = memcmp(hash, decrypted_signature, hash_length);
     if (verify_status != 0)
     {
       ESP_LOGE(TAG, "> Signature not valid.");
+      ret = -1;
     }
+    free(decrypted_signature);
     break;
+  }
   case ECDSA_BP256R1:
   case ECDSA_BP512R1:
   case ECDSA_SECP256R1:
@@ -321,12 +369,13 @@ int WolfsslModule::verify(const unsigned char *message, size_t message_length, u
     if (ret != 0)
     {
       commons.log_error("wc_ecc_verify_hash");
-      return ret;
+      break;
     }
 
     if (verify_status != 1)
     {
       ESP_LOGE(TAG, "> Signature not valid.");
+      ret = -1;
     }
     break;
   case EDDSA_448:
@@ -334,54 +383,141 @@ int WolfsslModule::verify(const unsigned char *message, size_t message_length, u
     if (ret != 0)
     {
       commons.log_error("wc_ed448ph_verify_hash");
-      return ret;
+      break;
     }
 
     if (verify_status != 1)
     {
       ESP_LOGE(TAG, "> Signature not valid.");
+      ret = -1;
     }
     break;
   }
 
-  unsigned long end_time = esp_timer_get_time() / 1000;
-  int final_memory = esp_get_minimum_free_heap_size();
-  size_t cycle_count_after = esp_cpu_get_cycle_count();
-  heap_caps_monitor_local_minimum_free_size_stop();
+  return ret;
+}
+
+int WolfsslModule::sign_init()
+{
+  return hash_starts();
+}
 
-  commons.print_elapsed_time(start_time, end_time, "verify");
-  commons.print_used_memory(initial_memory, final_memory, "verify");
-  commons.print_total_cycles(cycle_count_before, cycle_count_after, "verify");
+int WolfsslModule::sign_update(const unsigned char *data, size_t data_length)
+{
+  return hash_update(data, data_length);
+}
 
+int WolfsslModule::sign_final(unsigned char *signature, size_t *signature_length)
+{
+  size_t hash_length = commons.get_hash_length();
+  byte *hash = (byte *)malloc(hash_length * sizeof(byte));
+
+  int ret = hash_finish(hash);
+  if (ret != 0)
+  {
+    commons.log_error("hash_finish");
+    free(hash);
+    return ret;
+  }
+
+  ScopedMeasure<MeasureTime, MeasureHeap, MeasureCycles> measure(commons, "sign");
+
+  ret = sign_hash(hash, hash_length, signature, signature_length);
   free(hash);
-  free(decrypted_signature);
+  if (ret != 0)
+  {
+    return ret;
+  }
 
-  commons.log_success("verify");
+  measure.stop();
+
+  commons.log_success("sign_final");
+  return 0;
+}
+
+int WolfsslModule::verify_init()
+{
+  return hash_starts();
+}
+
+int WolfsslModule::verify_update(const unsigned char *data, size_t data_length)
+{
+  return hash_update(data, data_length);
+}
+
+int WolfsslModule::verify_final(unsigned char *signature, size_t signature_length)
+{
+  size_t hash_length = commons.get_hash_length();
+  byte *hash = (byte *)malloc(hash_length * sizeof(byte));
+
+  int ret = hash_finish(hash);
+  if (ret != 0)
+  {
+    commons.log_error("hash_finish");
+    free(hash);
+    return ret;
+  }
+
+  ScopedMeasure<MeasureTime, MeasureHeap, MeasureCycles> measure(commons, "verify");
+
+  ret = verify_hash(hash, hash_length, signature, signature_length);
+  free(hash);
+  if (ret != 0)
+  {
+    return ret;
+  }
+
+  measure.stop();
+
+  commons.log_success("verify_final");
   return 0;
 }
 
 void WolfsslModule::close()
 {
-  wolfCrypt_Cleanup();
+  if (rng == NULL)
+  {
+    return;
+  }
+
+  free_keys();
   wc_FreeRng(rng);
-  if (commons.get_chosen_algorithm() == Algorithms::RSA)
+  free(rng);
+  rng = NULL;
+  wolfCrypt_Cleanup();
+
+  ESP_LOGI(TAG, "> wolfssl closed.");
+}
+
+// Frees whichever key object the last init() created. The pointers are
+// checked rather than the chosen algorithm, which another module sharing
+// commons may have changed since.
+void WolfsslModule::free_keys()
+{
+  if (wolf_rsa_key != NULL)
   {
     wc_FreeRsaKey(wolf_rsa_key);
+    free(wolf_rsa_key);
+    wolf_rsa_key = NULL;
   }
-  else if (commons.get_chosen_algorithm() == Algorithms::EDDSA_25519)
+  if (wolf_ed25519_key != NULL)
   {
     wc_ed25519_free(wolf_ed25519_key);
+    free(wolf_ed25519_key);
+    wolf_ed25519_key = NULL;
   }
-  else if (commons.get_chosen_algorithm() == Algorithms::EDDSA_448)
+  if (wolf_ed448_key != NULL)
   {
     wc_ed448_free(wolf_ed448_key);
+    free(wolf_ed448_key);
+    wolf_ed448_key = NULL;
   }
-  else
+  if (wolf_ecc_key != NULL)
   {
     wc_ecc_free(wolf_ecc_key);
+    free(wolf_ecc_key);
+    wolf_ecc_key = NULL;
   }
-
-  ESP_LOGI(TAG, "> wolfssl closed.");
 }
 
 int WolfsslModule::get_key_size(int curve_id)
@@ -444,8 +580,14 @@ size_t WolfsslModule::get_private_key_size()
   }
 }
 
+size_t WolfsslModule::get_digest_length()
+{
+  return commons.get_hash_length();
+}
+
 int WolfsslModule::hash_message(const unsigned char *message, size_t message_len, unsigned char *hash)
 {
+  ScopedSpan span("hash_message", "hash");
   switch (commons.get_chosen_hash())
   {
   case Hashes::MY_SHA_256:
@@ -461,6 +603,67 @@ int WolfsslModule::hash_message(const unsigned char *message, size_t message_len
   }
 }
 
+// hash_starts/hash_update/hash_finish produce the same digest as
+// hash_message, with the message fed in pieces.
+int WolfsslModule::hash_starts()
+{
+  switch (commons.get_chosen_hash())
+  {
+  case Hashes::MY_SHA_512:
+    return wc_InitSha512(&stream_ctx.sha512);
+  case Hashes::MY_SHA3_256:
+    return wc_InitSha3_256(&stream_ctx.sha3, NULL, INVALID_DEVID);
+  case Hashes::MY_SHAKE_256:
+    return wc_InitShake256(&stream_ctx.sha3, NULL, INVALID_DEVID);
+  case Hashes::MY_SHA_256:
+  default:
+    return wc_InitSha256(&stream_ctx.sha256);
+  }
+}
+
+int WolfsslModule::hash_update(const unsigned char *data, size_t data_length)
+{
+  ScopedSpan span("hash_update", "hash");
+  switch (commons.get_chosen_hash())
+  {
+  case Hashes::MY_SHA_512:
+    return wc_Sha512Update(&stream_ctx.sha512, data, data_length);
+  case Hashes::MY_SHA3_256:
+    return wc_Sha3_256_Update(&stream_ctx.sha3, data, data_length);
+  case Hashes::MY_SHAKE_256:
+    return wc_Shake256_Update(&stream_ctx.sha3, data, data_length);
+  case Hashes::MY_SHA_256:
+  default:
+    return wc_Sha256Update(&stream_ctx.sha256, data, data_length);
+  }
+}
+
+int WolfsslModule::hash_finish(unsigned char *hash)
+{
+  ScopedSpan span("hash_finish", "hash");
+  int ret;
+  switch (commons.get_chosen_hash())
+  {
+  case Hashes::MY_SHA_512:
+    ret = wc_Sha512Final(&stream_ctx.sha512, hash);
+    wc_Sha512Free(&stream_ctx.sha512);
+    return ret;
+  case Hashes::MY_SHA3_256:
+    ret = wc_Sha3_256_Final(&stream_ctx.sha3, hash);
+    wc_Sha3_256_Free(&stream_ctx.sha3);
+    return ret;
+  case Hashes::MY_SHAKE_256:
+    ret = wc_Shake256_Final(&stream_ctx.sha3, hash, commons.get_hash_length());
+    wc_Shake256_Free(&stream_ctx.sha3);
+    return ret;
+  case Hashes::MY_SHA_256:
+  default:
+    ret = wc_Sha256Final(&stream_ctx.sha256, hash);
+    wc_Sha256Free(&stream_ctx.sha256);
+    return ret;
+  }
+}
+
 size_t WolfsslModule::get_public_key_size()
 {
   return get_key_size(get_ecc_curve_id());
@@ -486,8 +689,9 @@ int WolfsslModule::get_signature_size()
 
 int WolfsslModule::get_public_key_pem(unsigned char *public_key_pem)
 {
+  ScopedSpan span("public_key_pem", "encode");
   int ret;
-  size_t der_pub_key_size = get_public_key_der_size();
+  word32 der_pub_key_size = get_public_key_der_size();
   unsigned char *der_pub_key = (unsigned char *)malloc(der_pub_key_size * sizeof(unsigned char));
   CertType cert_type;
 
@@ -544,7 +748,10 @@ int WolfsslModule::get_public_key_pem(unsigned char *public_key_pem)
     break;
   }
 
-  ret = wc_DerToPem(der_pub_key, der_pub_key_size, public_key_pem, get_public_key_pem_size(), cert_type);
+  {
+    ScopedSpan pem_span("der_to_pem", "encode");
+    ret = wc_DerToPem(der_pub_key, der_pub_key_size, public_key_pem, get_public_key_pem_size(), cert_type);
+  }
   if (ret < 0)
   {
     commons.log_error("wc_DerToPem");
@@ -693,8 +900,9 @@ size_t WolfsslModule::get_private_key_der_size()
 
 int WolfsslModule::get_private_key_pem(unsigned char *private_key_pem)
 {
+  ScopedSpan span("private_key_pem", "encode");
   int ret;
-  size_t der_priv_key_size = get_private_key_der_size();
+  word32 der_priv_key_size = get_private_key_der_size();
   unsigned char *der_priv_key = (unsigned char *)malloc(der_priv_key_size * sizeof(unsigned char));
   CertType cert_type;
 
@@ -754,7 +962,10 @@ int WolfsslModule::get_private_key_pem(unsigned char *private_key_pem)
     break;
   }
 
-  ret = wc_DerToPem(der_priv_key, der_priv_key_size, private_key_pem, get_private_key_pem_size(), cert_type);
+  {
+    ScopedSpan pem_span("der_to_pem", "encode");
+    ret = wc_DerToPem(der_priv_key, der_priv_key_size, private_key_pem, get_private_key_pem_size(), cert_type);
+  }
 
   ESP_LOGE(TAG, "private key pem size: %d", ret);
   ESP_LOGE(TAG, "private key der size: %d", der_priv_key_size);
@@ -770,7 +981,7 @@ int WolfsslModule::get_private_key_pem(unsigned char *private_key_pem)
   return 0;
 }
 
-void WolfsslModule::save_private_key(const char *file_path, unsigned char *private_key, size_t private_key_size)
+void WolfsslModule::save_private_key(const char *file_path, unsigned char *private_key, size_t)
 {
   int ret = get_private_key_pem(private_key);
   if (ret == 0)
@@ -783,7 +994,7 @@ void WolfsslModule::save_private_key(const char *file_path, unsigned char *priva
   }
 }
 
-void WolfsslModule::save_public_key(const char *file_path, unsigned char *public_key, size_t public_key_size)
+void WolfsslModule::save_public_key(const char *file_path, unsigned char *public_key, size_t)
 {
   int ret = get_public_key_pem(public_key);
   if (ret == 0)
@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+"""Generate the precomputed secp256r1 generator tables for uECC.c.
+
+Fixed-base comb (--teeth, --tables), used by key generation and signing:
+uECC.c multiplies G by a regularized scalar k' = k + n or k + 2n, which has
+exactly 257 bits. The comb splits those bits over TABLES * TEETH teeth spaced
+SPACING = ceil(257 / (TABLES * TEETH)) bits apart. Scalar bit p is read by
+table t, tooth i, column c with p = (t * TEETH + i) * SPACING + c - SHIFT,
+where SHIFT = TABLES * TEETH * SPACING - 257 puts the top bit (always set) in
+the first column of the last table, so the sum never starts at infinity.
+Entry j - 1 of table t is sum(2^((t * TEETH + i) * SPACING - SHIFT) * G) over
+the bits i set in j, in affine coordinates. Each table has 2^TEETH - 1
+entries of 64 bytes.
+
+wNAF window (--g-window), used by verification: the odd multiples G, 3G, 5G,
+..., (2^(G_WINDOW - 1) - 1)G, 2^(G_WINDOW - 2) entries of 64 bytes.
+
+    python3 secp256r1_tables.py --teeth 5 --tables 4 --g-window 7 -o secp256r1-tables.inc
+"""
+
+import argparse
+import sys
+
+P = 0xFFFFFFFF00000001000000000000000000000000FFFFFFFFFFFFFFFFFFFFFFFF
+N = 0xFFFFFFFF00000000FFFFFFFFFFFFFFFFBCE6FAADA7179E84F3B9CAC2FC632551
+GX = 0x6B17D1F2E12C4247F8BCE6E563A440F277037D812DEB33A0F4A13945D898C296
+GY = 0x4FE342E2FE1A7F9B8EE7EB4A7C0F9E162BCE33576B315ECECBB6406837BF51F5
+
+SCALAR_BITS = 257
+
+
+def add(a, b):
+    """Affine point addition; None is the point at infinity."""
+    if a is None:
+        return b
+    if b is None:
+        return a
+    if a[0] == b[0]:
+        if (a[1] + b[1]) % P == 0:
+            return None
+        slope = 3 * (a[0] * a[0] - 1) * pow(2 * a[1], -1, P) % P
+    else:
+        slope = (b[1] - a[1]) * pow(b[0] - a[0], -1, P) % P
+    x = (slope * slope - a[0] - b[0]) % P
+    return (x, (slope * (a[0] - x) - a[1]) % P)
+
+
+def mult(k, point):
+    result = None
+    while k:
+        if k & 1:
+            result = add(result, point)
+        point = add(point, point)
+        k >>= 1
+    return result
+
+
+def words(value):
+    """The 32 bytes of value as BYTES_TO_WORDS_8() lines, least significant first."""
+    data = value.to_bytes(32, "little")
+    return [
+        "BYTES_TO_WORDS_8(%s)" % ", ".join("%02X" % b for b in data[i:i + 8])
+        for i in range(0, 32, 8)
+    ]
+
+
+def point_lines(point, indent):
+    return "%s{ %s },\n" % (indent, (",\n  " + indent).join(words(point[0]) + words(point[1])))
+
+
+def generate(teeth, tables, g_window, out):
+    out.write("/* Generated by scripts/secp256r1_tables.py --teeth %d --tables %d --g-window %d. "
+              "Do not edit. */\n\n" % (teeth, tables, g_window))
+    out.write("#ifndef _UECC_SECP256R1_TABLES_H_\n#define _UECC_SECP256R1_TABLES_H_\n\n")
+    out.write("#define uECC_SECP256R1_COMB_GENERATED_TEETH %d\n" % teeth)
+    out.write("#define uECC_SECP256R1_COMB_GENERATED_TABLES %d\n" % tables)
+    out.write("#define uECC_SECP256R1_WNAF_GENERATED_G_WINDOW %d\n" % g_window)
+
+    if teeth:
+        spacing = -(-SCALAR_BITS // (teeth * tables))
+        shift = teeth * tables * spacing - SCALAR_BITS
+        out.write("#define uECC_SECP256R1_COMB_SPACING %d\n" % spacing)
+        out.write("#define uECC_SECP256R1_COMB_SHIFT %d\n\n" % shift)
+        out.write("static const uECC_word_t secp256r1_comb[%d][%d][num_words_secp256r1 * 2] = {\n"
+                  % (tables, (1 << teeth) - 1))
+        for t in range(tables):
+            tooth = [mult(pow(2, (t * teeth + i) * spacing - shift, N), (GX, GY))
+                     for i in range(teeth)]
+            entries = [None] * (1 << teeth)
+            out.write("    { /* table %d */\n" % t)
+            for j in range(1, 1 << teeth):
+                low = j & -j
+                entries[j] = add(entries[j ^ low], tooth[low.bit_length() - 1])
+                out.write(point_lines(entries[j], " " * 8))
+            out.write("    },\n")
+        out.write("};\n")
+
+    if g_window:
+        count = 1 << (g_window - 2)
+        twice = add((GX, GY), (GX, GY))
+        point = (GX, GY)
+        out.write("\n/* G, 3G, 5G, ... */\n")
+        out.write("static const uECC_word_t secp256r1_g_odd[%d][num_words_secp256r1 * 2] = {\n" % count)
+        for j in range(count):
+            out.write(point_lines(point, " " * 4))
+            point = add(point, twice)
+        out.write("};\n")
+
+    out.write("\n#endif /* _UECC_SECP256R1_TABLES_H_ */\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate the secp256r1 generator tables.")
+    parser.add_argument("--teeth", type=int, default=5,
+                        help="comb bits read per table lookup, 1 to 8, or 0 for no comb")
+    parser.add_argument("--tables", type=int, default=4, help="comb tables added per doubling, 1 to 8")
+    parser.add_argument("--g-window", type=int, default=7,
+                        help="wNAF width of the verification window, 2 to 8, or 0 for none")
+    parser.add_argument("-o", "--output", help="output file (default: stdout)")
+    args = parser.parse_args()
+
+    if not 0 <= args.teeth <= 8 or not 1 <= args.tables <= 8:
+        parser.error("--teeth must be between 0 and 8 and --tables between 1 and 8")
+    if args.g_window not in (0, 2, 3, 4, 5, 6, 7, 8):
+        parser.error("--g-window must be between 2 and 8, or 0")
+
+    if args.output:
+        with open(args.output, "w") as out:
+            generate(args.teeth, args.tables, args.g_window, out)
+    else:
+        generate(args.teeth, args.tables, args.g_window, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,203 @@
+/* Checks the secp256r1 fixed-base comb (uECC_SECP256R1_COMB_TEETH) against the Montgomery ladder,
+   then times both. It includes uECC.c to reach the static functions, so it is built on its own
+   with a generated table:
+
+       python3 scripts/secp256r1_tables.py --teeth 5 --tables 4 --g-window 0 \
+           -o /tmp/comb/secp256r1-tables.inc
+       gcc -O2 -I. -I/tmp/comb -DuECC_SECP256R1_COMB_TEETH=5 -DuECC_SECP256R1_COMB_TABLES=4 \
+           test/test_comb_secp256r1.c -o test_comb_secp256r1 */
+
+#include "uECC.c"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#if uECC_SECP256R1_COMB_TEETH
+
+#define NUM_WORDS num_words_secp256r1
+#define RANDOM_ROUNDS 2000
+#define BENCH_ROUNDS 500
+
+static uint64_t g_state = 0x243F6A8885A308D3ull;
+
+/* xorshift64*, so a failure can be reproduced */
+static uint64_t next_random(void) {
+    g_state ^= g_state >> 12;
+    g_state ^= g_state << 25;
+    g_state ^= g_state >> 27;
+    return g_state * 0x2545F4914F6CDD1Dull;
+}
+
+static int test_rng(uint8_t *dest, unsigned size) {
+    while (size) {
+        *dest++ = (uint8_t)next_random();
+        --size;
+    }
+    return 1;
+}
+
+static void vli_print(const char *str, const uECC_word_t *vli, wordcount_t num_words) {
+    wordcount_t i;
+    printf("%s ", str);
+    for (i = num_words - 1; i >= 0; --i) {
+        printf("%0*llx", (int)(uECC_WORD_SIZE * 2), (unsigned long long)vli[i]);
+    }
+    printf("\n");
+}
+
+/* Multiplies G by k both ways, with and without a random initial Z */
+static int check_scalar(const uECC_word_t *k) {
+    uECC_word_t tmp1[NUM_WORDS];
+    uECC_word_t tmp2[NUM_WORDS];
+    uECC_word_t *p2[2] = {tmp1, tmp2};
+    uECC_word_t initial_Z[NUM_WORDS];
+    uECC_word_t ladder[NUM_WORDS * 2];
+    uECC_word_t comb[NUM_WORDS * 2];
+    uECC_word_t carry = regularize_k(k, tmp1, tmp2, &curve_secp256r1);
+
+    EccPoint_mult(ladder, curve_secp256r1.G, p2[!carry], 0, curve_secp256r1.num_n_bits + 1,
+                  &curve_secp256r1);
+    EccPoint_mult_comb(comb, p2[!carry], 0, &curve_secp256r1);
+    if (EccPoint_isZero(ladder, &curve_secp256r1)) {
+        /* The co-Z ladder fails for a few scalars such as 1; the comb must still give a point */
+        if (!uECC_valid_point(comb, &curve_secp256r1)) {
+            printf("comb gives an invalid point\n");
+            vli_print("k", k, NUM_WORDS);
+            return 0;
+        }
+        uECC_vli_set(ladder, comb, NUM_WORDS * 2);
+    } else if (!uECC_vli_equal(ladder, comb, NUM_WORDS * 2)) {
+        printf("comb differs from the ladder\n");
+        vli_print("k     ", k, NUM_WORDS);
+        vli_print("ladder", ladder, NUM_WORDS * 2);
+        vli_print("comb  ", comb, NUM_WORDS * 2);
+        return 0;
+    }
+
+    uECC_generate_random_int(initial_Z, curve_secp256r1.p, NUM_WORDS);
+    EccPoint_mult_comb(comb, p2[!carry], initial_Z, &curve_secp256r1);
+    if (!uECC_vli_equal(ladder, comb, NUM_WORDS * 2)) {
+        printf("comb differs from the ladder with a random Z\n");
+        vli_print("k", k, NUM_WORDS);
+        return 0;
+    }
+    return 1;
+}
+
+/* 1, 2, the powers of two and the all-ones runs up to n - 1, and n - 1 and n - 2 */
+static int check_edges(void) {
+    uECC_word_t k[NUM_WORDS];
+    uECC_word_t one[NUM_WORDS];
+    bitcount_t bit;
+
+    uECC_vli_clear(one, NUM_WORDS);
+    one[0] = 1;
+    uECC_vli_set(k, one, NUM_WORDS);
+    if (!check_scalar(k)) {
+        return 0;
+    }
+    {
+        uECC_word_t tmp1[NUM_WORDS];
+        uECC_word_t tmp2[NUM_WORDS];
+        uECC_word_t *p2[2] = {tmp1, tmp2};
+        uECC_word_t comb[NUM_WORDS * 2];
+        uECC_word_t carry = regularize_k(one, tmp1, tmp2, &curve_secp256r1);
+        EccPoint_mult_comb(comb, p2[!carry], 0, &curve_secp256r1);
+        if (!uECC_vli_equal(comb, curve_secp256r1.G, NUM_WORDS * 2)) {
+            printf("comb gives 1 * G != G\n");
+            return 0;
+        }
+    }
+
+    for (bit = 0; bit < 256; ++bit) {
+        uECC_vli_clear(k, NUM_WORDS);
+        k[bit / uECC_WORD_BITS] = (uECC_word_t)1 << (bit % uECC_WORD_BITS);
+        if (uECC_vli_cmp_unsafe(curve_secp256r1.n, k, NUM_WORDS) == 1 && !check_scalar(k)) {
+            return 0;
+        }
+        uECC_vli_sub(k, k, one, NUM_WORDS);
+        uECC_vli_add(k, k, k, NUM_WORDS);
+        uECC_vli_add(k, k, one, NUM_WORDS);
+        if (uECC_vli_cmp_unsafe(curve_secp256r1.n, k, NUM_WORDS) == 1 && !check_scalar(k)) {
+            return 0;
+        }
+    }
+
+    uECC_vli_sub(k, curve_secp256r1.n, one, NUM_WORDS);
+    if (!check_scalar(k)) {
+        return 0;
+    }
+    uECC_vli_sub(k, k, one, NUM_WORDS);
+    return check_scalar(k);
+}
+
+static int check_random(void) {
+    uECC_word_t k[NUM_WORDS];
+    int i;
+
+    for (i = 0; i < RANDOM_ROUNDS; ++i) {
+        uECC_generate_random_int(k, curve_secp256r1.n, NUM_WORDS);
+        if (!check_scalar(k)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static double us_per_op(clock_t start) {
+    return (double)(clock() - start) * 1e6 / CLOCKS_PER_SEC / BENCH_ROUNDS;
+}
+
+static void bench(void) {
+    uECC_word_t k[NUM_WORDS];
+    uECC_word_t tmp1[NUM_WORDS];
+    uECC_word_t tmp2[NUM_WORDS];
+    uECC_word_t *p2[2] = {tmp1, tmp2};
+    uECC_word_t result[NUM_WORDS * 2];
+    uECC_word_t carry;
+    clock_t start;
+    double ladder, comb;
+    int i;
+
+    uECC_generate_random_int(k, curve_secp256r1.n, NUM_WORDS);
+    carry = regularize_k(k, tmp1, tmp2, &curve_secp256r1);
+
+    start = clock();
+    for (i = 0; i < BENCH_ROUNDS; ++i) {
+        EccPoint_mult(result, curve_secp256r1.G, p2[!carry], 0, curve_secp256r1.num_n_bits + 1,
+                      &curve_secp256r1);
+        p2[!carry][0] ^= result[0] & 1;
+    }
+    ladder = us_per_op(start);
+
+    start = clock();
+    for (i = 0; i < BENCH_ROUNDS; ++i) {
+        EccPoint_mult_comb(result, p2[!carry], 0, &curve_secp256r1);
+        p2[!carry][0] ^= result[0] & 1;
+    }
+    comb = us_per_op(start);
+
+    printf("%d teeth, %d tables (%u bytes): ladder %.1f us, comb %.1f us per k * G\n",
+           uECC_SECP256R1_COMB_TEETH, uECC_SECP256R1_COMB_TABLES,
+           (unsigned)sizeof(secp256r1_comb), ladder, comb);
+}
+
+int main() {
+    printf("Testing the secp256r1 comb with %d-bit words\n", uECC_WORD_BITS);
+    uECC_set_rng(&test_rng);
+    if (!check_edges() || !check_random()) {
+        return 1;
+    }
+    bench();
+    return 0;
+}
+
+#else
+
+int main() {
+    printf("uECC_SECP256R1_COMB_TEETH is 0, nothing to test\n");
+    return 0;
+}
+
+#endif /* uECC_SECP256R1_COMB_TEETH */
@@ -0,0 +1,155 @@
+/* Copyright 2014, Kenneth MacKay. Licensed under the BSD 2-clause license. */
+
+#include "uECC.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define NUM_SIGS 19 /* not a multiple of uECC_VERIFY_BATCH_SIZE */
+
+#if uECC_ENABLE_OP_COUNTERS
+/* Field multiplications a chunk may add per signature to share its inversions: 3 for each
+   element of the two batched inversions, and the conversion of the result from Jacobian. */
+#define SHARED_INV_MULTS 8
+
+/* Fails when verifying the batch costs more than verifying each signature on its own: it must
+   take fewer inversions and at most SHARED_INV_MULTS more multiplications per signature. */
+static int batch_is_cheaper(const uint8_t *packed_public,
+                            const uint8_t (*hash)[32],
+                            const uint8_t *packed_sig,
+                            const struct uECC_Curve_t *curve) {
+    uECC_OpCounters batch, single;
+    int public_size = uECC_curve_public_key_size(curve);
+    int i;
+
+    uECC_reset_op_counters();
+    uECC_verify_batch(packed_public, &hash[0][0], sizeof(hash[0]), packed_sig, NUM_SIGS, curve, 0);
+    uECC_get_op_counters(&batch);
+
+    uECC_reset_op_counters();
+    for (i = 0; i < NUM_SIGS; ++i) {
+        uECC_verify(packed_public + i * public_size, hash[i], sizeof(hash[i]),
+                    packed_sig + i * public_size, curve);
+    }
+    uECC_get_op_counters(&single);
+
+    printf(" batch %lu mult+square %lu inv, single %lu mult+square %lu inv",
+           (unsigned long)(batch.mod_mult + batch.mod_square), (unsigned long)batch.mod_inv,
+           (unsigned long)(single.mod_mult + single.mod_square), (unsigned long)single.mod_inv);
+    return batch.mod_inv < single.mod_inv &&
+        batch.mod_mult + batch.mod_square <=
+            single.mod_mult + single.mod_square + SHARED_INV_MULTS * NUM_SIGS;
+}
+#endif
+
+#if uECC_SUPPORTS_secp256r1
+/* Generator of secp256r1, the public key for private key 1. */
+static const uint8_t secp256r1_G[64] = {
+    0x6B, 0x17, 0xD1, 0xF2, 0xE1, 0x2C, 0x42, 0x47, 0xF8, 0xBC, 0xE6, 0xE5, 0x63, 0xA4, 0x40, 0xF2,
+    0x77, 0x03, 0x7D, 0x81, 0x2D, 0xEB, 0x33, 0xA0, 0xF4, 0xA1, 0x39, 0x45, 0xD8, 0x98, 0xC2, 0x96,
+    0x4F, 0xE3, 0x42, 0xE2, 0xFE, 0x1A, 0x7F, 0x9B, 0x8E, 0xE7, 0xEB, 0x4A, 0x7C, 0x0F, 0x9E, 0x16,
+    0x2B, 0xCE, 0x33, 0x57, 0x6B, 0x31, 0x5E, 0xCE, 0xCB, 0xB6, 0x40, 0x68, 0x37, 0xBF, 0x51, 0xF5};
+#endif
+
+int main() {
+    int i, c, round, all_valid, expected;
+    uint8_t private[32] = {0};
+    uint8_t public[NUM_SIGS][64];
+    uint8_t hash[NUM_SIGS][32];
+    uint8_t sig[NUM_SIGS][64];
+    uint8_t results[NUM_SIGS];
+
+    const struct uECC_Curve_t * curves[5];
+    int num_curves = 0;
+#if uECC_SUPPORTS_secp160r1
+    curves[num_curves++] = uECC_secp160r1();
+#endif
+#if uECC_SUPPORTS_secp192r1
+    curves[num_curves++] = uECC_secp192r1();
+#endif
+#if uECC_SUPPORTS_secp224r1
+    curves[num_curves++] = uECC_secp224r1();
+#endif
+#if uECC_SUPPORTS_secp256r1
+    curves[num_curves++] = uECC_secp256r1();
+#endif
+#if uECC_SUPPORTS_secp256k1
+    curves[num_curves++] = uECC_secp256k1();
+#endif
+
+    printf("Testing batches of %d signatures\n", NUM_SIGS);
+    for (c = 0; c < num_curves; ++c) {
+        int private_size = uECC_curve_private_key_size(curves[c]);
+        int public_size = uECC_curve_public_key_size(curves[c]);
+        int curve_size = public_size / 2;
+        uint8_t packed_public[NUM_SIGS * 64];
+        uint8_t packed_sig[NUM_SIGS * 64];
+
+        for (round = 0; round < 16; ++round) {
+            printf(".");
+            fflush(stdout);
+
+            for (i = 0; i < NUM_SIGS; ++i) {
+            #if uECC_SUPPORTS_secp256r1
+                if (i == 3 && curves[c] == uECC_secp256r1()) {
+                    /* Q == G adds multiples of G to each other; the batch must still agree. */
+                    memset(private, 0, sizeof(private));
+                    private[private_size - 1] = 1;
+                    memcpy(public[i], secp256r1_G, sizeof(secp256r1_G));
+                } else
+            #endif
+                if (!uECC_make_key(public[i], private, curves[c])) {
+                    printf("uECC_make_key() failed\n");
+                    return 1;
+                }
+                memcpy(hash[i], public[i], sizeof(hash[i]));
+                hash[i][0] ^= (uint8_t)round;
+
+                if (!uECC_sign(private, hash[i], sizeof(hash[i]), sig[i], curves[c])) {
+                    printf("uECC_sign() failed\n");
+                    return 1;
+                }
+            }
+
+            /* Break a few signatures in different ways on odd rounds. */
+            if (round & 1) {
+                sig[round % NUM_SIGS][curve_size + 1] ^= 0x01;      /* wrong s */
+                hash[(round + 5) % NUM_SIGS][2] ^= 0x80;            /* wrong hash */
+                memset(sig[(round + 11) % NUM_SIGS], 0, curve_size); /* r == 0 */
+            }
+
+            for (i = 0; i < NUM_SIGS; ++i) {
+                memcpy(packed_public + i * public_size, public[i], public_size);
+                memcpy(packed_sig + i * 2 * curve_size, sig[i], 2 * curve_size);
+            }
+
+            memset(results, 0xFF, sizeof(results));
+            all_valid = uECC_verify_batch(packed_public, &hash[0][0], sizeof(hash[0]), packed_sig,
+                                          NUM_SIGS, curves[c], results);
+
+            expected = 1;
+            for (i = 0; i < NUM_SIGS; ++i) {
+                int valid = uECC_verify(public[i], hash[i], sizeof(hash[i]), sig[i], curves[c]);
+                if (results[i] != valid) {
+                    printf("uECC_verify_batch() disagrees with uECC_verify() on signature %d\n", i);
+                    return 1;
+                }
+                expected &= valid;
+            }
+
+            if (all_valid != expected) {
+                printf("uECC_verify_batch() returned the wrong overall result\n");
+                return 1;
+            }
+        }
+    #if uECC_ENABLE_OP_COUNTERS
+        if (!batch_is_cheaper(packed_public, hash, packed_sig, curves[c])) {
+            printf("\nuECC_verify_batch() costs more than uECC_verify() per signature\n");
+            return 1;
+        }
+    #endif
+        printf("\n");
+    }
+
+    return 0;
+}
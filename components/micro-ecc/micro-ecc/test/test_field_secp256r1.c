@@ -0,0 +1,291 @@
+/* Checks the unrolled secp256r1 field kernels (field-secp256r1.inc) against the generic
+   uECC_vli_mult() / curve->mmod_fast / uECC_vli_mmod() path, then times each primitive both
+   ways. It includes uECC.c to reach the static functions, so it is built on its own:
+
+       gcc -O2 -I. test/test_field_secp256r1.c -o test_field_secp256r1
+       gcc -O2 -I. -DuECC_WORD_SIZE=4 test/test_field_secp256r1.c -o test_field_secp256r1_32 */
+
+#define uECC_SUPPORTS_secp160r1 0
+#define uECC_SUPPORTS_secp192r1 0
+#define uECC_SUPPORTS_secp224r1 0
+#define uECC_SUPPORTS_secp256k1 0
+
+#include "uECC.c"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#if uECC_SECP256R1_UNROLLED
+
+#define NUM_WORDS num_words_secp256r1
+#define RANDOM_ROUNDS 200000
+#define BENCH_ROUNDS 1000000
+
+static uint64_t g_state = 0x9E3779B97F4A7C15ull;
+
+/* xorshift64*, so a failure can be reproduced */
+static uint64_t next_random(void) {
+    g_state ^= g_state >> 12;
+    g_state ^= g_state << 25;
+    g_state ^= g_state >> 27;
+    return g_state * 0x2545F4914F6CDD1Dull;
+}
+
+static void random_vli(uECC_word_t *vli, wordcount_t num_words) {
+    wordcount_t i;
+    for (i = 0; i < num_words; ++i) {
+        vli[i] = (uECC_word_t)next_random();
+    }
+}
+
+/* A random value below p */
+static void random_element(uECC_word_t *vli) {
+    do {
+        random_vli(vli, NUM_WORDS);
+    } while (uECC_vli_cmp_unsafe(curve_secp256r1.p, vli, NUM_WORDS) != 1);
+}
+
+/* Sets the 32-bit pieces of a 512-bit product to 0 or 0xFFFFFFFF following the bits of mask */
+static void pattern_product(uECC_word_t *product, unsigned mask) {
+    unsigned i;
+    uECC_vli_clear(product, NUM_WORDS * 2);
+    for (i = 0; i < 16; ++i) {
+        if (mask & (1u << i)) {
+            product[i * 32 / uECC_WORD_BITS] |= (uECC_word_t)0xFFFFFFFF << ((i * 32) % uECC_WORD_BITS);
+        }
+    }
+}
+
+static void vli_print(const char *str, const uECC_word_t *vli, wordcount_t num_words) {
+    wordcount_t i;
+    printf("%s ", str);
+    for (i = num_words - 1; i >= 0; --i) {
+        printf("%0*llx", (int)(uECC_WORD_SIZE * 2), (unsigned long long)vli[i]);
+    }
+    printf("\n");
+}
+
+static int check_reduce(const uECC_word_t *product) {
+    uECC_word_t copy[NUM_WORDS * 2];
+    uECC_word_t unrolled[NUM_WORDS];
+    uECC_word_t fast[NUM_WORDS];
+    uECC_word_t slow[NUM_WORDS];
+
+    vli_mmod_secp256r1(unrolled, product);
+    uECC_vli_set(copy, product, NUM_WORDS * 2);
+    curve_secp256r1.mmod_fast(fast, copy);
+    uECC_vli_set(copy, product, NUM_WORDS * 2);
+    uECC_vli_mmod(slow, copy, curve_secp256r1.p, NUM_WORDS);
+
+    if (!uECC_vli_equal(unrolled, fast, NUM_WORDS) || !uECC_vli_equal(unrolled, slow, NUM_WORDS)) {
+        printf("reduction differs\n");
+        vli_print("product ", product, NUM_WORDS * 2);
+        vli_print("unrolled", unrolled, NUM_WORDS);
+        vli_print("mmod_fast", fast, NUM_WORDS);
+        vli_print("mmod    ", slow, NUM_WORDS);
+        return 0;
+    }
+    return 1;
+}
+
+static int check_random(void) {
+    uECC_word_t a[NUM_WORDS];
+    uECC_word_t b[NUM_WORDS];
+    uECC_word_t expected[NUM_WORDS * 2];
+    uECC_word_t actual[NUM_WORDS * 2];
+    int i;
+
+    for (i = 0; i < RANDOM_ROUNDS; ++i) {
+        random_vli(a, NUM_WORDS);
+        random_vli(b, NUM_WORDS);
+        uECC_vli_mult(expected, a, b, NUM_WORDS);
+        vli_mult_secp256r1(actual, a, b);
+        if (!uECC_vli_equal(expected, actual, NUM_WORDS * 2)) {
+            printf("multiplication differs\n");
+            vli_print("a", a, NUM_WORDS);
+            vli_print("b", b, NUM_WORDS);
+            return 0;
+        }
+
+        uECC_vli_mult(expected, a, a, NUM_WORDS);
+        vli_square_secp256r1(actual, a);
+        if (!uECC_vli_equal(expected, actual, NUM_WORDS * 2)) {
+            printf("squaring differs\n");
+            vli_print("a", a, NUM_WORDS);
+            return 0;
+        }
+
+        random_vli(expected, NUM_WORDS * 2);
+        if (!check_reduce(expected)) {
+            return 0;
+        }
+
+        random_element(a);
+        random_element(b);
+        uECC_vli_modMult(expected, a, b, curve_secp256r1.p, NUM_WORDS);
+        uECC_vli_modMult_fast(actual, a, b, &curve_secp256r1);
+        if (!uECC_vli_equal(expected, actual, NUM_WORDS)) {
+            printf("modular multiplication differs\n");
+            vli_print("a", a, NUM_WORDS);
+            vli_print("b", b, NUM_WORDS);
+            return 0;
+        }
+
+        uECC_vli_modMult(expected, a, a, curve_secp256r1.p, NUM_WORDS);
+        uECC_vli_modSquare_fast(actual, a, &curve_secp256r1);
+        if (!uECC_vli_equal(expected, actual, NUM_WORDS)) {
+            printf("modular squaring differs\n");
+            vli_print("a", a, NUM_WORDS);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Every product whose 32-bit pieces are all 0 or all 1, which covers the largest positive and
+   negative carries of the reduction, and the products of p - 1, p - 2, 1 and 0 */
+static int check_edges(void) {
+    uECC_word_t values[4][NUM_WORDS];
+    uECC_word_t product[NUM_WORDS * 2];
+    uECC_word_t one[NUM_WORDS];
+    unsigned mask;
+    int i, j;
+
+    for (mask = 0; mask < 0x10000; ++mask) {
+        pattern_product(product, mask);
+        if (!check_reduce(product)) {
+            return 0;
+        }
+    }
+
+    uECC_vli_clear(one, NUM_WORDS);
+    one[0] = 1;
+    uECC_vli_sub(values[0], curve_secp256r1.p, one, NUM_WORDS);
+    uECC_vli_sub(values[1], values[0], one, NUM_WORDS);
+    uECC_vli_set(values[2], one, NUM_WORDS);
+    uECC_vli_clear(values[3], NUM_WORDS);
+    for (i = 0; i < 4; ++i) {
+        for (j = 0; j < 4; ++j) {
+            uECC_word_t expected[NUM_WORDS];
+            uECC_word_t actual[NUM_WORDS];
+            uECC_vli_mult(product, values[i], values[j], NUM_WORDS);
+            if (!check_reduce(product)) {
+                return 0;
+            }
+            uECC_vli_modMult(expected, values[i], values[j], curve_secp256r1.p, NUM_WORDS);
+            uECC_vli_modMult_fast(actual, values[i], values[j], &curve_secp256r1);
+            if (!uECC_vli_equal(expected, actual, NUM_WORDS)) {
+                printf("modular multiplication differs for edge values %d and %d\n", i, j);
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+static double ns_per_op(clock_t start) {
+    return (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / BENCH_ROUNDS;
+}
+
+/* Each result feeds the next call, so nothing can be hoisted out of the loops */
+static void bench(void) {
+    uECC_word_t a[NUM_WORDS];
+    uECC_word_t b[NUM_WORDS];
+    uECC_word_t product[NUM_WORDS * 2];
+    clock_t start;
+    int i;
+    double generic, unrolled;
+
+    random_element(a);
+    random_element(b);
+    printf("%-10s %12s %12s\n", "primitive", "generic ns", "unrolled ns");
+
+    start = clock();
+    for (i = 0; i < BENCH_ROUNDS; ++i) {
+        uECC_vli_mult(product, a, b, NUM_WORDS);
+        a[0] ^= product[NUM_WORDS];
+    }
+    generic = ns_per_op(start);
+    start = clock();
+    for (i = 0; i < BENCH_ROUNDS; ++i) {
+        vli_mult_secp256r1(product, a, b);
+        a[0] ^= product[NUM_WORDS];
+    }
+    unrolled = ns_per_op(start);
+    printf("%-10s %12.1f %12.1f\n", "mult", generic, unrolled);
+
+    start = clock();
+    for (i = 0; i < BENCH_ROUNDS; ++i) {
+        uECC_vli_mult(product, a, a, NUM_WORDS);
+        a[0] ^= product[NUM_WORDS];
+    }
+    generic = ns_per_op(start);
+    start = clock();
+    for (i = 0; i < BENCH_ROUNDS; ++i) {
+        vli_square_secp256r1(product, a);
+        a[0] ^= product[NUM_WORDS];
+    }
+    unrolled = ns_per_op(start);
+    printf("%-10s %12.1f %12.1f\n", "square", generic, unrolled);
+
+    random_vli(product, NUM_WORDS * 2);
+    start = clock();
+    for (i = 0; i < BENCH_ROUNDS; ++i) {
+        curve_secp256r1.mmod_fast(a, product);
+        product[0] ^= a[0];
+    }
+    generic = ns_per_op(start);
+    start = clock();
+    for (i = 0; i < BENCH_ROUNDS; ++i) {
+        vli_mmod_secp256r1(a, product);
+        product[0] ^= a[0];
+    }
+    unrolled = ns_per_op(start);
+    printf("%-10s %12.1f %12.1f\n", "reduce", generic, unrolled);
+
+    random_element(a);
+    start = clock();
+    for (i = 0; i < BENCH_ROUNDS; ++i) {
+        uECC_vli_mult(product, a, b, NUM_WORDS);
+        curve_secp256r1.mmod_fast(a, product);
+    }
+    generic = ns_per_op(start);
+    start = clock();
+    for (i = 0; i < BENCH_ROUNDS; ++i) {
+        uECC_vli_modMult_fast(a, a, b, &curve_secp256r1);
+    }
+    unrolled = ns_per_op(start);
+    printf("%-10s %12.1f %12.1f\n", "modMult", generic, unrolled);
+
+    start = clock();
+    for (i = 0; i < BENCH_ROUNDS; ++i) {
+        uECC_vli_mult(product, a, a, NUM_WORDS);
+        curve_secp256r1.mmod_fast(a, product);
+    }
+    generic = ns_per_op(start);
+    start = clock();
+    for (i = 0; i < BENCH_ROUNDS; ++i) {
+        uECC_vli_modSquare_fast(a, a, &curve_secp256r1);
+    }
+    unrolled = ns_per_op(start);
+    printf("%-10s %12.1f %12.1f\n", "modSquare", generic, unrolled);
+}
+
+int main() {
+    printf("Testing the unrolled secp256r1 kernels with %d-bit words\n", uECC_WORD_BITS);
+    if (!check_edges() || !check_random()) {
+        return 1;
+    }
+    bench();
+    return 0;
+}
+
+#else
+
+int main() {
+    printf("uECC_SECP256R1_UNROLLED is not used in this configuration, nothing to test\n");
+    return 0;
+}
+
+#endif /* uECC_SECP256R1_UNROLLED */
@@ -0,0 +1,172 @@
+/* Copyright 2014, Kenneth MacKay. Licensed under the BSD 2-clause license. */
+
+#include "uECC.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if uECC_ENABLE_OP_COUNTERS
+
+static void print_counters(const char *name, const uECC_OpCounters *counters) {
+    printf("  %-10s %6lu mult %6lu square %3lu inv %4lu double %4lu add %4lu addC %4lu affine\n",
+           name,
+           (unsigned long)counters->mod_mult,
+           (unsigned long)counters->mod_square,
+           (unsigned long)counters->mod_inv,
+           (unsigned long)counters->double_jacobian,
+           (unsigned long)counters->xycz_add,
+           (unsigned long)counters->xycz_addc,
+           (unsigned long)counters->affine_add);
+}
+
+/* Whether uECC_make_key() and uECC_sign() use the fixed-base comb instead of the ladder */
+static int uses_comb(const struct uECC_Curve_t *curve) {
+#if uECC_SECP256R1_COMB_TEETH
+    return curve == uECC_secp256r1();
+#else
+    (void)curve;
+    return 0;
+#endif
+}
+
+/* Whether uECC_verify() reads the generator's window from flash instead of building it */
+static int verify_g_precomputed(const struct uECC_Curve_t *curve) {
+#if uECC_SECP256R1_WNAF_G_WINDOW
+    return curve == uECC_secp256r1();
+#else
+    (void)curve;
+    return 0;
+#endif
+}
+
+static int comb_counts_match(const uECC_OpCounters *counters) {
+#if uECC_SECP256R1_COMB_TEETH
+    const unsigned teeth = uECC_SECP256R1_COMB_TEETH * uECC_SECP256R1_COMB_TABLES;
+    const unsigned columns = (257 + teeth - 1) / teeth;
+    return counters->double_jacobian == columns - 1 && counters->mod_inv == 1 &&
+        counters->affine_add == uECC_SECP256R1_COMB_TABLES * columns - 1 &&
+        counters->xycz_add == 0 && counters->xycz_addc == 0;
+#else
+    (void)counters;
+    return 0;
+#endif
+}
+
+int main() {
+    int i, c;
+    unsigned windows;
+    uint8_t private[32] = {0};
+    uint8_t public[64] = {0};
+    uint8_t hash[32] = {0};
+    uint8_t sig[64] = {0};
+    uECC_OpCounters make_key, sign, verify, again;
+
+    const struct uECC_Curve_t * curves[5];
+    const char *names[5];
+    int num_curves = 0;
+#if uECC_SUPPORTS_secp160r1
+    names[num_curves] = "secp160r1";
+    curves[num_curves++] = uECC_secp160r1();
+#endif
+#if uECC_SUPPORTS_secp192r1
+    names[num_curves] = "secp192r1";
+    curves[num_curves++] = uECC_secp192r1();
+#endif
+#if uECC_SUPPORTS_secp224r1
+    names[num_curves] = "secp224r1";
+    curves[num_curves++] = uECC_secp224r1();
+#endif
+#if uECC_SUPPORTS_secp256r1
+    names[num_curves] = "secp256r1";
+    curves[num_curves++] = uECC_secp256r1();
+#endif
+#if uECC_SUPPORTS_secp256k1
+    names[num_curves] = "secp256k1";
+    curves[num_curves++] = uECC_secp256k1();
+#endif
+
+    for (c = 0; c < num_curves; ++c) {
+        printf("%s\n", names[c]);
+        for (i = 0; i < 4; ++i) {
+            uECC_reset_op_counters();
+            if (!uECC_make_key(public, private, curves[c])) {
+                printf("uECC_make_key() failed\n");
+                return 1;
+            }
+            uECC_get_op_counters(&make_key);
+
+            memcpy(hash, public, sizeof(hash));
+            uECC_reset_op_counters();
+            if (!uECC_sign(private, hash, sizeof(hash), sig, curves[c])) {
+                printf("uECC_sign() failed\n");
+                return 1;
+            }
+            uECC_get_op_counters(&sign);
+
+            uECC_reset_op_counters();
+            if (!uECC_verify(public, hash, sizeof(hash), sig, curves[c])) {
+                printf("uECC_verify() failed\n");
+                return 1;
+            }
+            uECC_get_op_counters(&verify);
+
+            /* The Montgomery ladder does one doubling, an addC and an add per bit, and one
+               inversion for the final Z. The comb doubles once per column but the first and
+               adds one entry of every table per column but the first lookup. */
+            if (uses_comb(curves[c]) ? !comb_counts_match(&make_key) :
+                    (make_key.double_jacobian != 1 || make_key.mod_inv != 1 ||
+                     make_key.xycz_addc != make_key.xycz_add || make_key.affine_add != 0)) {
+                printf("unexpected uECC_make_key() counts\n");
+                print_counters("make_key", &make_key);
+                return 1;
+            }
+            /* Signing adds the inversion of k (mod n) to the same multiplication. */
+            if (sign.mod_inv != 2 || sign.xycz_add != make_key.xycz_add ||
+                sign.xycz_addc != make_key.xycz_addc || sign.affine_add != make_key.affine_add ||
+                sign.double_jacobian != make_key.double_jacobian) {
+                printf("unexpected uECC_sign() counts\n");
+                print_counters("make_key", &make_key);
+                print_counters("sign", &sign);
+                return 1;
+            }
+            /* 1/s, one for each window built beyond P itself, and the final Z. A window of
+               2^(w - 2) odd multiples takes a doubling and one co-Z add per multiple after the
+               first; the scalars are then added as affine points. */
+            windows = verify_g_precomputed(curves[c]) ? 1 : 2;
+            if (verify.mod_inv != 2 + (uECC_VERIFY_WNAF_WINDOW > 2 ? windows : 0) ||
+                verify.xycz_add != windows * ((1u << (uECC_VERIFY_WNAF_WINDOW - 2)) - 1) ||
+                verify.xycz_addc != 0 || verify.affine_add == 0 ||
+                verify.double_jacobian == 0 || verify.mod_mult == 0 || verify.mod_square == 0) {
+                printf("unexpected uECC_verify() counts\n");
+                print_counters("verify", &verify);
+                return 1;
+            }
+
+            /* The same inputs cost the same, and reset starts from zero. */
+            uECC_reset_op_counters();
+            uECC_verify(public, hash, sizeof(hash), sig, curves[c]);
+            uECC_get_op_counters(&again);
+            if (memcmp(&again, &verify, sizeof(again)) != 0) {
+                printf("uECC_verify() counts differ between two identical calls\n");
+                return 1;
+            }
+
+            if (i == 0) {
+                print_counters("make_key", &make_key);
+                print_counters("sign", &sign);
+                print_counters("verify", &verify);
+            }
+        }
+    }
+
+    return 0;
+}
+
+#else
+
+int main() {
+    printf("uECC_ENABLE_OP_COUNTERS is 0, nothing to test\n");
+    return 0;
+}
+
+#endif /* uECC_ENABLE_OP_COUNTERS */
@@ -0,0 +1,128 @@
+/* Copyright 2014, Kenneth MacKay. Licensed under the BSD 2-clause license. */
+
+/* Also checks uECC_verify_antifault(), so it is linked with the ESP-IDF wrapper, which
+   includes uECC.c, instead of uECC.c itself:
+
+       gcc -O2 -I. -I.. test/test_verify_precomp.c ../uECC_verify_antifault.c -o test_verify_precomp */
+
+#include "uECC.h"
+#include "uECC_verify_antifault.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_KEYS 4
+#define NUM_ROUNDS 64
+
+int main() {
+    int i, c, round;
+    uint8_t private[NUM_KEYS][32];
+    uint8_t public[NUM_KEYS][64];
+    uint8_t hash[32] = {0};
+    uint8_t sig[64];
+    uint8_t verified[32];
+    uint8_t *precomp[NUM_KEYS];
+
+    const struct uECC_Curve_t * curves[5];
+    int num_curves = 0;
+#if uECC_SUPPORTS_secp160r1
+    curves[num_curves++] = uECC_secp160r1();
+#endif
+#if uECC_SUPPORTS_secp192r1
+    curves[num_curves++] = uECC_secp192r1();
+#endif
+#if uECC_SUPPORTS_secp224r1
+    curves[num_curves++] = uECC_secp224r1();
+#endif
+#if uECC_SUPPORTS_secp256r1
+    curves[num_curves++] = uECC_secp256r1();
+#endif
+#if uECC_SUPPORTS_secp256k1
+    curves[num_curves++] = uECC_secp256k1();
+#endif
+
+    printf("Testing precomputed verification (%d bytes per key)\n", uECC_verify_precomp_size());
+    for (i = 0; i < NUM_KEYS; ++i) {
+        precomp[i] = (uint8_t *)malloc(uECC_verify_precomp_size());
+        if (!precomp[i]) {
+            printf("malloc() failed\n");
+            return 1;
+        }
+    }
+
+    for (c = 0; c < num_curves; ++c) {
+        int curve_size = uECC_curve_public_key_size(curves[c]) / 2;
+
+        for (i = 0; i < NUM_KEYS; ++i) {
+            if (!uECC_make_key(public[i], private[i], curves[c])) {
+                printf("uECC_make_key() failed\n");
+                return 1;
+            }
+            if (!uECC_verify_precompute(public[i], precomp[i], curves[c])) {
+                printf("uECC_verify_precompute() rejected a valid key\n");
+                return 1;
+            }
+        }
+
+        /* Each key is used many times, with the signatures broken in different ways on odd
+           rounds; the result must always be the same as uECC_verify(). */
+        for (round = 0; round < NUM_ROUNDS; ++round) {
+            int k = round % NUM_KEYS;
+            int expected, actual;
+
+            printf(".");
+            fflush(stdout);
+            memcpy(hash, public[(round + 1) % NUM_KEYS], sizeof(hash));
+            hash[0] ^= (uint8_t)round;
+            if (!uECC_sign(private[k], hash, sizeof(hash), sig, curves[c])) {
+                printf("uECC_sign() failed\n");
+                return 1;
+            }
+            switch (round & 7) {
+            case 1:
+                sig[curve_size + 1] ^= 0x01; /* wrong s */
+                break;
+            case 3:
+                hash[2] ^= 0x80; /* wrong hash */
+                break;
+            case 5:
+                memset(sig, 0, curve_size); /* r == 0 */
+                break;
+            case 7:
+                k = (k + 1) % NUM_KEYS; /* another key */
+                break;
+            }
+
+            expected = uECC_verify(public[k], hash, sizeof(hash), sig, curves[c]);
+            actual = uECC_verify_precomputed(precomp[k], hash, sizeof(hash), sig, curves[c]);
+            if (expected != actual || expected != !(round & 1)) {
+                printf("uECC_verify_precomputed() returned %d, uECC_verify() %d, in round %d\n",
+                       actual, expected, round);
+                return 1;
+            }
+
+            /* uECC_verify_antifault() copies the hash only when it accepts. */
+            memset(verified, 0, sizeof(verified));
+            actual = uECC_verify_antifault(public[k], hash, sizeof(hash), sig, curves[c], verified);
+            if (actual != expected || (memcmp(verified, hash, sizeof(hash)) == 0) != expected) {
+                printf("uECC_verify_antifault() returned %d, uECC_verify() %d, in round %d\n",
+                       actual, expected, round);
+                return 1;
+            }
+        }
+
+        /* A point that is not on the curve is refused. */
+        public[0][2 * curve_size - 1] ^= 0x01;
+        if (uECC_verify_precompute(public[0], precomp[0], curves[c])) {
+            printf("uECC_verify_precompute() accepted an invalid key\n");
+            return 1;
+        }
+        printf("\n");
+    }
+
+    for (i = 0; i < NUM_KEYS; ++i) {
+        free(precomp[i]);
+    }
+    return 0;
+}
@@ -7,6 +7,22 @@
     #define uECC_RNG_MAX_TRIES 64
 #endif
 
+#if uECC_ENABLE_OP_COUNTERS
+static uECC_OpCounters g_op_counters;
+    #define uECC_COUNT_OP(op) (++g_op_counters.op)
+
+void uECC_reset_op_counters(void) {
+    uECC_OpCounters zero = {0};
+    g_op_counters = zero;
+}
+
+void uECC_get_op_counters(uECC_OpCounters *counters) {
+    *counters = g_op_counters;
+}
+#else
+    #define uECC_COUNT_OP(op)
+#endif
+
 #if uECC_ENABLE_VLI_API
     #define uECC_VLI_API
 #else
@@ -186,6 +202,45 @@ static cmpresult_t uECC_vli_cmp_unsafe(const uECC_word_t *left,
     #include "asm_avr.inc"
 #endif
 
+#if uECC_SECP256R1_UNROLLED
+    #if (uECC_SUPPORTS_secp160r1 || uECC_SUPPORTS_secp192r1 || uECC_SUPPORTS_secp224r1 || \
+            uECC_SUPPORTS_secp256k1 || !uECC_SUPPORTS_secp256r1)
+        #error "uECC_SECP256R1_UNROLLED requires secp256r1 to be the only supported curve"
+    #endif
+    /* The unrolled kernels are C for 32- and 64-bit words; keep the generic path otherwise */
+    #if (uECC_WORD_SIZE == 1) || (uECC_OPTIMIZATION_LEVEL == 0) || asm_mult
+        #undef uECC_SECP256R1_UNROLLED
+        #define uECC_SECP256R1_UNROLLED 0
+    #endif
+#endif
+
+#if uECC_SECP256R1_COMB_TEETH
+    #if !uECC_SUPPORTS_secp256r1
+        #error "uECC_SECP256R1_COMB_TEETH requires secp256r1 support"
+    #endif
+    #if (uECC_SECP256R1_COMB_TEETH > 8) || (uECC_SECP256R1_COMB_TABLES < 1) || \
+            (uECC_SECP256R1_COMB_TABLES > 8)
+        #error "uECC_SECP256R1_COMB_TEETH and uECC_SECP256R1_COMB_TABLES must be 1 to 8"
+    #endif
+#endif
+
+#if (uECC_VERIFY_WNAF_WINDOW < 2) || (uECC_VERIFY_WNAF_WINDOW > 6)
+    #error "uECC_VERIFY_WNAF_WINDOW must be 2 to 6"
+#endif
+
+#if (uECC_VERIFY_PRECOMP_WINDOW < 2) || (uECC_VERIFY_PRECOMP_WINDOW > 8)
+    #error "uECC_VERIFY_PRECOMP_WINDOW must be 2 to 8"
+#endif
+
+#if uECC_SECP256R1_WNAF_G_WINDOW
+    #if !uECC_SUPPORTS_secp256r1
+        #error "uECC_SECP256R1_WNAF_G_WINDOW requires secp256r1 support"
+    #endif
+    #if (uECC_SECP256R1_WNAF_G_WINDOW < 2) || (uECC_SECP256R1_WNAF_G_WINDOW > 8)
+        #error "uECC_SECP256R1_WNAF_G_WINDOW must be 2 to 8"
+    #endif
+#endif
+
 #if default_RNG_defined
 static uECC_RNG_Function g_rng_function = &default_RNG;
 #else
@@ -368,7 +423,7 @@ uECC_VLI_API uECC_word_t uECC_vli_sub(uECC_word_t *result,
 }
 #endif /* !asm_sub */
 
-#if !asm_mult || (uECC_SQUARE_FUNC && !asm_square) || \
+#if !asm_mult || (uECC_SQUARE_FUNC && !asm_square) || uECC_SECP256R1_UNROLLED || \
     (uECC_SUPPORTS_secp256k1 && (uECC_OPTIMIZATION_LEVEL > 0) && \
         ((uECC_WORD_SIZE == 1) || (uECC_WORD_SIZE == 8)))
 static void muladd(uECC_word_t a,
@@ -445,9 +500,7 @@ uECC_VLI_API void uECC_vli_mult(uECC_word_t *result,
 }
 #endif /* !asm_mult */
 
-#if uECC_SQUARE_FUNC
-
-#if !asm_square
+#if (uECC_SQUARE_FUNC && !asm_square) || uECC_SECP256R1_UNROLLED
 static void mul2add(uECC_word_t a,
                     uECC_word_t b,
                     uECC_word_t *r0,
@@ -494,7 +547,12 @@ static void mul2add(uECC_word_t a,
     *r0 = (uECC_word_t)r01;
 #endif
 }
+#endif /* mul2add needed */
+
+#if uECC_SQUARE_FUNC
 
+/* With the unrolled secp256r1 kernels, only the VLI API uses the generic squaring */
+#if !asm_square && (!uECC_SECP256R1_UNROLLED || uECC_ENABLE_VLI_API)
 uECC_VLI_API void uECC_vli_square(uECC_word_t *result,
                                   const uECC_word_t *left,
                                   wordcount_t num_words) {
@@ -521,7 +579,7 @@ uECC_VLI_API void uECC_vli_square(uECC_word_t *result,
 
     result[num_words * 2 - 1] = r0;
 }
-#endif /* !asm_square */
+#endif /* !asm_square && (!uECC_SECP256R1_UNROLLED || uECC_ENABLE_VLI_API) */
 
 #else /* uECC_SQUARE_FUNC */
 
@@ -619,11 +677,30 @@ uECC_VLI_API void uECC_vli_modMult(uECC_word_t *result,
     uECC_vli_mmod(result, product, mod, num_words);
 }
 
+#if uECC_SECP256R1_UNROLLED
+
+#include "field-secp256r1.inc"
+
+/* secp256r1 is the only curve, so `curve` is not needed */
+uECC_VLI_API void uECC_vli_modMult_fast(uECC_word_t *result,
+                                        const uECC_word_t *left,
+                                        const uECC_word_t *right,
+                                        uECC_Curve curve) {
+    uECC_word_t product[2 * uECC_MAX_WORDS];
+    (void)curve;
+    uECC_COUNT_OP(mod_mult);
+    vli_mult_secp256r1(product, left, right);
+    vli_mmod_secp256r1(result, product);
+}
+
+#else /* uECC_SECP256R1_UNROLLED */
+
 uECC_VLI_API void uECC_vli_modMult_fast(uECC_word_t *result,
                                         const uECC_word_t *left,
                                         const uECC_word_t *right,
                                         uECC_Curve curve) {
     uECC_word_t product[2 * uECC_MAX_WORDS];
+    uECC_COUNT_OP(mod_mult);
     uECC_vli_mult(product, left, right, curve->num_words);
 #if (uECC_OPTIMIZATION_LEVEL > 0)
     curve->mmod_fast(result, product);
@@ -632,6 +709,8 @@ uECC_VLI_API void uECC_vli_modMult_fast(uECC_word_t *result,
 #endif
 }
 
+#endif /* uECC_SECP256R1_UNROLLED */
+
 #if uECC_SQUARE_FUNC
 
 #if uECC_ENABLE_VLI_API
@@ -646,10 +725,12 @@ uECC_VLI_API void uECC_vli_modSquare(uECC_word_t *result,
 }
 #endif /* uECC_ENABLE_VLI_API */
 
+#if !uECC_SECP256R1_UNROLLED
 uECC_VLI_API void uECC_vli_modSquare_fast(uECC_word_t *result,
                                           const uECC_word_t *left,
                                           uECC_Curve curve) {
     uECC_word_t product[2 * uECC_MAX_WORDS];
+    uECC_COUNT_OP(mod_square);
     uECC_vli_square(product, left, curve->num_words);
 #if (uECC_OPTIMIZATION_LEVEL > 0)
     curve->mmod_fast(result, product);
@@ -657,6 +738,7 @@ uECC_VLI_API void uECC_vli_modSquare_fast(uECC_word_t *result,
     uECC_vli_mmod(result, product, curve->p, curve->num_words);
 #endif
 }
+#endif /* !uECC_SECP256R1_UNROLLED */
 
 #else /* uECC_SQUARE_FUNC */
 
@@ -669,14 +751,34 @@ uECC_VLI_API void uECC_vli_modSquare(uECC_word_t *result,
 }
 #endif /* uECC_ENABLE_VLI_API */
 
+#if !uECC_SECP256R1_UNROLLED
 uECC_VLI_API void uECC_vli_modSquare_fast(uECC_word_t *result,
                                           const uECC_word_t *left,
                                           uECC_Curve curve) {
+#if uECC_ENABLE_OP_COUNTERS
+    /* Counted as a squaring, not as the multiplication below */
+    uECC_COUNT_OP(mod_square);
+    --g_op_counters.mod_mult;
+#endif
     uECC_vli_modMult_fast(result, left, left, curve);
 }
+#endif /* !uECC_SECP256R1_UNROLLED */
 
 #endif /* uECC_SQUARE_FUNC */
 
+#if uECC_SECP256R1_UNROLLED
+/* The unrolled squaring is used whatever uECC_SQUARE_FUNC is */
+uECC_VLI_API void uECC_vli_modSquare_fast(uECC_word_t *result,
+                                          const uECC_word_t *left,
+                                          uECC_Curve curve) {
+    uECC_word_t product[2 * uECC_MAX_WORDS];
+    (void)curve;
+    uECC_COUNT_OP(mod_square);
+    vli_square_secp256r1(product, left);
+    vli_mmod_secp256r1(result, product);
+}
+#endif /* uECC_SECP256R1_UNROLLED */
+
 #define EVEN(vli) (!(vli[0] & 1))
 static void vli_modInv_update(uECC_word_t *uv,
                               const uECC_word_t *mod,
@@ -700,6 +802,7 @@ uECC_VLI_API void uECC_vli_modInv(uECC_word_t *result,
     uECC_word_t a[uECC_MAX_WORDS], b[uECC_MAX_WORDS], u[uECC_MAX_WORDS], v[uECC_MAX_WORDS];
     cmpresult_t cmpResult;
 
+    uECC_COUNT_OP(mod_inv);
     if (uECC_vli_isZero(input, num_words)) {
         uECC_vli_clear(result, num_words);
         return;
@@ -745,6 +848,12 @@ uECC_VLI_API void uECC_vli_modInv(uECC_word_t *result,
 /* Returns 1 if 'point' is the point at infinity, 0 otherwise. */
 #define EccPoint_isZero(point, curve) uECC_vli_isZero((point), (curve)->num_words * 2)
 
+#if uECC_SECP256R1_UNROLLED
+    #define EccPoint_double_jacobian(X1, Y1, Z1, curve) double_jacobian_default(X1, Y1, Z1, curve)
+#else
+    #define EccPoint_double_jacobian(X1, Y1, Z1, curve) (curve)->double_jacobian(X1, Y1, Z1, curve)
+#endif
+
 /* Point multiplication algorithm using Montgomery's ladder with co-Z coordinates.
 From http://eprint.iacr.org/2011/338.pdf
 */
@@ -782,7 +891,7 @@ static void XYcZ_initial_double(uECC_word_t * X1,
     uECC_vli_set(Y2, Y1, num_words);
 
     apply_z(X1, Y1, z, curve);
-    curve->double_jacobian(X1, Y1, z, curve);
+    EccPoint_double_jacobian(X1, Y1, z, curve);
     apply_z(X2, Y2, z, curve);
 }
 
@@ -799,6 +908,8 @@ static void XYcZ_add(uECC_word_t * X1,
     uECC_word_t t5[uECC_MAX_WORDS];
     wordcount_t num_words = curve->num_words;
 
+    uECC_COUNT_OP(xycz_add);
+
     uECC_vli_modSub(t5, X2, X1, curve->p, num_words); /* t5 = x2 - x1 */
     uECC_vli_modSquare_fast(t5, t5, curve);                  /* t5 = (x2 - x1)^2 = A */
     uECC_vli_modMult_fast(X1, X1, t5, curve);                /* t1 = x1*A = B */
@@ -832,6 +943,8 @@ static void XYcZ_addC(uECC_word_t * X1,
     uECC_word_t t7[uECC_MAX_WORDS];
     wordcount_t num_words = curve->num_words;
 
+    uECC_COUNT_OP(xycz_addc);
+
     uECC_vli_modSub(t5, X2, X1, curve->p, num_words); /* t5 = x2 - x1 */
     uECC_vli_modSquare_fast(t5, t5, curve);                  /* t5 = (x2 - x1)^2 = A */
     uECC_vli_modMult_fast(X1, X1, t5, curve);                /* t1 = x1*A = B */
@@ -858,6 +971,60 @@ static void XYcZ_addC(uECC_word_t * X1,
     uECC_vli_set(X1, t7, num_words);
 }
 
+/* (X1, Y1, Z1) += (x2, y2), where (x2, y2) is affine. Covers the point at infinity (Z1 = 0) and
+   both points being equal or opposite, which the fixed-base comb only reaches for a negligible
+   set of scalars. */
+static void EccPoint_add_affine(uECC_word_t * X1,
+                                uECC_word_t * Y1,
+                                uECC_word_t * Z1,
+                                const uECC_word_t * x2,
+                                const uECC_word_t * y2,
+                                uECC_Curve curve) {
+    /* t1 = X1, t2 = Y1, t3 = Z1 */
+    uECC_word_t t4[uECC_MAX_WORDS];
+    uECC_word_t t5[uECC_MAX_WORDS];
+    uECC_word_t t6[uECC_MAX_WORDS];
+    wordcount_t num_words = curve->num_words;
+
+    if (uECC_vli_isZero(Z1, num_words)) {
+        uECC_vli_set(X1, x2, num_words);
+        uECC_vli_set(Y1, y2, num_words);
+        uECC_vli_clear(Z1, num_words);
+        Z1[0] = 1;
+        return;
+    }
+    uECC_COUNT_OP(affine_add);
+
+    uECC_vli_modSquare_fast(t4, Z1, curve);           /* t4 = z1^2 */
+    uECC_vli_modMult_fast(t5, x2, t4, curve);         /* t5 = x2*z1^2 = U2 */
+    uECC_vli_modMult_fast(t4, t4, Z1, curve);         /* t4 = z1^3 */
+    uECC_vli_modMult_fast(t4, t4, y2, curve);         /* t4 = y2*z1^3 = S2 */
+    uECC_vli_modSub(t5, t5, X1, curve->p, num_words); /* t5 = U2 - x1 = H */
+    uECC_vli_modSub(t4, t4, Y1, curve->p, num_words); /* t4 = S2 - y1 = r */
+
+    if (uECC_vli_isZero(t5, num_words)) {
+        if (uECC_vli_isZero(t4, num_words)) {
+            EccPoint_double_jacobian(X1, Y1, Z1, curve); /* same point */
+        } else {
+            uECC_vli_clear(Z1, num_words); /* opposite points */
+        }
+        return;
+    }
+
+    uECC_vli_modMult_fast(Z1, Z1, t5, curve);         /* t3 = z1*H = z3 */
+    uECC_vli_modSquare_fast(t6, t5, curve);           /* t6 = H^2 */
+    uECC_vli_modMult_fast(t5, t5, t6, curve);         /* t5 = H^3 */
+    uECC_vli_modMult_fast(t6, X1, t6, curve);         /* t6 = x1*H^2 = V */
+    uECC_vli_modSquare_fast(X1, t4, curve);           /* t1 = r^2 */
+    uECC_vli_modSub(X1, X1, t5, curve->p, num_words); /* t1 = r^2 - H^3 */
+    uECC_vli_modSub(X1, X1, t6, curve->p, num_words); /* t1 = r^2 - H^3 - V */
+    uECC_vli_modSub(X1, X1, t6, curve->p, num_words); /* t1 = r^2 - H^3 - 2V = x3 */
+    uECC_vli_modSub(t6, t6, X1, curve->p, num_words); /* t6 = V - x3 */
+    uECC_vli_modMult_fast(t6, t6, t4, curve);         /* t6 = r*(V - x3) */
+    uECC_vli_modMult_fast(t5, t5, Y1, curve);         /* t5 = y1*H^3 */
+    uECC_vli_modSub(Y1, t6, t5, curve->p, num_words); /* t2 = r*(V - x3) - y1*H^3 = y3 */
+}
+
 /* result may overlap point. */
 static void EccPoint_mult(uECC_word_t * result,
                           const uECC_word_t * point,
@@ -917,6 +1084,147 @@ static uECC_word_t regularize_k(const uECC_word_t * const k,
     return carry;
 }
 
+#if uECC_SECP256R1_COMB_TEETH || uECC_SECP256R1_WNAF_G_WINDOW
+
+#include "secp256r1-tables.inc"
+
+#if (uECC_SECP256R1_COMB_GENERATED_TEETH != uECC_SECP256R1_COMB_TEETH) || \
+        (uECC_SECP256R1_COMB_TEETH && \
+         uECC_SECP256R1_COMB_GENERATED_TABLES != uECC_SECP256R1_COMB_TABLES)
+    #error "secp256r1-tables.inc was generated for a different uECC_SECP256R1_COMB_TEETH or _TABLES"
+#endif
+#if uECC_SECP256R1_WNAF_GENERATED_G_WINDOW != uECC_SECP256R1_WNAF_G_WINDOW
+    #error "secp256r1-tables.inc was generated for a different uECC_SECP256R1_WNAF_G_WINDOW"
+#endif
+
+#endif /* uECC_SECP256R1_COMB_TEETH || uECC_SECP256R1_WNAF_G_WINDOW */
+
+#if uECC_SECP256R1_COMB_TEETH
+
+#define COMB_ENTRIES ((1 << uECC_SECP256R1_COMB_TEETH) - 1)
+
+/* Returns all ones if value is 0, 0 otherwise, without a branch. */
+static uECC_word_t vli_zero_mask(uECC_word_t value) {
+    value |= (uECC_word_t)(0 - value);
+    return (uECC_word_t)((value >> (uECC_WORD_BITS - 1)) - 1);
+}
+
+/* Bit 'bit' of the regularized scalar 2^256 + scalar (see regularize_k()); the bits below 0 are 0. */
+static uECC_word_t comb_scalar_bit(const uECC_word_t *scalar, bitcount_t bit) {
+    if (bit < 0) {
+        return 0;
+    }
+    if (bit >= 256) {
+        return 1;
+    }
+    return !!uECC_vli_testBit(scalar, bit);
+}
+
+/* Sets (x, y) to entry index - 1 of 'table', or to zero for index 0. Every entry is read, so the
+   memory accesses do not depend on index. */
+static void comb_select(uECC_word_t *x,
+                        uECC_word_t *y,
+                        const uECC_word_t (*table)[num_words_secp256r1 * 2],
+                        uECC_word_t index) {
+    bitcount_t entry;
+    wordcount_t i;
+    uECC_word_t mask;
+
+    uECC_vli_clear(x, num_words_secp256r1);
+    uECC_vli_clear(y, num_words_secp256r1);
+    for (entry = 0; entry < COMB_ENTRIES; ++entry) {
+        mask = vli_zero_mask((uECC_word_t)(entry + 1) ^ index);
+        for (i = 0; i < num_words_secp256r1; ++i) {
+            x[i] |= table[entry][i] & mask;
+            y[i] |= table[entry][num_words_secp256r1 + i] & mask;
+        }
+    }
+}
+
+/* Fixed-base comb (Lim-Lee) for the secp256r1 generator, tables from scripts/secp256r1_tables.py.
+   Column c of table t reads the scalar bits (t * TEETH + i) * SPACING + c - SHIFT, i < TEETH,
+   as an index into the table. The top column of the last table holds bit 256, which is always
+   set, so the sum starts from a table entry rather than from infinity. Entries for index 0 are
+   added too and the sum is kept with a mask, so every scalar runs the same operations. */
+static void EccPoint_mult_comb(uECC_word_t * result,
+                               const uECC_word_t * scalar,
+                               const uECC_word_t * initial_Z,
+                               uECC_Curve curve) {
+    uECC_word_t Rx[num_words_secp256r1];
+    uECC_word_t Ry[num_words_secp256r1];
+    uECC_word_t Rz[num_words_secp256r1];
+    uECC_word_t Sx[num_words_secp256r1];
+    uECC_word_t Sy[num_words_secp256r1];
+    uECC_word_t Sz[num_words_secp256r1];
+    uECC_word_t x[num_words_secp256r1];
+    uECC_word_t y[num_words_secp256r1];
+    uECC_word_t index, keep;
+    bitcount_t column;
+    wordcount_t i;
+    int table, tooth;
+
+    for (column = uECC_SECP256R1_COMB_SPACING - 1; column >= 0; --column) {
+        if (column != uECC_SECP256R1_COMB_SPACING - 1) {
+            EccPoint_double_jacobian(Rx, Ry, Rz, curve);
+        }
+        for (table = uECC_SECP256R1_COMB_TABLES - 1; table >= 0; --table) {
+            index = 0;
+            for (tooth = 0; tooth < uECC_SECP256R1_COMB_TEETH; ++tooth) {
+                bitcount_t bit = (bitcount_t)((table * uECC_SECP256R1_COMB_TEETH + tooth) *
+                    uECC_SECP256R1_COMB_SPACING + column - uECC_SECP256R1_COMB_SHIFT);
+                index |= comb_scalar_bit(scalar, bit) << tooth;
+            }
+            comb_select(x, y, secp256r1_comb[table], index);
+
+            if (column == uECC_SECP256R1_COMB_SPACING - 1 &&
+                    table == uECC_SECP256R1_COMB_TABLES - 1) {
+                uECC_vli_set(Rx, x, num_words_secp256r1);
+                uECC_vli_set(Ry, y, num_words_secp256r1);
+                uECC_vli_clear(Rz, num_words_secp256r1);
+                Rz[0] = 1;
+                if (initial_Z) {
+                    uECC_vli_set(Rz, initial_Z, num_words_secp256r1);
+                    apply_z(Rx, Ry, Rz, curve);
+                }
+                continue;
+            }
+
+            uECC_vli_set(Sx, Rx, num_words_secp256r1);
+            uECC_vli_set(Sy, Ry, num_words_secp256r1);
+            uECC_vli_set(Sz, Rz, num_words_secp256r1);
+            EccPoint_add_affine(Sx, Sy, Sz, x, y, curve);
+            keep = vli_zero_mask(index);
+            for (i = 0; i < num_words_secp256r1; ++i) {
+                Rx[i] = (Rx[i] & keep) | (Sx[i] & ~keep);
+                Ry[i] = (Ry[i] & keep) | (Sy[i] & ~keep);
+                Rz[i] = (Rz[i] & keep) | (Sz[i] & ~keep);
+            }
+        }
+    }
+
+    /* The point at infinity has Z = 0 and comes out as (0, 0). */
+    uECC_vli_modInv(Rz, Rz, curve->p, num_words_secp256r1);
+    apply_z(Rx, Ry, Rz, curve);
+    uECC_vli_set(result, Rx, num_words_secp256r1);
+    uECC_vli_set(result + num_words_secp256r1, Ry, num_words_secp256r1);
+}
+
+#endif /* uECC_SECP256R1_COMB_TEETH */
+
+/* result = k' * G, where 'scalar' holds the low bits of a scalar regularized by regularize_k(). */
+static void EccPoint_mult_base(uECC_word_t * result,
+                               const uECC_word_t * scalar,
+                               const uECC_word_t * initial_Z,
+                               uECC_Curve curve) {
+#if uECC_SECP256R1_COMB_TEETH
+    if (curve == &curve_secp256r1) {
+        EccPoint_mult_comb(result, scalar, initial_Z, curve);
+        return;
+    }
+#endif
+    EccPoint_mult(result, curve->G, scalar, initial_Z, curve->num_n_bits + 1, curve);
+}
+
 /* Generates a random integer in the range 0 < random < top.
    Both random and top have num_words words. */
 uECC_VLI_API int uECC_generate_random_int(uECC_word_t *random,
@@ -964,7 +1272,7 @@ static uECC_word_t EccPoint_compute_public_key(uECC_word_t *result,
         }
         initial_Z = p2[carry];
     }
-    EccPoint_mult(result, curve->G, p2[!carry], initial_Z, curve->num_n_bits + 1, curve);
+    EccPoint_mult_base(result, p2[!carry], initial_Z, curve);
 
     if (EccPoint_isZero(result, curve)) {
         return 0;
@@ -1262,7 +1570,6 @@ static int uECC_sign_with_k_internal(const uint8_t *private_key,
     uECC_word_t carry;
     wordcount_t num_words = curve->num_words;
     wordcount_t num_n_words = BITS_TO_WORDS(curve->num_n_bits);
-    bitcount_t num_n_bits = curve->num_n_bits;
 
     /* Make sure 0 < k < curve_n */
     if (uECC_vli_isZero(k, num_words) || uECC_vli_cmp(curve->n, k, num_n_words) != 1) {
@@ -1278,7 +1585,7 @@ static int uECC_sign_with_k_internal(const uint8_t *private_key,
         }
         initial_Z = k2[carry];
     }
-    EccPoint_mult(p, curve->G, k2[!carry], initial_Z, num_n_bits + 1, curve);
+    EccPoint_mult_base(p, k2[!carry], initial_Z, curve);
     if (uECC_vli_isZero(p, num_words)) {
         return 0;
     }
@@ -1486,33 +1793,237 @@ static bitcount_t smax(bitcount_t a, bitcount_t b) {
     return (a > b ? a : b);
 }
 
-int uECC_verify(const uint8_t *public_key,
-                const uint8_t *message_hash,
-                unsigned hash_size,
-                const uint8_t *signature,
-                uECC_Curve curve) {
-    uECC_word_t u1[uECC_MAX_WORDS], u2[uECC_MAX_WORDS];
+/* ------ Verification: u1 * G + u2 * Q ------ */
+
+#define WNAF_MAX_DIGITS (uECC_MAX_WORDS * uECC_WORD_BITS + 1)
+#define VERIFY_WINDOW_POINTS (1 << (uECC_VERIFY_WNAF_WINDOW - 2))
+#define VERIFY_PRECOMP_POINTS (1 << (uECC_VERIFY_PRECOMP_WINDOW - 2))
+#define VERIFY_MAX_POINTS \
+    (VERIFY_PRECOMP_POINTS > VERIFY_WINDOW_POINTS ? VERIFY_PRECOMP_POINTS : VERIFY_WINDOW_POINTS)
+
+/* Whether G's window is built on every call, for the curves without a table in flash */
+#if uECC_SECP256R1_WNAF_G_WINDOW && !uECC_SUPPORTS_secp160r1 && !uECC_SUPPORTS_secp192r1 && \
+        !uECC_SUPPORTS_secp224r1 && !uECC_SUPPORTS_secp256k1
+    #define VERIFY_BUILDS_G_WINDOW 0
+#else
+    #define VERIFY_BUILDS_G_WINDOW 1
+#endif
+/* Room for G's window where it is built, a single unused point where it never is */
+#define VERIFY_G_BUILT_POINTS (VERIFY_BUILDS_G_WINDOW ? VERIFY_WINDOW_POINTS : 1)
+
+/* Writes the width-w NAF of 'scalar' to naf[0..length), least significant digit first, and
+   returns its length. Each digit is 0 or odd with |digit| < 2^(w - 1), and any w consecutive
+   digits hold at most one nonzero digit. Variable time. */
+static bitcount_t vli_wnaf(int8_t *naf,
+                           const uECC_word_t *scalar,
+                           wordcount_t num_words,
+                           unsigned width) {
+    uECC_word_t k[uECC_MAX_WORDS + 1];
+    uECC_word_t digit[uECC_MAX_WORDS + 1];
+    uECC_word_t mask = ((uECC_word_t)1 << width) - 1;
+    bitcount_t length = 0;
+    int value;
+
+    uECC_vli_set(k, scalar, num_words);
+    k[num_words] = 0;
+    uECC_vli_clear(digit, num_words + 1);
+    while (!uECC_vli_isZero(k, num_words + 1)) {
+        value = 0;
+        if (k[0] & 1) {
+            value = (int)(k[0] & mask);
+            if (value >= (1 << (width - 1))) {
+                value -= (1 << width);
+            }
+            /* k -= value */
+            if (value > 0) {
+                digit[0] = (uECC_word_t)value;
+                uECC_vli_sub(k, k, digit, num_words + 1);
+            } else {
+                digit[0] = (uECC_word_t)-value;
+                uECC_vli_add(k, k, digit, num_words + 1);
+            }
+        }
+        naf[length++] = (int8_t)value;
+        uECC_vli_rshift1(k, num_words + 1);
+    }
+    return length;
+}
+
+/* Sets table[0..count) to the affine points P, 3P, 5P, ..., (2 * count - 1)P. 2P is added with
+   co-Z additions, each of which leaves the new multiple with Z = previous Z * (x - x(2P)), so the
+   factors give every 1/Z from the last one: a single inversion for the whole window. */
+static void EccPoint_odd_multiples(uECC_word_t (*table)[uECC_MAX_WORDS * 2],
+                                   const uECC_word_t * point,
+                                   unsigned count,
+                                   uECC_Curve curve) {
+    uECC_word_t factor[VERIFY_MAX_POINTS][uECC_MAX_WORDS];
+    uECC_word_t dx[uECC_MAX_WORDS];
+    uECC_word_t dy[uECC_MAX_WORDS];
+    uECC_word_t x[uECC_MAX_WORDS];
+    uECC_word_t y[uECC_MAX_WORDS];
     uECC_word_t z[uECC_MAX_WORDS];
-    uECC_word_t sum[uECC_MAX_WORDS * 2];
-    uECC_word_t rx[uECC_MAX_WORDS];
-    uECC_word_t ry[uECC_MAX_WORDS];
-    uECC_word_t tx[uECC_MAX_WORDS];
-    uECC_word_t ty[uECC_MAX_WORDS];
-    uECC_word_t tz[uECC_MAX_WORDS];
-    const uECC_word_t *points[4];
-    const uECC_word_t *point;
-    bitcount_t num_bits;
-    bitcount_t i;
-#if uECC_VLI_NATIVE_LITTLE_ENDIAN
-    uECC_word_t *_public = (uECC_word_t *)public_key;
+    wordcount_t num_words = curve->num_words;
+    unsigned i;
+
+    uECC_vli_set(table[0], point, num_words);
+    uECC_vli_set(table[0] + num_words, point + num_words, num_words);
+    if (count == 1) {
+        return;
+    }
+
+    /* (dx, dy) = 2P and (x, y) = P, both with Z = z */
+    uECC_vli_set(dx, point, num_words);
+    uECC_vli_set(dy, point + num_words, num_words);
+    uECC_vli_set(x, dx, num_words);
+    uECC_vli_set(y, dy, num_words);
+    uECC_vli_clear(z, num_words);
+    z[0] = 1;
+    EccPoint_double_jacobian(dx, dy, z, curve);
+    apply_z(x, y, z, curve);
+
+    for (i = 1; i < count; ++i) {
+        uECC_vli_set(table[i - 1], x, num_words);
+        uECC_vli_set(table[i - 1] + num_words, y, num_words);
+        uECC_vli_modSub(factor[i], x, dx, curve->p, num_words); /* x - x(2P) */
+        uECC_vli_modMult_fast(z, z, factor[i], curve);
+        XYcZ_add(dx, dy, x, y, curve);
+    }
+    uECC_vli_set(table[count - 1], x, num_words);
+    uECC_vli_set(table[count - 1] + num_words, y, num_words);
+
+    uECC_vli_modInv(z, z, curve->p, num_words);
+    for (i = count - 1; ; --i) {
+        apply_z(table[i], table[i] + num_words, z, curve);
+        if (i == 0) {
+            break;
+        }
+        uECC_vli_modMult_fast(z, z, factor[i], curve); /* 1/Z of multiple i - 1 */
+    }
+}
+
+/* (X1, Y1, Z1) += digit * P, where window[j] = (2j + 1)P and digit is odd. */
+static void EccPoint_add_digit(uECC_word_t * X1,
+                               uECC_word_t * Y1,
+                               uECC_word_t * Z1,
+                               const uECC_word_t (*window)[uECC_MAX_WORDS * 2],
+                               int digit,
+                               uECC_Curve curve) {
+    uECC_word_t y[uECC_MAX_WORDS];
+    const uECC_word_t *point = window[(digit < 0 ? -digit : digit) >> 1];
+    wordcount_t num_words = curve->num_words;
+
+    if (digit > 0) {
+        EccPoint_add_affine(X1, Y1, Z1, point, point + num_words, curve);
+    } else {
+        uECC_vli_sub(y, curve->p, point + num_words, num_words); /* -P = (x, p - y) */
+        EccPoint_add_affine(X1, Y1, Z1, point, y, curve);
+    }
+}
+
+/* Sets *window to the odd multiples of G: the table in flash for secp256r1 with
+   uECC_SECP256R1_WNAF_G_WINDOW, or else 'built', filled here. Returns the window's width. */
+static unsigned verify_g_window(const uECC_word_t (**window)[uECC_MAX_WORDS * 2],
+                                uECC_word_t (*built)[uECC_MAX_WORDS * 2],
+                                uECC_Curve curve) {
+#if uECC_SECP256R1_WNAF_G_WINDOW
+    if (curve == &curve_secp256r1) {
+        *window = secp256r1_g_odd;
+        return uECC_SECP256R1_WNAF_G_WINDOW;
+    }
+#endif
+#if VERIFY_BUILDS_G_WINDOW
+    EccPoint_odd_multiples(built, curve->G, VERIFY_WINDOW_POINTS, curve);
+    *window = (const uECC_word_t (*)[uECC_MAX_WORDS * 2])built;
 #else
-    uECC_word_t _public[uECC_MAX_WORDS * 2];
+    (void)built;
 #endif
-    uECC_word_t r[uECC_MAX_WORDS], s[uECC_MAX_WORDS];
+    return uECC_VERIFY_WNAF_WINDOW;
+}
+
+/* Sets (X, Y, Z) to u1 * G + u2 * Q in Jacobian coordinates, Z = 0 for the point at infinity,
+   with interleaved wNAF: one doubling per bit and one mixed addition per nonzero digit of either
+   scalar. The windows hold the odd multiples of G and Q for g_width and q_width-wide wNAFs. All
+   inputs are public, so this is not constant time. */
+static void EccPoint_wnaf_sum(uECC_word_t * X,
+                              uECC_word_t * Y,
+                              uECC_word_t * Z,
+                              const uECC_word_t * u1,
+                              const uECC_word_t (*g_window)[uECC_MAX_WORDS * 2],
+                              unsigned g_width,
+                              const uECC_word_t * u2,
+                              const uECC_word_t (*q_window)[uECC_MAX_WORDS * 2],
+                              unsigned q_width,
+                              uECC_Curve curve) {
+    int8_t naf1[WNAF_MAX_DIGITS];
+    int8_t naf2[WNAF_MAX_DIGITS];
+    wordcount_t num_words = curve->num_words;
+    wordcount_t num_n_words = BITS_TO_WORDS(curve->num_n_bits);
+    bitcount_t length1, length2, i;
+
+    length1 = vli_wnaf(naf1, u1, num_n_words, g_width);
+    length2 = vli_wnaf(naf2, u2, num_n_words, q_width);
+
+    /* Start from the point at infinity (Z = 0); doubling it costs nothing. */
+    uECC_vli_clear(X, num_words);
+    uECC_vli_clear(Y, num_words);
+    uECC_vli_clear(Z, num_words);
+    for (i = smax(length1, length2) - 1; i >= 0; --i) {
+        EccPoint_double_jacobian(X, Y, Z, curve);
+        if (i < length1 && naf1[i]) {
+            EccPoint_add_digit(X, Y, Z, g_window, naf1[i], curve);
+        }
+        if (i < length2 && naf2[i]) {
+            EccPoint_add_digit(X, Y, Z, q_window, naf2[i], curve);
+        }
+    }
+}
+
+/* Sets rx to the affine x coordinate of u1 * G + u2 * Q, or to 0 if that is the point at
+   infinity. q_window holds the odd multiples of Q for a q_width-wide wNAF. */
+static void EccPoint_verify_mult_window(uECC_word_t * rx,
+                                        const uECC_word_t * u1,
+                                        const uECC_word_t * u2,
+                                        const uECC_word_t (*q_window)[uECC_MAX_WORDS * 2],
+                                        unsigned q_width,
+                                        uECC_Curve curve) {
+    uECC_word_t ry[uECC_MAX_WORDS];
+    uECC_word_t z[uECC_MAX_WORDS];
+    uECC_word_t g_built[VERIFY_G_BUILT_POINTS][uECC_MAX_WORDS * 2];
+    const uECC_word_t (*g_window)[uECC_MAX_WORDS * 2];
+    unsigned g_width = verify_g_window(&g_window, g_built, curve);
+
+    EccPoint_wnaf_sum(rx, ry, z, u1, g_window, g_width, u2, q_window, q_width, curve);
+    uECC_vli_modInv(z, z, curve->p, curve->num_words); /* Z = 1/Z, 0 stays 0 */
+    apply_z(rx, ry, z, curve);
+}
+
+/* EccPoint_verify_mult_window() with Q's window (uECC_VERIFY_WNAF_WINDOW) built on the stack */
+static void EccPoint_verify_mult(uECC_word_t * rx,
+                                 const uECC_word_t * u1,
+                                 const uECC_word_t * u2,
+                                 const uECC_word_t * Q,
+                                 uECC_Curve curve) {
+    uECC_word_t q_window[VERIFY_WINDOW_POINTS][uECC_MAX_WORDS * 2];
+
+    EccPoint_odd_multiples(q_window, Q, VERIFY_WINDOW_POINTS, curve);
+    EccPoint_verify_mult_window(rx, u1, u2, (const uECC_word_t (*)[uECC_MAX_WORDS * 2])q_window,
+                                uECC_VERIFY_WNAF_WINDOW, curve);
+}
+
+/* Reads r and s from 'signature', checks that both are in [1, n - 1] and sets u1 = e / s and
+   u2 = r / s. Returns 0 if the signature is malformed. */
+static int verify_scalars(uECC_word_t *u1,
+                          uECC_word_t *u2,
+                          uECC_word_t *r,
+                          const uint8_t *message_hash,
+                          unsigned hash_size,
+                          const uint8_t *signature,
+                          uECC_Curve curve) {
+    uECC_word_t z[uECC_MAX_WORDS];
+    uECC_word_t s[uECC_MAX_WORDS];
     wordcount_t num_words = curve->num_words;
     wordcount_t num_n_words = BITS_TO_WORDS(curve->num_n_bits);
 
-    rx[num_n_words - 1] = 0;
     r[num_n_words - 1] = 0;
     s[num_n_words - 1] = 0;
 
@@ -1520,9 +2031,6 @@ int uECC_verify(const uint8_t *public_key,
     bcopy((uint8_t *) r, signature, curve->num_bytes);
     bcopy((uint8_t *) s, signature + curve->num_bytes, curve->num_bytes);
 #else
-    uECC_vli_bytesToNative(_public, public_key, curve->num_bytes);
-    uECC_vli_bytesToNative(
-        _public + num_words, public_key + curve->num_bytes, curve->num_bytes);
     uECC_vli_bytesToNative(r, signature, curve->num_bytes);
     uECC_vli_bytesToNative(s, signature + curve->num_bytes, curve->num_bytes);
 #endif
@@ -1544,50 +2052,12 @@ int uECC_verify(const uint8_t *public_key,
     bits2int(u1, message_hash, hash_size, curve);
     uECC_vli_modMult(u1, u1, z, curve->n, num_n_words); /* u1 = e/s */
     uECC_vli_modMult(u2, r, z, curve->n, num_n_words); /* u2 = r/s */
+    return 1;
+}
 
-    /* Calculate sum = G + Q. */
-    uECC_vli_set(sum, _public, num_words);
-    uECC_vli_set(sum + num_words, _public + num_words, num_words);
-    uECC_vli_set(tx, curve->G, num_words);
-    uECC_vli_set(ty, curve->G + num_words, num_words);
-    uECC_vli_modSub(z, sum, tx, curve->p, num_words); /* z = x2 - x1 */
-    XYcZ_add(tx, ty, sum, sum + num_words, curve);
-    uECC_vli_modInv(z, z, curve->p, num_words); /* z = 1/z */
-    apply_z(sum, sum + num_words, z, curve);
-
-    /* Use Shamir's trick to calculate u1*G + u2*Q */
-    points[0] = 0;
-    points[1] = curve->G;
-    points[2] = _public;
-    points[3] = sum;
-    num_bits = smax(uECC_vli_numBits(u1, num_n_words),
-                    uECC_vli_numBits(u2, num_n_words));
-
-    point = points[(!!uECC_vli_testBit(u1, num_bits - 1)) |
-                   ((!!uECC_vli_testBit(u2, num_bits - 1)) << 1)];
-    uECC_vli_set(rx, point, num_words);
-    uECC_vli_set(ry, point + num_words, num_words);
-    uECC_vli_clear(z, num_words);
-    z[0] = 1;
-
-    for (i = num_bits - 2; i >= 0; --i) {
-        uECC_word_t index;
-        curve->double_jacobian(rx, ry, z, curve);
-
-        index = (!!uECC_vli_testBit(u1, i)) | ((!!uECC_vli_testBit(u2, i)) << 1);
-        point = points[index];
-        if (point) {
-            uECC_vli_set(tx, point, num_words);
-            uECC_vli_set(ty, point + num_words, num_words);
-            apply_z(tx, ty, z, curve);
-            uECC_vli_modSub(tz, rx, tx, curve->p, num_words); /* Z = x2 - x1 */
-            XYcZ_add(tx, ty, rx, ry, curve);
-            uECC_vli_modMult_fast(z, z, tz, curve);
-        }
-    }
-
-    uECC_vli_modInv(z, z, curve->p, num_words); /* Z = 1/Z */
-    apply_z(rx, ry, z, curve);
+/* Accepts if the x coordinate rx, reduced mod n, equals r. */
+static int verify_matches(uECC_word_t *rx, const uECC_word_t *r, uECC_Curve curve) {
+    wordcount_t num_n_words = BITS_TO_WORDS(curve->num_n_bits);
 
     /* v = x1 (mod n) */
     if (uECC_vli_cmp_unsafe(curve->n, rx, num_n_words) != 1) {
@@ -1595,7 +2065,285 @@ int uECC_verify(const uint8_t *public_key,
     }
 
     /* Accept only if v == r. */
-    return (int)(uECC_vli_equal(rx, r, num_words));
+    return (int)(uECC_vli_equal(rx, r, curve->num_words));
+}
+
+int uECC_verify(const uint8_t *public_key,
+                const uint8_t *message_hash,
+                unsigned hash_size,
+                const uint8_t *signature,
+                uECC_Curve curve) {
+    uECC_word_t u1[uECC_MAX_WORDS], u2[uECC_MAX_WORDS];
+    uECC_word_t rx[uECC_MAX_WORDS];
+#if uECC_VLI_NATIVE_LITTLE_ENDIAN
+    uECC_word_t *_public = (uECC_word_t *)public_key;
+#else
+    uECC_word_t _public[uECC_MAX_WORDS * 2];
+#endif
+    uECC_word_t r[uECC_MAX_WORDS];
+
+    if (!verify_scalars(u1, u2, r, message_hash, hash_size, signature, curve)) {
+        return 0;
+    }
+
+#if !uECC_VLI_NATIVE_LITTLE_ENDIAN
+    uECC_vli_bytesToNative(_public, public_key, curve->num_bytes);
+    uECC_vli_bytesToNative(
+        _public + curve->num_words, public_key + curve->num_bytes, curve->num_bytes);
+#endif
+
+    /* rx = x of u1 * G + u2 * Q */
+    rx[BITS_TO_WORDS(curve->num_n_bits) - 1] = 0;
+    EccPoint_verify_mult(rx, u1, u2, _public, curve);
+    return verify_matches(rx, r, curve);
+}
+
+int uECC_verify_precomp_size(void) {
+    return VERIFY_PRECOMP_POINTS * uECC_MAX_WORDS * 2 * uECC_WORD_SIZE;
+}
+
+int uECC_verify_precompute(const uint8_t *public_key, uint8_t *precomp, uECC_Curve curve) {
+#if uECC_VLI_NATIVE_LITTLE_ENDIAN
+    uECC_word_t *_public = (uECC_word_t *)public_key;
+#else
+    uECC_word_t _public[uECC_MAX_WORDS * 2];
+#endif
+
+#if !uECC_VLI_NATIVE_LITTLE_ENDIAN
+    uECC_vli_bytesToNative(_public, public_key, curve->num_bytes);
+    uECC_vli_bytesToNative(
+        _public + curve->num_words, public_key + curve->num_bytes, curve->num_bytes);
+#endif
+
+    if (!uECC_valid_point(_public, curve)) {
+        return 0;
+    }
+    EccPoint_odd_multiples((uECC_word_t (*)[uECC_MAX_WORDS * 2])precomp, _public,
+                           VERIFY_PRECOMP_POINTS, curve);
+    return 1;
+}
+
+int uECC_verify_precomputed(const uint8_t *precomp,
+                            const uint8_t *message_hash,
+                            unsigned hash_size,
+                            const uint8_t *signature,
+                            uECC_Curve curve) {
+    uECC_word_t u1[uECC_MAX_WORDS], u2[uECC_MAX_WORDS];
+    uECC_word_t rx[uECC_MAX_WORDS];
+    uECC_word_t r[uECC_MAX_WORDS];
+
+    if (!verify_scalars(u1, u2, r, message_hash, hash_size, signature, curve)) {
+        return 0;
+    }
+
+    /* rx = x of u1 * G + u2 * Q, with Q's window from uECC_verify_precompute() */
+    rx[BITS_TO_WORDS(curve->num_n_bits) - 1] = 0;
+    EccPoint_verify_mult_window(rx, u1, u2, (const uECC_word_t (*)[uECC_MAX_WORDS * 2])precomp,
+                                uECC_VERIFY_PRECOMP_WINDOW, curve);
+    return verify_matches(rx, r, curve);
+}
+
+/* ------ Batch verification ------ */
+
+/* Per-signature state of a batch, one row per signature. */
+typedef uECC_word_t batch_vli_t[uECC_VERIFY_BATCH_SIZE][uECC_MAX_WORDS];
+
+static void batch_modMult(uECC_word_t *result,
+                          const uECC_word_t *left,
+                          const uECC_word_t *right,
+                          const uECC_word_t *mod,
+                          uECC_Curve curve) {
+    if (mod == curve->p) {
+        uECC_vli_modMult_fast(result, left, right, curve);
+    } else {
+        uECC_vli_modMult(result, left, right, mod, BITS_TO_WORDS(curve->num_n_bits));
+    }
+}
+
+/* Replaces values[0..count) by their inverses mod 'mod' (curve->p or curve->n) using
+   Montgomery's trick: one uECC_vli_modInv() and 3 * (count - 1) multiplications.
+   All values must be non-zero. */
+static void batch_modInv(batch_vli_t values,
+                         batch_vli_t prefix,
+                         unsigned count,
+                         const uECC_word_t *mod,
+                         wordcount_t num_words,
+                         uECC_Curve curve) {
+    uECC_word_t inv[uECC_MAX_WORDS];
+    uECC_word_t tmp[uECC_MAX_WORDS];
+    unsigned i;
+
+    uECC_vli_set(prefix[0], values[0], num_words);
+    for (i = 1; i < count; ++i) {
+        batch_modMult(prefix[i], prefix[i - 1], values[i], mod, curve);
+    }
+
+    uECC_vli_modInv(inv, prefix[count - 1], mod, num_words); /* inv = 1 / (v0 * ... * vn) */
+
+    for (i = count - 1; i > 0; --i) {
+        batch_modMult(tmp, inv, prefix[i - 1], mod, curve);  /* tmp = 1 / vi */
+        batch_modMult(inv, inv, values[i], mod, curve);      /* inv = 1 / (v0 * ... * vi-1) */
+        uECC_vli_set(values[i], tmp, num_words);
+    }
+    uECC_vli_set(values[0], inv, num_words);
+}
+
+static void batch_load(uECC_word_t *native, const uint8_t *bytes, uECC_Curve curve) {
+#if uECC_VLI_NATIVE_LITTLE_ENDIAN
+    bcopy((uint8_t *) native, bytes, curve->num_bytes);
+#else
+    uECC_vli_bytesToNative(native, bytes, curve->num_bytes);
+#endif
+}
+
+/* Reads a public key the same way uECC_verify() does. */
+static void batch_load_point(uECC_word_t *point, const uint8_t *bytes, uECC_Curve curve) {
+#if uECC_VLI_NATIVE_LITTLE_ENDIAN
+    bcopy((uint8_t *) point, bytes, curve->num_words * 2 * uECC_WORD_SIZE);
+#else
+    uECC_vli_bytesToNative(point, bytes, curve->num_bytes);
+    uECC_vli_bytesToNative(point + curve->num_words, bytes + curve->num_bytes, curve->num_bytes);
+#endif
+}
+
+#define BATCH_INVALID 0
+#define BATCH_PENDING 1
+
+/* Verifies up to uECC_VERIFY_BATCH_SIZE signatures with the interleaved wNAF of uECC_verify().
+   1/s and the 1/Z of each result are shared by the whole chunk, and G's window, where it is not
+   in flash, is built once per chunk; each Q's window still takes its own inversion. */
+static unsigned verify_batch_chunk(const uint8_t *public_keys,
+                                   const uint8_t *message_hashes,
+                                   unsigned hash_size,
+                                   const uint8_t *signatures,
+                                   unsigned count,
+                                   uECC_Curve curve,
+                                   uint8_t *results) {
+    batch_vli_t u1, u2, z, prefix;
+    uint8_t status[uECC_VERIFY_BATCH_SIZE];
+    uECC_word_t q_window[VERIFY_WINDOW_POINTS][uECC_MAX_WORDS * 2];
+    uECC_word_t g_built[VERIFY_G_BUILT_POINTS][uECC_MAX_WORDS * 2];
+    const uECC_word_t (*g_window)[uECC_MAX_WORDS * 2];
+    unsigned g_width;
+    uECC_word_t _public[uECC_MAX_WORDS * 2];
+    uECC_word_t r[uECC_MAX_WORDS], s[uECC_MAX_WORDS];
+    uECC_word_t rx[uECC_MAX_WORDS];
+    uECC_word_t ry[uECC_MAX_WORDS];
+    uECC_word_t tz[uECC_MAX_WORDS];
+    wordcount_t num_words = curve->num_words;
+    wordcount_t num_n_words = BITS_TO_WORDS(curve->num_n_bits);
+    unsigned num_bytes = curve->num_bytes;
+    unsigned valid = 0;
+    unsigned j;
+
+    /* Check r and s, then u1 = e/s and u2 = r/s with one shared 1/s. */
+    for (j = 0; j < count; ++j) {
+        const uint8_t *signature = signatures + j * 2 * num_bytes;
+        r[num_n_words - 1] = 0;
+        s[num_n_words - 1] = 0;
+        batch_load(r, signature, curve);
+        batch_load(s, signature + num_bytes, curve);
+
+        status[j] = BATCH_PENDING;
+        if (uECC_vli_isZero(r, num_words) || uECC_vli_isZero(s, num_words) ||
+                uECC_vli_cmp_unsafe(curve->n, r, num_n_words) != 1 ||
+                uECC_vli_cmp_unsafe(curve->n, s, num_n_words) != 1) {
+            status[j] = BATCH_INVALID;
+            uECC_vli_clear(s, num_n_words);
+            s[0] = 1;
+        }
+        uECC_vli_set(z[j], s, num_n_words);
+    }
+
+    batch_modInv(z, prefix, count, curve->n, num_n_words, curve); /* z = 1/s */
+
+    for (j = 0; j < count; ++j) {
+        if (status[j] != BATCH_PENDING) {
+            continue;
+        }
+        r[num_n_words - 1] = 0;
+        batch_load(r, signatures + j * 2 * num_bytes, curve);
+        u1[j][num_n_words - 1] = 0;
+        bits2int(u1[j], message_hashes + j * hash_size, hash_size, curve);
+        uECC_vli_modMult(u1[j], u1[j], z[j], curve->n, num_n_words); /* u1 = e/s */
+        uECC_vli_modMult(u2[j], r, z[j], curve->n, num_n_words); /* u2 = r/s */
+    }
+
+    /* u1 * G + u2 * Q, keeping X and Z of each result. */
+    g_width = verify_g_window(&g_window, g_built, curve);
+    for (j = 0; j < count; ++j) {
+        uECC_vli_clear(z[j], num_words);
+        z[j][0] = 1;
+        if (status[j] != BATCH_PENDING) {
+            continue;
+        }
+
+        batch_load_point(_public, public_keys + j * 2 * num_bytes, curve);
+        EccPoint_odd_multiples(q_window, _public, VERIFY_WINDOW_POINTS, curve);
+        EccPoint_wnaf_sum(rx, ry, z[j], u1[j], g_window, g_width, u2[j],
+                          (const uECC_word_t (*)[uECC_MAX_WORDS * 2])q_window,
+                          uECC_VERIFY_WNAF_WINDOW, curve);
+
+        /* The result is the point at infinity, which never matches r. */
+        if (uECC_vli_isZero(z[j], num_words)) {
+            status[j] = BATCH_INVALID;
+            z[j][0] = 1;
+            continue;
+        }
+        uECC_vli_set(u1[j], rx, num_words); /* u1 is no longer needed; keep X there */
+    }
+
+    batch_modInv(z, prefix, count, curve->p, num_words, curve); /* Z = 1/Z */
+
+    for (j = 0; j < count; ++j) {
+        uint8_t result = 0;
+        if (status[j] == BATCH_PENDING) {
+            rx[num_n_words - 1] = 0;
+            uECC_vli_modSquare_fast(tz, z[j], curve);
+            uECC_vli_modMult_fast(rx, u1[j], tz, curve); /* x = X / Z^2 */
+
+            /* v = x1 (mod n) */
+            if (uECC_vli_cmp_unsafe(curve->n, rx, num_n_words) != 1) {
+                uECC_vli_sub(rx, rx, curve->n, num_n_words);
+            }
+
+            r[num_n_words - 1] = 0;
+            batch_load(r, signatures + j * 2 * num_bytes, curve);
+            result = (uint8_t)uECC_vli_equal(rx, r, num_words);
+        }
+
+        if (results) {
+            results[j] = result;
+        }
+        valid += result;
+    }
+
+    return valid;
+}
+
+int uECC_verify_batch(const uint8_t *public_keys,
+                      const uint8_t *message_hashes,
+                      unsigned hash_size,
+                      const uint8_t *signatures,
+                      unsigned count,
+                      uECC_Curve curve,
+                      uint8_t *results) {
+    unsigned num_bytes = curve->num_bytes;
+    unsigned valid = 0;
+    unsigned done;
+
+    for (done = 0; done < count; done += uECC_VERIFY_BATCH_SIZE) {
+        unsigned chunk = count - done < uECC_VERIFY_BATCH_SIZE ? count - done : uECC_VERIFY_BATCH_SIZE;
+        valid += verify_batch_chunk(public_keys + done * 2 * num_bytes,
+                                    message_hashes + done * hash_size,
+                                    hash_size,
+                                    signatures + done * 2 * num_bytes,
+                                    chunk,
+                                    curve,
+                                    results ? results + done : 0);
+    }
+
+    return (int)(valid == count);
 }
 
 #if uECC_ENABLE_VLI_API
@@ -52,6 +52,21 @@ the same endianness. */
     #define uECC_VLI_NATIVE_LITTLE_ENDIAN 0
 #endif
 
+/* uECC_VERIFY_BATCH_SIZE - Number of signatures uECC_verify_batch() processes together. Each
+signature in a chunk takes 4 * 32 bytes of stack (for 256-bit curves), and each chunk saves
+2 * (uECC_VERIFY_BATCH_SIZE - 1) modular inversions compared to uECC_verify(). */
+#ifndef uECC_VERIFY_BATCH_SIZE
+    #define uECC_VERIFY_BATCH_SIZE 8
+#endif
+
+/* uECC_ENABLE_OP_COUNTERS - If enabled (defined as nonzero), count the modular multiplications,
+squarings and inversions, point doublings and additions that each operation performs (see
+uECC_get_op_counters()). These counts do not depend on the clock or the caches, so they show the
+algorithmic cost of a change directly. Each count costs one increment of a global variable. */
+#ifndef uECC_ENABLE_OP_COUNTERS
+    #define uECC_ENABLE_OP_COUNTERS 0
+#endif
+
 /* Curve support selection. Set to 0 to remove that curve. */
 #ifndef uECC_SUPPORTS_secp160r1
     #define uECC_SUPPORTS_secp160r1 1
@@ -69,6 +84,58 @@ the same endianness. */
     #define uECC_SUPPORTS_secp256k1 1
 #endif
 
+/* uECC_SECP256R1_UNROLLED - If enabled (defined as nonzero), modular multiplication and squaring
+use fully unrolled, fixed-width secp256r1 kernels (see field-secp256r1.inc) instead of the generic
+loops over curve->num_words and the call through curve->mmod_fast, and points are doubled without
+going through curve->double_jacobian. This requires secp256r1 to be the only supported curve, and
+by default it is enabled exactly then. It has no effect with 8-bit words, at optimization level 0,
+or where assembly multiplication is used (ARM). */
+#ifndef uECC_SECP256R1_UNROLLED
+    #define uECC_SECP256R1_UNROLLED (uECC_SUPPORTS_secp256r1 && !uECC_SUPPORTS_secp160r1 && \
+        !uECC_SUPPORTS_secp192r1 && !uECC_SUPPORTS_secp224r1 && !uECC_SUPPORTS_secp256k1)
+#endif
+
+/* uECC_SECP256R1_COMB_TEETH and uECC_SECP256R1_COMB_TABLES - If uECC_SECP256R1_COMB_TEETH is
+nonzero, uECC_make_key(), uECC_compute_public_key() and uECC_sign() multiply the secp256r1
+generator with precomputed comb tables instead of the Montgomery ladder. The tables are read from
+secp256r1-tables.inc, which must be on the include path and generated with
+scripts/secp256r1_tables.py --teeth uECC_SECP256R1_COMB_TEETH --tables uECC_SECP256R1_COMB_TABLES.
+With D = ceil(257 / (TEETH * TABLES)), a multiplication takes D - 1 point doublings and
+TABLES * D - 1 additions, and the tables take TABLES * (2^TEETH - 1) * 64 bytes of flash. Each
+lookup reads a whole table so that the memory accesses do not depend on the scalar; as that cost
+doubles with each tooth, past 5 or 6 teeth more tables save more time than more teeth. */
+#ifndef uECC_SECP256R1_COMB_TEETH
+    #define uECC_SECP256R1_COMB_TEETH 0
+#endif
+#ifndef uECC_SECP256R1_COMB_TABLES
+    #define uECC_SECP256R1_COMB_TABLES 1
+#endif
+
+/* uECC_VERIFY_WNAF_WINDOW - Width of the signed sliding windows (wNAF) uECC_verify() and
+uECC_verify_antifault() use to compute u1 * G + u2 * Q: a window of width W holds the odd
+multiples up to (2^(W - 1) - 1) * Q, built on every call with one inversion and kept on the stack
+(2^(W - 2) points), and one point is added for every W + 1 scalar bits on average. Values from 2
+to 6 are supported. Verification only handles public values, so this is not constant time. */
+#ifndef uECC_VERIFY_WNAF_WINDOW
+    #define uECC_VERIFY_WNAF_WINDOW 4
+#endif
+
+/* uECC_SECP256R1_WNAF_G_WINDOW - If nonzero, the window of G for secp256r1 verification is not
+built on every call but read from secp256r1-tables.inc (see uECC_SECP256R1_COMB_TEETH), generated
+with --g-window uECC_SECP256R1_WNAF_G_WINDOW. It can be wider than uECC_VERIFY_WNAF_WINDOW since it
+costs flash, 2^(W - 2) * 64 bytes, instead of time and stack. Values from 2 to 8 are supported. */
+#ifndef uECC_SECP256R1_WNAF_G_WINDOW
+    #define uECC_SECP256R1_WNAF_G_WINDOW 0
+#endif
+
+/* uECC_VERIFY_PRECOMP_WINDOW - Width of the window of Q that uECC_verify_precompute() stores for
+uECC_verify_precomputed(). Since it is built once per key rather than once per signature, it can
+be wider than uECC_VERIFY_WNAF_WINDOW; it takes 2^(W - 2) points of uECC_verify_precomp_size()
+bytes in all. Values from 2 to 8 are supported. */
+#ifndef uECC_VERIFY_PRECOMP_WINDOW
+    #define uECC_VERIFY_PRECOMP_WINDOW 5
+#endif
+
 /* Specifies whether compressed point format is supported.
    Set to 0 to disable point compression/decompression functions. */
 #ifndef uECC_SUPPORT_COMPRESSED_POINT
@@ -360,6 +427,88 @@ int uECC_verify(const uint8_t *public_key,
                 const uint8_t *signature,
                 uECC_Curve curve);
 
+/* uECC_verify_batch() function.
+Verify several ECDSA signatures at once. Gives the same answers as calling uECC_verify() on
+each signature, with the same wNAF windows, but shares the inversion of s and of each result's Z
+across the batch (Montgomery's trick).
+
+Inputs are structures of arrays: the i-th signature uses the i-th entry of each array.
+    public_keys    - count public keys, 2 * curve size bytes each, back to back.
+    message_hashes - count hashes, hash_size bytes each, back to back.
+    hash_size      - The size of each message hash in bytes.
+    signatures     - count signatures, 2 * curve size bytes each, back to back.
+    count          - The number of signatures.
+
+Outputs:
+    results - Optional (may be NULL). Will be filled in with 1 for each valid signature and
+              0 for each invalid one.
+
+Returns 1 if every signature is valid, 0 otherwise.
+*/
+int uECC_verify_batch(const uint8_t *public_keys,
+                      const uint8_t *message_hashes,
+                      unsigned hash_size,
+                      const uint8_t *signatures,
+                      unsigned count,
+                      uECC_Curve curve,
+                      uint8_t *results);
+
+/* uECC_verify_precomp_size() function.
+Returns the size in bytes of the buffer uECC_verify_precompute() fills for one public key.
+*/
+int uECC_verify_precomp_size(void);
+
+/* uECC_verify_precompute() function.
+Precompute the multiples of a public key that uECC_verify() would build for every signature, so
+that signatures from a key that is verified often can be checked with uECC_verify_precomputed()
+instead, without that work.
+
+Inputs:
+    public_key - The signer's public key.
+
+Outputs:
+    precomp - Will be filled in with uECC_verify_precomp_size() bytes. Must be aligned for
+              uECC_word_t, as memory from malloc() is.
+
+Returns 1 if the public key is valid (see uECC_valid_public_key()), 0 if it is not.
+*/
+int uECC_verify_precompute(const uint8_t *public_key, uint8_t *precomp, uECC_Curve curve);
+
+/* uECC_verify_precomputed() function.
+Same as uECC_verify(), with the public key given by what uECC_verify_precompute() computed for it
+on the same curve.
+
+Returns 1 if the signature is valid, 0 if it is invalid.
+*/
+int uECC_verify_precomputed(const uint8_t *precomp,
+                            const uint8_t *message_hash,
+                            unsigned hash_size,
+                            const uint8_t *signature,
+                            uECC_Curve curve);
+
+#if uECC_ENABLE_OP_COUNTERS
+
+/* Operations counted since the last uECC_reset_op_counters(). Squarings are counted apart from
+multiplications even when uECC_SQUARE_FUNC is 0 and they are done as multiplications. */
+typedef struct uECC_OpCounters {
+    uint32_t mod_mult;        /* uECC_vli_modMult_fast() */
+    uint32_t mod_square;      /* uECC_vli_modSquare_fast() */
+    uint32_t mod_inv;         /* uECC_vli_modInv(), modulo p or n */
+    uint32_t double_jacobian; /* point doublings, except of the point at infinity */
+    uint32_t xycz_add;        /* co-Z additions (XYcZ_add) */
+    uint32_t xycz_addc;       /* conjugate co-Z additions (XYcZ_addC) */
+    uint32_t affine_add;      /* additions of an affine point (fixed-base comb, verify windows) */
+} uECC_OpCounters;
+
+/* uECC_reset_op_counters() and uECC_get_op_counters() functions.
+Count the operations of one call by resetting the counters before it and reading them after.
+The counters are global: calls running at the same time on other tasks add to them too.
+*/
+void uECC_reset_op_counters(void);
+void uECC_get_op_counters(uECC_OpCounters *counters);
+
+#endif /* uECC_ENABLE_OP_COUNTERS */
+
 #ifdef __cplusplus
 } /* end of extern "C" */
 #endif
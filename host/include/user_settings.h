@@ -0,0 +1,52 @@
+/* host/include/user_settings.h
+ *
+ * wolfSSL settings for the Linux host build of the CryptoAPI component.
+ *
+ * Mirrors the wolfCrypt features that components/wolfssl/include/user_settings.h
+ * enables on the ESP32 (same curves, hashes and math library), minus the
+ * Espressif hardware acceleration and TLS layer, so host numbers compare the
+ * same code paths the device runs.
+ */
+#ifndef CRYPTO_API_HOST_USER_SETTINGS_H
+#define CRYPTO_API_HOST_USER_SETTINGS_H
+
+#define WOLFCRYPT_ONLY
+#define NO_FILESYSTEM
+#define NO_OLD_TLS
+#define NO_DSA
+#define NO_MD4
+#define NO_RC4
+#define NO_DES3
+#define NO_PWDBASED
+
+/* ---- Hashes ---- */
+#define WOLFSSL_SHA512
+#define WOLFSSL_SHA3
+#define WOLFSSL_SHAKE256
+
+/* ---- ECDSA / ECC ---- */
+#define HAVE_ECC
+#define ECC_TIMING_RESISTANT
+#define WOLFSSL_CUSTOM_CURVES
+#define HAVE_ECC_BRAINPOOL
+#define HAVE_ECC521
+
+/* ---- EdDSA ---- */
+#define HAVE_CURVE25519
+#define HAVE_ED25519
+#define HAVE_CURVE448
+#define HAVE_ED448
+
+/* ---- RSA ---- */
+#define WC_RSA_BLINDING
+#define WOLFSSL_KEY_GEN
+
+/* ---- Math, as on the device ---- */
+#define USE_FAST_MATH
+#define TFM_TIMING_RESISTANT
+#define FP_MAX_BITS (8192 * 2)
+#define WOLFSSL_SMALL_STACK
+
+#define WOLFSSL_BASE64_ENCODE
+
+#endif
@@ -0,0 +1,1383 @@
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "BenchmarkBaseline.h"
+#include "BenchmarkMatrix.h"
+#include "BenchmarkRunner.h"
+#include "BenchmarkSweep.h"
+#include "CryptoAPI.h"
+#include "CryptoJobQueue.h"
+#include "CryptoSession.h"
+#include "StackProfiler.h"
+#include "uECC.h"
+
+#define MY_RSA_KEY_SIZE 2048
+#define MY_RSA_EXPONENT 65537
+
+struct BenchConfig
+{
+    Libraries library;
+    Algorithms algorithm;
+    Hashes hash;
+    size_t shake_256_length;
+    size_t message_length;
+    int iterations;
+    int batch_size;
+    bool pipeline;
+    bool async;
+    bool session;
+    bool stats;
+    int warmup;
+    bool allocations;
+    bool stack;
+    bool matrix;
+};
+
+// Every --stats and --matrix result of this run, for --save-baseline and
+// --compare
+static BenchmarkBaseline current_run;
+
+struct NamedValue
+{
+    const char *name;
+    int value;
+};
+
+static const NamedValue library_names[] = {
+    {"mbedtls", Libraries::MBEDTLS_LIB},
+    {"wolfssl", Libraries::WOLFSSL_LIB},
+    {"microecc", Libraries::MICROECC_LIB},
+};
+
+static const NamedValue format_names[] = {
+    {"csv", ResultFormat::RESULT_CSV},
+    {"json", ResultFormat::RESULT_JSON},
+};
+
+static const NamedValue algorithm_names[] = {
+    {"bp256r1", Algorithms::ECDSA_BP256R1},
+    {"bp512r1", Algorithms::ECDSA_BP512R1},
+    {"secp256r1", Algorithms::ECDSA_SECP256R1},
+    {"secp521r1", Algorithms::ECDSA_SECP521R1},
+    {"ed25519", Algorithms::EDDSA_25519},
+    {"ed448", Algorithms::EDDSA_448},
+    {"rsa", Algorithms::RSA},
+};
+
+static const NamedValue hash_names[] = {
+    {"sha256", Hashes::MY_SHA_256},
+    {"sha512", Hashes::MY_SHA_512},
+    {"sha3-256", Hashes::MY_SHA3_256},
+    {"shake256", Hashes::MY_SHAKE_256},
+};
+
+template <size_t N>
+static int parse_name(const NamedValue (&table)[N], const char *name)
+{
+    for (const NamedValue &entry : table)
+    {
+        if (strcmp(entry.name, name) == 0)
+        {
+            return entry.value;
+        }
+    }
+    return -1;
+}
+
+// Parses a non-negative decimal count, or returns -1.
+static int parse_count(const char *value)
+{
+    char *end = NULL;
+    long parsed = strtol(value, &end, 10);
+    if (end == value || *end != '\0' || parsed < 0 || parsed > INT_MAX)
+    {
+        return -1;
+    }
+    return (int)parsed;
+}
+
+template <size_t N>
+static const char *to_name(const NamedValue (&table)[N], int value)
+{
+    for (const NamedValue &entry : table)
+    {
+        if (entry.value == value)
+        {
+            return entry.name;
+        }
+    }
+    return "unknown";
+}
+
+static void print_usage(const char *program)
+{
+    printf("Usage: %s [options]\n\n", program);
+    printf("  -l, --library NAME      mbedtls | wolfssl | microecc (default: all three)\n");
+    printf("  -a, --algorithm NAME    bp256r1 | bp512r1 | secp256r1 | secp521r1 | ed25519 | ed448 | rsa (default: secp256r1)\n");
+    printf("  -H, --hash NAME         sha256 | sha512 | sha3-256 | shake256 (default: sha256)\n");
+    printf("  -s, --shake-length N    SHAKE256 output length in bytes (default: 64)\n");
+    printf("  -m, --message-size N    message size in bytes (default: 580)\n");
+    printf("  -n, --iterations N      sign/verify operations per run (default: 100)\n");
+    printf("  -b, --batch N           compare sign_batch() in batches of N against single sign() calls\n");
+    printf("  -p, --pipeline          compare sign_pipelined() against the same messages signed one by one\n");
+    printf("  -A, --async             sign and verify through a CryptoJobQueue and report how long submitting takes\n");
+    printf("  -S, --session           compare a full init/keygen/sign/verify/close cycle per operation with a warm CryptoSession\n");
+    printf("  -t, --stats             measure each sign and verify and report min/median/p95/p99/mean, stddev and a 95%% confidence interval\n");
+    printf("  -w, --warmup N          unmeasured iterations before --stats starts measuring (default: 5)\n");
+    printf("  -M, --allocations       report allocations, peak heap and bytes not freed of keygen, sign and verify\n");
+    printf("  -k, --stack             report the stack keygen, sign and verify need, each run on its own task\n");
+    printf("  -X, --matrix            --stats for keygen, sign and verify over every supported library/algorithm/hash, as one table\n");
+    printf("  -o, --output FILE       write every recorded operation to FILE (\"-\" for stdout) after the run\n");
+    printf("      --save-baseline FILE  save the --stats/--matrix results (--stats if neither is given) to FILE\n");
+    printf("      --compare FILE      compare the --stats/--matrix results with a saved baseline; exits 1 on a regression\n");
+    printf("      --threshold PCT     smallest change of the mean --compare reports (default: 5)\n");
+    printf("      --format NAME       csv | json (default: csv)\n");
+    printf("      --trace FILE        write the phases of the last operations as Chrome trace-event JSON to FILE (\"-\" for stdout), for ui.perfetto.dev\n");
+    printf("  -f, --footprint         report the heap and time each backend costs on first use, then exit\n");
+    printf("  -Z, --sweep MAX         sign and verify 0 B to MAX-byte messages with every library and hash for -a, report hash MB/s,\n");
+    printf("                          sign/verify times and the size where hashing overtakes the signature math, then exit\n");
+    printf("  -K, --key-cache N       verify with verify_with_key() round-robin over N micro-ecc keys, with the key cache\n");
+    printf("                          cleared before every call and kept warm, then exit\n");
+    printf("  -F, --field-ops         report the field operations micro-ecc needs for keygen, sign and verify on each curve, then exit\n");
+    printf("  -v, --verbose           keep the per-operation CryptoAPI logs\n");
+}
+
+// Runs keygen once, then `iterations` signs followed by `iterations` verifies,
+// and prints one row of the result table. Returns the first non-zero status.
+static int run_bench(CryptoAPI &crypto_api, const BenchConfig &config)
+{
+    int ret = crypto_api.init(config.library, config.algorithm, config.hash, config.shake_256_length);
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    int64_t keygen_start = esp_timer_get_time();
+    if (config.algorithm == Algorithms::RSA)
+    {
+        ret = crypto_api.gen_rsa_keys(MY_RSA_KEY_SIZE, MY_RSA_EXPONENT);
+    }
+    else
+    {
+        ret = crypto_api.gen_keys();
+    }
+    int64_t keygen_end = esp_timer_get_time();
+
+    if (ret != 0)
+    {
+        crypto_api.close();
+        return ret;
+    }
+
+    std::vector<unsigned char> message(config.message_length);
+    esp_fill_random(message.data(), message.size());
+
+    size_t signature_capacity = crypto_api.get_signature_size();
+    std::vector<unsigned char> signature(signature_capacity);
+    size_t signature_length = signature_capacity;
+
+    int64_t sign_start = esp_timer_get_time();
+    for (int i = 0; i < config.iterations && ret == 0; i++)
+    {
+        signature_length = signature_capacity;
+        ret = crypto_api.sign(message.data(), message.size(), signature.data(), &signature_length);
+    }
+    int64_t sign_end = esp_timer_get_time();
+
+    int64_t verify_start = esp_timer_get_time();
+    for (int i = 0; i < config.iterations && ret == 0; i++)
+    {
+        ret = crypto_api.verify(message.data(), message.size(), signature.data(), signature_length);
+    }
+    int64_t verify_end = esp_timer_get_time();
+
+    crypto_api.close();
+
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    double sign_seconds = (sign_end - sign_start) / 1e6;
+    double verify_seconds = (verify_end - verify_start) / 1e6;
+
+    printf("%-9s %-10s %-9s %10.3f %12.1f %12.1f %12.3f %12.3f\n",
+           to_name(library_names, config.library),
+           to_name(algorithm_names, config.algorithm),
+           to_name(hash_names, config.hash),
+           (keygen_end - keygen_start) / 1000.0,
+           config.iterations / sign_seconds,
+           config.iterations / verify_seconds,
+           sign_seconds * 1000.0 / config.iterations,
+           verify_seconds * 1000.0 / config.iterations);
+
+    return 0;
+}
+
+// Signs the same `iterations` messages once with single sign() calls and once
+// with sign_batch() in batches of `batch_size`, then verifies every batched
+// signature. Prints one row comparing the two message rates.
+static int run_batch_bench(CryptoAPI &crypto_api, const BenchConfig &config)
+{
+    int ret = crypto_api.init(config.library, config.algorithm, config.hash, config.shake_256_length);
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    ret = config.algorithm == Algorithms::RSA ? crypto_api.gen_rsa_keys(MY_RSA_KEY_SIZE, MY_RSA_EXPONENT) : crypto_api.gen_keys();
+    if (ret != 0)
+    {
+        crypto_api.close();
+        return ret;
+    }
+
+    size_t count = config.iterations;
+    size_t signature_capacity = crypto_api.get_signature_size();
+
+    std::vector<unsigned char> message_data(count * config.message_length);
+    esp_fill_random(message_data.data(), message_data.size());
+    std::vector<unsigned char> signature_data(count * signature_capacity);
+
+    std::vector<const unsigned char *> messages(count);
+    std::vector<size_t> message_lengths(count, config.message_length);
+    std::vector<unsigned char *> signatures(count);
+    std::vector<size_t> signature_lengths(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        messages[i] = message_data.data() + i * config.message_length;
+        signatures[i] = signature_data.data() + i * signature_capacity;
+    }
+
+    int64_t single_start = esp_timer_get_time();
+    for (size_t i = 0; i < count && ret == 0; i++)
+    {
+        signature_lengths[i] = signature_capacity;
+        ret = crypto_api.sign(messages[i], message_lengths[i], signatures[i], &signature_lengths[i]);
+    }
+    int64_t single_end = esp_timer_get_time();
+
+    int64_t batch_start = esp_timer_get_time();
+    for (size_t first = 0; first < count && ret == 0; first += config.batch_size)
+    {
+        size_t n = count - first < (size_t)config.batch_size ? count - first : config.batch_size;
+        for (size_t i = first; i < first + n; i++)
+        {
+            signature_lengths[i] = signature_capacity;
+        }
+        ret = crypto_api.sign_batch(&messages[first], &message_lengths[first], n, &signatures[first], &signature_lengths[first]);
+    }
+    int64_t batch_end = esp_timer_get_time();
+
+    for (size_t i = 0; i < count && ret == 0; i++)
+    {
+        ret = crypto_api.verify(messages[i], message_lengths[i], signatures[i], signature_lengths[i]);
+    }
+
+    crypto_api.close();
+
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    double single_rate = count / ((single_end - single_start) / 1e6);
+    double batch_rate = count / ((batch_end - batch_start) / 1e6);
+
+    printf("%-9s %-10s %-9s %6d %14.1f %14.1f %8.2fx\n",
+           to_name(library_names, config.library),
+           to_name(algorithm_names, config.algorithm),
+           to_name(hash_names, config.hash),
+           config.batch_size,
+           single_rate,
+           batch_rate,
+           batch_rate / single_rate);
+
+    return 0;
+}
+
+// Signs the same `iterations` messages once with single sign() calls and once
+// with sign_pipelined(), which hashes on a second thread while this one signs,
+// then verifies every pipelined signature. Prints one row comparing the two
+// message rates.
+static int run_pipeline_bench(CryptoAPI &crypto_api, const BenchConfig &config)
+{
+    int ret = crypto_api.init(config.library, config.algorithm, config.hash, config.shake_256_length);
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    ret = config.algorithm == Algorithms::RSA ? crypto_api.gen_rsa_keys(MY_RSA_KEY_SIZE, MY_RSA_EXPONENT) : crypto_api.gen_keys();
+    if (ret != 0)
+    {
+        crypto_api.close();
+        return ret;
+    }
+
+    size_t count = config.iterations;
+    size_t signature_capacity = crypto_api.get_signature_size();
+
+    std::vector<unsigned char> message_data(count * config.message_length);
+    esp_fill_random(message_data.data(), message_data.size());
+    std::vector<unsigned char> signature_data(count * signature_capacity);
+
+    std::vector<const unsigned char *> messages(count);
+    std::vector<size_t> message_lengths(count, config.message_length);
+    std::vector<unsigned char *> signatures(count);
+    std::vector<size_t> signature_lengths(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        messages[i] = message_data.data() + i * config.message_length;
+        signatures[i] = signature_data.data() + i * signature_capacity;
+    }
+
+    int64_t serial_start = esp_timer_get_time();
+    for (size_t i = 0; i < count && ret == 0; i++)
+    {
+        signature_lengths[i] = signature_capacity;
+        ret = crypto_api.sign(messages[i], message_lengths[i], signatures[i], &signature_lengths[i]);
+    }
+    int64_t serial_end = esp_timer_get_time();
+
+    for (size_t i = 0; i < count; i++)
+    {
+        signature_lengths[i] = signature_capacity;
+    }
+
+    int64_t pipelined_start = esp_timer_get_time();
+    if (ret == 0)
+    {
+        ret = crypto_api.sign_pipelined(messages.data(), message_lengths.data(), count, signatures.data(), signature_lengths.data());
+    }
+    int64_t pipelined_end = esp_timer_get_time();
+
+    for (size_t i = 0; i < count && ret == 0; i++)
+    {
+        ret = crypto_api.verify(messages[i], message_lengths[i], signatures[i], signature_lengths[i]);
+    }
+
+    crypto_api.close();
+
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    double serial_rate = count / ((serial_end - serial_start) / 1e6);
+    double pipelined_rate = count / ((pipelined_end - pipelined_start) / 1e6);
+
+    printf("%-9s %-10s %-9s %8zu %14.1f %14.1f %8.2fx\n",
+           to_name(library_names, config.library),
+           to_name(algorithm_names, config.algorithm),
+           to_name(hash_names, config.hash),
+           config.message_length,
+           serial_rate,
+           pipelined_rate,
+           pipelined_rate / serial_rate);
+
+    return 0;
+}
+
+// Submits `iterations` sign jobs and then as many verify jobs to a
+// CryptoJobQueue, collecting them with wait(). When every job is in flight the
+// oldest one is waited for before submitting again. Prints one row with the
+// worst and mean submit latency next to the resulting throughput, and fails
+// unless a verify job on a tampered signature returns a nonzero status.
+static int run_async_bench(CryptoAPI &crypto_api, const BenchConfig &config)
+{
+    int ret = crypto_api.init(config.library, config.algorithm, config.hash, config.shake_256_length);
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    ret = config.algorithm == Algorithms::RSA ? crypto_api.gen_rsa_keys(MY_RSA_KEY_SIZE, MY_RSA_EXPONENT) : crypto_api.gen_keys();
+    if (ret != 0)
+    {
+        crypto_api.close();
+        return ret;
+    }
+
+    CryptoJobQueue job_queue(crypto_api);
+    ret = job_queue.init();
+    if (ret != 0)
+    {
+        crypto_api.close();
+        return ret;
+    }
+
+    size_t count = config.iterations;
+    size_t signature_capacity = crypto_api.get_signature_size();
+
+    std::vector<unsigned char> message_data(count * config.message_length);
+    esp_fill_random(message_data.data(), message_data.size());
+    std::vector<unsigned char> signature_data(count * signature_capacity);
+    std::vector<size_t> signature_lengths(count, signature_capacity);
+    std::vector<CryptoJob *> jobs(count);
+
+    int64_t max_submit = 0;
+    int64_t total_submit = 0;
+    int64_t elapsed[2];
+
+    for (int pass = 0; pass < 2 && ret == 0; pass++)
+    {
+        size_t collected = 0;
+        int64_t start = esp_timer_get_time();
+
+        for (size_t i = 0; i < count && ret == 0; i++)
+        {
+            const unsigned char *message = message_data.data() + i * config.message_length;
+            unsigned char *signature = signature_data.data() + i * signature_capacity;
+
+            for (;;)
+            {
+                int64_t submit_start = esp_timer_get_time();
+                jobs[i] = pass == 0 ? job_queue.submit_sign(message, config.message_length, signature, &signature_lengths[i])
+                                    : job_queue.submit_verify(message, config.message_length, signature, signature_lengths[i]);
+                int64_t submit_time = esp_timer_get_time() - submit_start;
+
+                if (jobs[i] != NULL)
+                {
+                    max_submit = submit_time > max_submit ? submit_time : max_submit;
+                    total_submit += submit_time;
+                    break;
+                }
+                ret = job_queue.wait(jobs[collected++]);
+                if (ret != 0)
+                {
+                    break;
+                }
+            }
+        }
+
+        while (collected < count && jobs[collected] != NULL)
+        {
+            int status = job_queue.wait(jobs[collected++]);
+            ret = ret != 0 ? ret : status;
+        }
+
+        elapsed[pass] = esp_timer_get_time() - start;
+    }
+
+    // A tampered signature must come back from the worker as a failure
+    if (ret == 0)
+    {
+        signature_data[signature_lengths[0] / 2] ^= 0x01;
+        CryptoJob *job = job_queue.submit_verify(message_data.data(), config.message_length, signature_data.data(), signature_lengths[0]);
+        if (job == NULL || job_queue.wait(job) == 0)
+        {
+            fprintf(stderr, "A tampered signature passed the verify job\n");
+            ret = -1;
+        }
+    }
+
+    job_queue.close();
+    crypto_api.close();
+
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    printf("%-9s %-10s %-9s %14lld %14.1f %12.1f %12.1f\n",
+           to_name(library_names, config.library),
+           to_name(algorithm_names, config.algorithm),
+           to_name(hash_names, config.hash),
+           (long long)max_submit,
+           (double)total_submit / (2 * count),
+           count / (elapsed[0] / 1e6),
+           count / (elapsed[1] / 1e6));
+
+    return 0;
+}
+
+// Runs `iterations` sign+verify rounds twice: cold, paying init, key
+// generation and close every round as app_main does, and warm, through a
+// CryptoSession that sets everything up on its first open() only. Prints the
+// per-round cost of both and the cost of the first, cold session open.
+static int run_session_bench(CryptoAPI &crypto_api, const BenchConfig &config)
+{
+    std::vector<unsigned char> message(config.message_length);
+    esp_fill_random(message.data(), message.size());
+    std::vector<unsigned char> signature;
+    size_t signature_length = 0;
+    int ret = 0;
+
+    int64_t cold_start = esp_timer_get_time();
+    for (int i = 0; i < config.iterations && ret == 0; i++)
+    {
+        ret = crypto_api.init(config.library, config.algorithm, config.hash, config.shake_256_length);
+        if (ret == 0)
+        {
+            ret = config.algorithm == Algorithms::RSA ? crypto_api.gen_rsa_keys(MY_RSA_KEY_SIZE, MY_RSA_EXPONENT) : crypto_api.gen_keys();
+        }
+        if (ret == 0)
+        {
+            signature.resize(crypto_api.get_signature_size());
+            signature_length = signature.size();
+            ret = crypto_api.sign(message.data(), message.size(), signature.data(), &signature_length);
+        }
+        if (ret == 0)
+        {
+            ret = crypto_api.verify(message.data(), message.size(), signature.data(), signature_length);
+        }
+        crypto_api.close();
+    }
+    int64_t cold_end = esp_timer_get_time();
+
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    CryptoSession session(crypto_api);
+
+    int64_t first_open_start = esp_timer_get_time();
+    ret = session.open(config.library, config.algorithm, config.hash, config.shake_256_length, MY_RSA_KEY_SIZE, MY_RSA_EXPONENT);
+    int64_t first_open_end = esp_timer_get_time();
+
+    int64_t warm_start = esp_timer_get_time();
+    for (int i = 0; i < config.iterations && ret == 0; i++)
+    {
+        ret = session.open(config.library, config.algorithm, config.hash, config.shake_256_length, MY_RSA_KEY_SIZE, MY_RSA_EXPONENT);
+        if (ret == 0)
+        {
+            signature.resize(crypto_api.get_signature_size());
+            signature_length = signature.size();
+            ret = crypto_api.sign(message.data(), message.size(), signature.data(), &signature_length);
+        }
+        if (ret == 0)
+        {
+            ret = crypto_api.verify(message.data(), message.size(), signature.data(), signature_length);
+        }
+    }
+    int64_t warm_end = esp_timer_get_time();
+
+    session.close();
+
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    double cold_ms = (cold_end - cold_start) / 1000.0 / config.iterations;
+    double warm_ms = (warm_end - warm_start) / 1000.0 / config.iterations;
+
+    printf("%-9s %-10s %-9s %12.3f %12.3f %12.3f %8.2fx\n",
+           to_name(library_names, config.library),
+           to_name(algorithm_names, config.algorithm),
+           to_name(hash_names, config.hash),
+           cold_ms,
+           (first_open_end - first_open_start) / 1000.0,
+           warm_ms,
+           cold_ms / warm_ms);
+
+    return 0;
+}
+
+struct OperationContext
+{
+    CryptoAPI *crypto_api;
+    bool rsa;
+    std::vector<unsigned char> message;
+    std::vector<unsigned char> signature;
+    size_t signature_length;
+};
+
+static int gen_keys_once(void *user_data)
+{
+    OperationContext *context = (OperationContext *)user_data;
+    return context->rsa ? context->crypto_api->gen_rsa_keys(MY_RSA_KEY_SIZE, MY_RSA_EXPONENT) : context->crypto_api->gen_keys();
+}
+
+static int sign_once(void *user_data)
+{
+    OperationContext *context = (OperationContext *)user_data;
+    context->signature_length = context->signature.size();
+    return context->crypto_api->sign(context->message.data(), context->message.size(), context->signature.data(), &context->signature_length);
+}
+
+static int verify_once(void *user_data)
+{
+    OperationContext *context = (OperationContext *)user_data;
+    return context->crypto_api->verify(context->message.data(), context->message.size(), context->signature.data(), context->signature_length);
+}
+
+static void print_stats_row(const BenchConfig &config, const char *operation, const BenchmarkStats &stats)
+{
+    printf("%-9s %-10s %-9s %-6s %5u %4u %10.3f %10.3f %10.3f %10.3f %10.3f %8.3f %9.3f\n",
+           to_name(library_names, config.library),
+           to_name(algorithm_names, config.algorithm),
+           to_name(hash_names, config.hash),
+           operation,
+           (unsigned)stats.samples,
+           (unsigned)stats.rejected,
+           stats.min_ns / 1e6,
+           stats.median_ns / 1e6,
+           stats.p95_ns / 1e6,
+           stats.p99_ns / 1e6,
+           stats.mean_ns / 1e6,
+           stats.ci95_ns / 1e6,
+           stats.stddev_ns / 1e6);
+}
+
+// Measures every sign and verify on its own through BenchmarkRunner, after
+// `warmup` unmeasured ones, and prints a row of statistics for each.
+static int run_stats_bench(CryptoAPI &crypto_api, const BenchConfig &config)
+{
+    int ret = crypto_api.init(config.library, config.algorithm, config.hash, config.shake_256_length);
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    ret = config.algorithm == Algorithms::RSA ? crypto_api.gen_rsa_keys(MY_RSA_KEY_SIZE, MY_RSA_EXPONENT) : crypto_api.gen_keys();
+    if (ret != 0)
+    {
+        crypto_api.close();
+        return ret;
+    }
+
+    OperationContext context;
+    context.crypto_api = &crypto_api;
+    context.rsa = config.algorithm == Algorithms::RSA;
+    context.message.resize(config.message_length);
+    esp_fill_random(context.message.data(), context.message.size());
+    context.signature.resize(crypto_api.get_signature_size());
+    context.signature_length = context.signature.size();
+
+    BenchmarkRunner runner(config.warmup, config.iterations);
+    BenchmarkStats sign_stats;
+    BenchmarkStats verify_stats;
+
+    ret = runner.run("sign", sign_once, &context, &sign_stats);
+    if (ret == 0)
+    {
+        ret = runner.run("verify", verify_once, &context, &verify_stats);
+    }
+
+    crypto_api.close();
+
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    print_stats_row(config, "sign", sign_stats);
+    print_stats_row(config, "verify", verify_stats);
+    current_run.add(config.library, config.algorithm, config.hash, "sign", sign_stats);
+    current_run.add(config.library, config.algorithm, config.hash, "verify", verify_stats);
+
+    return 0;
+}
+
+static void print_allocation_row(const BenchConfig &config, const char *operation, const AllocationStats &stats)
+{
+    printf("%-9s %-10s %-9s %-8s %8lu %8lu %12lu %12lu\n",
+           to_name(library_names, config.library),
+           to_name(algorithm_names, config.algorithm),
+           to_name(hash_names, config.hash),
+           operation,
+           (unsigned long)stats.allocations,
+           (unsigned long)stats.frees,
+           (unsigned long)stats.peak_bytes,
+           (unsigned long)stats.leaked_bytes);
+}
+
+// Generates keys, signs and verifies once each and prints what the
+// allocation tracer saw for every step.
+static int run_allocation_bench(CryptoAPI &crypto_api, const BenchConfig &config)
+{
+    int ret = crypto_api.init(config.library, config.algorithm, config.hash, config.shake_256_length);
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    const char *keygen = config.algorithm == Algorithms::RSA ? "gen_rsa" : "gen_keys";
+    ret = config.algorithm == Algorithms::RSA ? crypto_api.gen_rsa_keys(MY_RSA_KEY_SIZE, MY_RSA_EXPONENT) : crypto_api.gen_keys();
+    AllocationStats keygen_stats = crypto_api.get_last_allocations();
+
+    std::vector<unsigned char> message(config.message_length);
+    esp_fill_random(message.data(), message.size());
+    std::vector<unsigned char> signature(crypto_api.get_signature_size());
+    size_t signature_length = signature.size();
+
+    AllocationStats sign_stats = {};
+    AllocationStats verify_stats = {};
+    if (ret == 0)
+    {
+        ret = crypto_api.sign(message.data(), message.size(), signature.data(), &signature_length);
+        sign_stats = crypto_api.get_last_allocations();
+    }
+    if (ret == 0)
+    {
+        ret = crypto_api.verify(message.data(), message.size(), signature.data(), signature_length);
+        verify_stats = crypto_api.get_last_allocations();
+    }
+
+    crypto_api.close();
+
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    print_allocation_row(config, keygen, keygen_stats);
+    print_allocation_row(config, "sign", sign_stats);
+    print_allocation_row(config, "verify", verify_stats);
+
+    return 0;
+}
+
+// Runs keygen, sign and verify once each on a StackProfiler task and prints
+// the stack each one used.
+static int run_stack_bench(CryptoAPI &crypto_api, const BenchConfig &config)
+{
+    int ret = crypto_api.init(config.library, config.algorithm, config.hash, config.shake_256_length);
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    OperationContext context;
+    context.crypto_api = &crypto_api;
+    context.rsa = config.algorithm == Algorithms::RSA;
+    context.message.resize(config.message_length);
+    esp_fill_random(context.message.data(), context.message.size());
+    context.signature.resize(crypto_api.get_signature_size());
+    context.signature_length = context.signature.size();
+
+    StackProfiler profiler;
+    uint32_t keygen_bytes = 0;
+    uint32_t sign_bytes = 0;
+    uint32_t verify_bytes = 0;
+
+    ret = profiler.run("gen_keys", gen_keys_once, &context, &keygen_bytes);
+    if (ret == 0)
+    {
+        ret = profiler.run("sign", sign_once, &context, &sign_bytes);
+    }
+    if (ret == 0)
+    {
+        ret = profiler.run("verify", verify_once, &context, &verify_bytes);
+    }
+
+    crypto_api.close();
+
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    printf("%-9s %-10s %-9s %12lu %12lu %12lu\n",
+           to_name(library_names, config.library),
+           to_name(algorithm_names, config.algorithm),
+           to_name(hash_names, config.hash),
+           (unsigned long)keygen_bytes,
+           (unsigned long)sign_bytes,
+           (unsigned long)verify_bytes);
+
+    return 0;
+}
+
+// Runs BenchmarkMatrix over every supported library, algorithm and hash;
+// -l/-a/-H are ignored.
+static int run_matrix_bench(CryptoAPI &crypto_api, const BenchConfig &config)
+{
+    std::vector<unsigned char> message(config.message_length);
+    esp_fill_random(message.data(), message.size());
+
+    BenchmarkMatrix matrix(crypto_api, config.warmup, config.iterations);
+    int ret = matrix.run(message.data(), message.size(), MY_RSA_KEY_SIZE, MY_RSA_EXPONENT, config.shake_256_length);
+    matrix.print_table(stdout);
+
+    for (size_t i = 0; i < matrix.size(); i++)
+    {
+        const MatrixCell &cell = matrix.at(i);
+        if (cell.status == 0)
+        {
+            current_run.add(cell.library, cell.algorithm, cell.hash, "keygen", cell.keygen);
+            current_run.add(cell.library, cell.algorithm, cell.hash, "sign", cell.sign);
+            current_run.add(cell.library, cell.algorithm, cell.hash, "verify", cell.verify);
+        }
+    }
+    return ret;
+}
+
+// Runs BenchmarkSweep for -a over every supported library and hash; -l/-H/-m
+// are ignored.
+static int run_sweep(const BenchConfig &config, size_t max_size)
+{
+    CryptoAPI crypto_api;
+    BenchmarkSweep sweep(crypto_api, max_size);
+    int ret = sweep.run(config.algorithm, MY_RSA_KEY_SIZE, MY_RSA_EXPONENT, config.shake_256_length);
+    sweep.print_table(stdout);
+    crypto_api.flush_log();
+    return ret == 0 ? 0 : 1;
+}
+
+// Verifies `iterations` signatures by `keys` secp256r1 keys, taken round-robin,
+// through verify_with_key(): cold, with the key cache cleared before every
+// call, and warm, with the cache kept. More keys than the cache holds make
+// every warm call a miss as well, which the hit and eviction counts show.
+static int run_key_cache_bench(const BenchConfig &config, int keys)
+{
+    CryptoAPI crypto_api;
+    int ret = crypto_api.init(Libraries::MICROECC_LIB, Algorithms::ECDSA_SECP256R1, config.hash, config.shake_256_length);
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    // The keys are someone else's, so they are made and used with micro-ecc
+    // directly; only the verification goes through the CryptoAPI
+    size_t key_size = uECC_curve_public_key_size(uECC_secp256r1());
+    size_t signature_size = crypto_api.get_signature_size();
+    std::vector<unsigned char> message(config.message_length);
+    std::vector<unsigned char> hash(crypto_api.get_digest_length());
+    std::vector<unsigned char> public_keys(keys * key_size);
+    std::vector<unsigned char> signatures(keys * signature_size);
+    esp_fill_random(message.data(), message.size());
+    ret = crypto_api.hash_message(message.data(), message.size(), hash.data());
+    for (int i = 0; i < keys && ret == 0; i++)
+    {
+        uint8_t private_key[32];
+        if (!uECC_make_key(&public_keys[i * key_size], private_key, uECC_secp256r1()) ||
+            !uECC_sign(private_key, hash.data(), hash.size(), &signatures[i * signature_size], uECC_secp256r1()))
+        {
+            ret = -1;
+        }
+    }
+
+    int64_t times[2] = {0, 0};
+    for (int warm = 0; warm < 2 && ret == 0; warm++)
+    {
+        crypto_api.clear_key_cache();
+        int64_t start = esp_timer_get_time();
+        for (int i = 0; i < config.iterations && ret == 0; i++)
+        {
+            if (!warm)
+            {
+                crypto_api.clear_key_cache();
+            }
+            int k = i % keys;
+            ret = crypto_api.verify_with_key(&public_keys[k * key_size], key_size, message.data(), message.size(), &signatures[k * signature_size], signature_size);
+        }
+        times[warm] = esp_timer_get_time() - start;
+    }
+    KeyCacheStats stats = crypto_api.get_key_cache_stats();
+    crypto_api.close();
+    if (ret != 0)
+    {
+        return 1;
+    }
+
+    double cold_ms = times[0] / 1000.0 / config.iterations;
+    double warm_ms = times[1] / 1000.0 / config.iterations;
+    printf("%6s %9s %12s %12s %9s %8s %8s %10s\n",
+           "keys", "capacity", "cold ms/op", "warm ms/op", "speedup", "hits", "misses", "evictions");
+    printf("%6d %9u %12.3f %12.3f %8.2fx %8lu %8lu %10lu\n",
+           keys, (unsigned)stats.capacity, cold_ms, warm_ms, cold_ms / warm_ms, stats.hits, stats.misses, stats.evictions);
+    return 0;
+}
+
+// Backends are constructed lazily on the first init() that selects them, so a
+// fresh CryptoAPI per library shows what each one adds to heap and start-up
+// time. The second init() is the steady-state cost once the module exists.
+static int run_footprint(const BenchConfig &config)
+{
+    printf("%-9s %12s %14s %14s %12s\n", "library", "construct us", "first init us", "second init us", "heap bytes");
+
+    for (const NamedValue &library : library_names)
+    {
+        uint32_t free_before = esp_get_free_heap_size();
+        int64_t construct_start = esp_timer_get_time();
+        CryptoAPI *crypto_api = new CryptoAPI();
+        int64_t construct_end = esp_timer_get_time();
+
+        int64_t first_start = esp_timer_get_time();
+        int ret = crypto_api->init((Libraries)library.value, config.algorithm, config.hash, config.shake_256_length);
+        int64_t first_end = esp_timer_get_time();
+        uint32_t free_after = esp_get_free_heap_size();
+        crypto_api->close();
+
+        int64_t second_start = esp_timer_get_time();
+        if (ret == 0)
+        {
+            ret = crypto_api->init((Libraries)library.value, config.algorithm, config.hash, config.shake_256_length);
+            crypto_api->close();
+        }
+        int64_t second_end = esp_timer_get_time();
+
+        delete crypto_api;
+
+        if (ret != 0)
+        {
+            printf("%-9s %12s %14s %14s %12s\n", library.name, "-", "-", "-", "-");
+            continue;
+        }
+
+        printf("%-9s %12lld %14lld %14lld %12ld\n",
+               library.name,
+               (long long)(construct_end - construct_start),
+               (long long)(first_end - first_start),
+               (long long)(second_end - second_start),
+               (long)free_before - (long)free_after);
+    }
+
+    return 0;
+}
+
+#if uECC_ENABLE_OP_COUNTERS
+static void print_field_ops_row(const char *curve, const char *operation, const uECC_OpCounters &counters)
+{
+    printf("%-9s %-8s %8lu %8lu %5lu %8lu %8lu %8lu %8lu\n",
+           curve, operation,
+           (unsigned long)counters.mod_mult,
+           (unsigned long)counters.mod_square,
+           (unsigned long)counters.mod_inv,
+           (unsigned long)counters.double_jacobian,
+           (unsigned long)counters.xycz_add,
+           (unsigned long)counters.xycz_addc,
+           (unsigned long)counters.affine_add);
+}
+
+// Counts the field operations of one uECC_make_key(), uECC_sign() and
+// uECC_verify() per curve. The counts do not depend on the machine, so they
+// compare scalar multiplication and inversion changes without timing noise.
+static int run_field_ops()
+{
+    struct NamedCurve
+    {
+        const char *name;
+        uECC_Curve curve;
+    };
+    // Only the curves micro-ecc is built with (CONFIG_UECC_SECP256R1_ONLY)
+    const NamedCurve curves[] = {
+#if uECC_SUPPORTS_secp160r1
+        {"secp160r1", uECC_secp160r1()},
+#endif
+#if uECC_SUPPORTS_secp192r1
+        {"secp192r1", uECC_secp192r1()},
+#endif
+#if uECC_SUPPORTS_secp224r1
+        {"secp224r1", uECC_secp224r1()},
+#endif
+        {"secp256r1", uECC_secp256r1()},
+#if uECC_SUPPORTS_secp256k1
+        {"secp256k1", uECC_secp256k1()},
+#endif
+    };
+
+    printf("%-9s %-8s %8s %8s %5s %8s %8s %8s %8s\n", "curve", "op", "mult", "square", "inv", "double", "add", "addC", "affine");
+    for (const NamedCurve &named : curves)
+    {
+        uint8_t private_key[32];
+        uint8_t public_key[64];
+        uint8_t hash[32];
+        uint8_t signature[64];
+        uECC_OpCounters keygen, sign, verify;
+
+        esp_fill_random(hash, sizeof(hash));
+
+        uECC_reset_op_counters();
+        int ok = uECC_make_key(public_key, private_key, named.curve);
+        uECC_get_op_counters(&keygen);
+
+        uECC_reset_op_counters();
+        ok = ok && uECC_sign(private_key, hash, sizeof(hash), signature, named.curve);
+        uECC_get_op_counters(&sign);
+
+        uECC_reset_op_counters();
+        ok = ok && uECC_verify(public_key, hash, sizeof(hash), signature, named.curve);
+        uECC_get_op_counters(&verify);
+
+        if (!ok)
+        {
+            fprintf(stderr, "%s failed\n", named.name);
+            return 1;
+        }
+
+        print_field_ops_row(named.name, "keygen", keygen);
+        print_field_ops_row(named.name, "sign", sign);
+        print_field_ops_row(named.name, "verify", verify);
+    }
+
+    return 0;
+}
+#endif
+
+int main(int argc, char **argv)
+{
+    BenchConfig config = {
+        .library = Libraries::MBEDTLS_LIB,
+        .algorithm = Algorithms::ECDSA_SECP256R1,
+        .hash = Hashes::MY_SHA_256,
+        .shake_256_length = 64,
+        .message_length = 580,
+        .iterations = 100,
+        .batch_size = 0,
+        .pipeline = false,
+        .async = false,
+        .session = false,
+        .stats = false,
+        .warmup = CRYPTO_API_BENCH_WARMUP,
+        .allocations = false,
+        .stack = false,
+        .matrix = false,
+    };
+    bool all_libraries = true;
+    bool verbose = false;
+    bool footprint = false;
+    bool field_ops = false;
+    int sweep_max_size = 0;
+    int key_cache_keys = 0;
+    const char *output_path = NULL;
+    const char *save_baseline_path = NULL;
+    const char *compare_path = NULL;
+    const char *trace_path = NULL;
+    int threshold_percent = 5;
+    ResultFormat output_format = ResultFormat::RESULT_CSV;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        int parsed = -1;
+
+        if (strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0)
+        {
+            print_usage(argv[0]);
+            return 0;
+        }
+        else if (strcmp(arg, "-v") == 0 || strcmp(arg, "--verbose") == 0)
+        {
+            verbose = true;
+            continue;
+        }
+        else if (strcmp(arg, "-f") == 0 || strcmp(arg, "--footprint") == 0)
+        {
+            footprint = true;
+            continue;
+        }
+        else if (strcmp(arg, "-F") == 0 || strcmp(arg, "--field-ops") == 0)
+        {
+            field_ops = true;
+            continue;
+        }
+        else if (strcmp(arg, "-p") == 0 || strcmp(arg, "--pipeline") == 0)
+        {
+            config.pipeline = true;
+            continue;
+        }
+        else if (strcmp(arg, "-A") == 0 || strcmp(arg, "--async") == 0)
+        {
+            config.async = true;
+            continue;
+        }
+        else if (strcmp(arg, "-S") == 0 || strcmp(arg, "--session") == 0)
+        {
+            config.session = true;
+            continue;
+        }
+        else if (strcmp(arg, "-t") == 0 || strcmp(arg, "--stats") == 0)
+        {
+            config.stats = true;
+            continue;
+        }
+        else if (strcmp(arg, "-M") == 0 || strcmp(arg, "--allocations") == 0)
+        {
+            config.allocations = true;
+            continue;
+        }
+        else if (strcmp(arg, "-k") == 0 || strcmp(arg, "--stack") == 0)
+        {
+            config.stack = true;
+            continue;
+        }
+        else if (strcmp(arg, "-X") == 0 || strcmp(arg, "--matrix") == 0)
+        {
+            config.matrix = true;
+            continue;
+        }
+        else if (value == NULL)
+        {
+            fprintf(stderr, "Missing value for %s\n", arg);
+            return 2;
+        }
+        else if (strcmp(arg, "-l") == 0 || strcmp(arg, "--library") == 0)
+        {
+            parsed = parse_name(library_names, value);
+            config.library = (Libraries)parsed;
+            all_libraries = false;
+        }
+        else if (strcmp(arg, "-a") == 0 || strcmp(arg, "--algorithm") == 0)
+        {
+            parsed = parse_name(algorithm_names, value);
+            config.algorithm = (Algorithms)parsed;
+        }
+        else if (strcmp(arg, "-H") == 0 || strcmp(arg, "--hash") == 0)
+        {
+            parsed = parse_name(hash_names, value);
+            config.hash = (Hashes)parsed;
+        }
+        else if (strcmp(arg, "-s") == 0 || strcmp(arg, "--shake-length") == 0)
+        {
+            parsed = parse_count(value);
+            config.shake_256_length = parsed;
+        }
+        else if (strcmp(arg, "-m") == 0 || strcmp(arg, "--message-size") == 0)
+        {
+            parsed = parse_count(value);
+            config.message_length = parsed;
+        }
+        else if (strcmp(arg, "-b") == 0 || strcmp(arg, "--batch") == 0)
+        {
+            parsed = parse_count(value);
+            config.batch_size = parsed;
+        }
+        else if (strcmp(arg, "-n") == 0 || strcmp(arg, "--iterations") == 0)
+        {
+            parsed = parse_count(value);
+            config.iterations = parsed;
+        }
+        else if (strcmp(arg, "-w") == 0 || strcmp(arg, "--warmup") == 0)
+        {
+            parsed = parse_count(value);
+            config.warmup = parsed;
+        }
+        else if (strcmp(arg, "-K") == 0 || strcmp(arg, "--key-cache") == 0)
+        {
+            parsed = parse_count(value);
+            key_cache_keys = parsed;
+        }
+        else if (strcmp(arg, "-Z") == 0 || strcmp(arg, "--sweep") == 0)
+        {
+            parsed = parse_count(value);
+            sweep_max_size = parsed;
+        }
+        else if (strcmp(arg, "-o") == 0 || strcmp(arg, "--output") == 0)
+        {
+            output_path = value;
+            i++;
+            continue;
+        }
+        else if (strcmp(arg, "--format") == 0)
+        {
+            parsed = parse_name(format_names, value);
+            output_format = (ResultFormat)parsed;
+        }
+        else if (strcmp(arg, "--save-baseline") == 0)
+        {
+            save_baseline_path = value;
+            i++;
+            continue;
+        }
+        else if (strcmp(arg, "--compare") == 0)
+        {
+            compare_path = value;
+            i++;
+            continue;
+        }
+        else if (strcmp(arg, "--trace") == 0)
+        {
+            trace_path = value;
+            i++;
+            continue;
+        }
+        else if (strcmp(arg, "--threshold") == 0)
+        {
+            parsed = parse_count(value);
+            threshold_percent = parsed;
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", arg);
+            print_usage(argv[0]);
+            return 2;
+        }
+
+        if (parsed < 0)
+        {
+            fprintf(stderr, "Invalid value for %s: %s\n", arg, value);
+            return 2;
+        }
+        i++;
+    }
+
+    if (!verbose)
+    {
+        esp_log_level_set("*", ESP_LOG_WARN);
+    }
+
+    if (footprint)
+    {
+        return run_footprint(config);
+    }
+
+    if (sweep_max_size > 0)
+    {
+        return run_sweep(config, sweep_max_size);
+    }
+
+    if (key_cache_keys > 0)
+    {
+        return run_key_cache_bench(config, key_cache_keys);
+    }
+
+    if (field_ops)
+    {
+#if uECC_ENABLE_OP_COUNTERS
+        return run_field_ops();
+#else
+        fprintf(stderr, "--field-ops needs CONFIG_UECC_ENABLE_OP_COUNTERS\n");
+        return 2;
+#endif
+    }
+
+    // Baselines are built from BenchmarkRunner statistics
+    if ((save_baseline_path != NULL || compare_path != NULL) && !config.matrix)
+    {
+        config.stats = true;
+        config.stack = false;
+        config.allocations = false;
+    }
+
+    int (*bench)(CryptoAPI &, const BenchConfig &) = run_bench;
+    if (config.matrix)
+    {
+        // Prints its own table once every cell is done
+        bench = run_matrix_bench;
+        all_libraries = false;
+    }
+    else if (config.stack)
+    {
+        bench = run_stack_bench;
+        printf("%-9s %-10s %-9s %12s %12s %12s\n",
+               "library", "algorithm", "hash", "keygen B", "sign B", "verify B");
+    }
+    else if (config.allocations)
+    {
+        if (!CRYPTO_API_ALLOC_TRACE)
+        {
+            fprintf(stderr, "--allocations needs CONFIG_CRYPTO_API_ALLOC_TRACE\n");
+            return 2;
+        }
+        bench = run_allocation_bench;
+        printf("%-9s %-10s %-9s %-8s %8s %8s %12s %12s\n",
+               "library", "algorithm", "hash", "op", "allocs", "frees", "peak bytes", "not freed");
+    }
+    else if (config.stats)
+    {
+        bench = run_stats_bench;
+        printf("%-9s %-10s %-9s %-6s %5s %4s %10s %10s %10s %10s %10s %8s %9s\n",
+               "library", "algorithm", "hash", "op", "n", "rej", "min ms", "median ms", "p95 ms", "p99 ms", "mean ms", "+/- ms", "stddev ms");
+    }
+    else if (config.session)
+    {
+        bench = run_session_bench;
+        printf("%-9s %-10s %-9s %12s %12s %12s %9s\n",
+               "library", "algorithm", "hash", "cold ms/op", "open ms", "warm ms/op", "speedup");
+    }
+    else if (config.async)
+    {
+        bench = run_async_bench;
+        printf("%-9s %-10s %-9s %14s %14s %12s %12s\n",
+               "library", "algorithm", "hash", "max submit us", "mean submit us", "sign ops/s", "verify ops/s");
+    }
+    else if (config.pipeline)
+    {
+        bench = run_pipeline_bench;
+        printf("%-9s %-10s %-9s %8s %14s %14s %9s\n",
+               "library", "algorithm", "hash", "msg size", "serial msg/s", "pipe msg/s", "speedup");
+    }
+    else if (config.batch_size > 0)
+    {
+        bench = run_batch_bench;
+        printf("%-9s %-10s %-9s %6s %14s %14s %9s\n",
+               "library", "algorithm", "hash", "batch", "single msg/s", "batch msg/s", "speedup");
+    }
+    else
+    {
+        printf("%-9s %-10s %-9s %10s %12s %12s %12s %12s\n",
+               "library", "algorithm", "hash", "keygen ms", "sign ops/s", "verify ops/s", "sign ms", "verify ms");
+    }
+
+    CryptoAPI crypto_api;
+    int status = 0;
+
+    if (all_libraries)
+    {
+        for (const NamedValue &library : library_names)
+        {
+            BenchConfig library_config = config;
+            library_config.library = (Libraries)library.value;
+
+            int ret = bench(crypto_api, library_config);
+            if (ret != 0)
+            {
+                fprintf(stderr, "%s failed with status %d\n", library.name, ret);
+                status = 1;
+            }
+        }
+    }
+    else
+    {
+        int ret = bench(crypto_api, config);
+        if (ret != 0)
+        {
+            fprintf(stderr, "%s failed with status %d\n", config.matrix ? "matrix" : to_name(library_names, config.library), ret);
+            status = 1;
+        }
+    }
+
+    crypto_api.flush_log();
+
+    if (save_baseline_path != NULL && current_run.save(save_baseline_path) != 0)
+    {
+        fprintf(stderr, "Could not write the baseline to %s\n", save_baseline_path);
+        status = 1;
+    }
+
+    if (compare_path != NULL)
+    {
+        BenchmarkBaseline baseline;
+        if (baseline.load(compare_path) != 0)
+        {
+            fprintf(stderr, "Could not read the baseline %s\n", compare_path);
+            return 2;
+        }
+
+        printf("\n");
+        int regressions = baseline.compare(current_run, threshold_percent, stdout);
+        if (regressions > 0)
+        {
+            fprintf(stderr, "%d operations are slower than in %s\n", regressions, compare_path);
+            status = 1;
+        }
+    }
+
+    if (output_path != NULL)
+    {
+        if (crypto_api.export_results(strcmp(output_path, "-") == 0 ? NULL : output_path, output_format) != 0)
+        {
+            fprintf(stderr, "Could not write results to %s\n", output_path);
+            status = 1;
+        }
+    }
+
+    if (trace_path != NULL)
+    {
+        if (crypto_api.export_spans(strcmp(trace_path, "-") == 0 ? NULL : trace_path) != 0)
+        {
+            fprintf(stderr, "Could not write the trace to %s\n", trace_path);
+            status = 1;
+        }
+    }
+
+    return status;
+}
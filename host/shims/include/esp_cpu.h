@@ -0,0 +1,23 @@
+/*
+ * Host shim for esp_cpu.h
+ *
+ * The Xtensa CCOUNT register is 32 bits wide and wraps every ~27 s at 160 MHz.
+ * The shim keeps that width by truncating the host's time-stamp counter, so
+ * code that subtracts two readings behaves the same on both targets.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint32_t esp_cpu_cycle_count_t;
+
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void);
+int esp_cpu_get_core_id(void);
+
+#ifdef __cplusplus
+}
+#endif
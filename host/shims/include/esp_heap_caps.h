@@ -0,0 +1,40 @@
+/*
+ * Host shim for esp_heap_caps.h
+ *
+ * The host build links with -Wl,--wrap for malloc, calloc, realloc and free,
+ * so every allocation made by CryptoAPI, mbedTLS, wolfSSL and micro-ecc is
+ * accounted against an emulated heap of CONFIG_HOST_HEAP_SIZE bytes. The free
+ * and minimum-free figures below are derived from that accounting.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MALLOC_CAP_EXEC (1 << 0)
+#define MALLOC_CAP_32BIT (1 << 1)
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_DMA (1 << 3)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_DEFAULT (1 << 12)
+
+size_t heap_caps_get_free_size(uint32_t caps);
+size_t heap_caps_get_minimum_free_size(uint32_t caps);
+size_t heap_caps_get_total_size(uint32_t caps);
+
+esp_err_t heap_caps_monitor_local_minimum_free_size_start(void);
+esp_err_t heap_caps_monitor_local_minimum_free_size_stop(void);
+
+/* As with CONFIG_HEAP_USE_HOOKS on the target: called after every successful
+   allocation and before every free, if the application defines them. */
+__attribute__((weak)) void esp_heap_trace_alloc_hook(void *ptr, size_t size, uint32_t caps);
+__attribute__((weak)) void esp_heap_trace_free_hook(void *ptr);
+
+#ifdef __cplusplus
+}
+#endif
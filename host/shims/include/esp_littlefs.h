@@ -0,0 +1,42 @@
+/*
+ * Host shim for esp_littlefs.h
+ *
+ * Mounts littlefs on a lfs_rambd RAM block device, or on a lfs_filebd image
+ * file when the CRYPTO_API_LITTLEFS_IMAGE environment variable names one.
+ * fopen() calls under base_path are routed into the mounted filesystem, like
+ * the ESP-IDF VFS layer does on the device.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct esp_partition_t esp_partition_t;
+
+typedef struct
+{
+  const char *base_path;
+  const char *partition_label;
+  const esp_partition_t *partition;
+
+  uint8_t format_if_mount_failed : 1;
+  uint8_t read_only : 1;
+  uint8_t dont_mount : 1;
+  uint8_t grow_on_mount : 1;
+} esp_vfs_littlefs_conf_t;
+
+esp_err_t esp_vfs_littlefs_register(const esp_vfs_littlefs_conf_t *conf);
+esp_err_t esp_vfs_littlefs_unregister(const char *partition_label);
+bool esp_littlefs_mounted(const char *partition_label);
+esp_err_t esp_littlefs_format(const char *partition_label);
+esp_err_t esp_littlefs_info(const char *partition_label, size_t *total_bytes, size_t *used_bytes);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,20 @@
+/*
+ * Host shim for esp_system.h
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_random.h"
+#include "esp_heap_caps.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t esp_get_free_heap_size(void);
+uint32_t esp_get_minimum_free_heap_size(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,54 @@
+/*
+ * Host shim for freertos/FreeRTOS.h
+ *
+ * Only the types and macros the CryptoAPI component uses. Like the real port
+ * headers, it also pulls in stdlib.h, esp_cpu.h and esp_heap_caps.h.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "sdkconfig.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t StackType_t;
+
+#define configTICK_RATE_HZ CONFIG_FREERTOS_HZ
+#define configSTACK_DEPTH_TYPE uint32_t
+#define configMAX_TASK_NAME_LEN 16
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE ((BaseType_t)1)
+#define pdFAIL pdFALSE
+#define pdPASS pdTRUE
+
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS ((TickType_t)1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(xTimeInMs) ((TickType_t)(((TickType_t)(xTimeInMs) * (TickType_t)configTICK_RATE_HZ) / (TickType_t)1000U))
+
+/* Critical sections are a spinlock; there are no interrupts to mask. */
+typedef struct
+{
+  volatile int locked;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0}
+
+void vPortEnterCritical(portMUX_TYPE *mux);
+void vPortExitCritical(portMUX_TYPE *mux);
+
+#define portENTER_CRITICAL(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL(mux) vPortExitCritical(mux)
+
+#ifdef __cplusplus
+}
+#endif
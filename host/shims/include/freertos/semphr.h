@@ -0,0 +1,17 @@
+/*
+ * Host shim for freertos/semphr.h
+ *
+ * As in FreeRTOS, a binary semaphore is a queue of length one holding
+ * zero-size items.
+ */
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+typedef QueueHandle_t SemaphoreHandle_t;
+
+#define xSemaphoreCreateBinary() xQueueCreate(1, 0)
+#define vSemaphoreDelete(xSemaphore) vQueueDelete(xSemaphore)
+#define xSemaphoreGive(xSemaphore) xQueueSend((xSemaphore), NULL, 0)
+#define xSemaphoreTake(xSemaphore, xBlockTime) xQueueReceive((xSemaphore), NULL, (xBlockTime))
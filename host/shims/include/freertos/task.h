@@ -0,0 +1,44 @@
+/*
+ * Host shim for freertos/task.h
+ *
+ * Tasks are pthreads (see src/freertos.cpp). Priorities and core affinity
+ * are accepted and ignored; the Linux scheduler places the threads. Each task
+ * runs on its own painted stack with a guard page below it, so that
+ * uxTaskGetStackHighWaterMark() can report how much of usStackDepth it used.
+ */
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*TaskFunction_t)(void *);
+typedef struct tskTaskControlBlock *TaskHandle_t;
+
+#define tskNO_AFFINITY ((BaseType_t)0x7FFFFFFF)
+
+void vTaskDelay(const TickType_t xTicksToDelay);
+TickType_t xTaskGetTickCount(void);
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pxTaskCode, const char *pcName, const uint32_t usStackDepth,
+                                   void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask,
+                                   const BaseType_t xCoreID);
+// Only vTaskDelete(NULL) at the end of a task function is supported; on the
+// host it returns, and the thread ends when the task function does. Its stack
+// is freed by the next xTaskCreatePinnedToCore().
+void vTaskDelete(TaskHandle_t xTaskToDelete);
+UBaseType_t uxTaskPriorityGet(TaskHandle_t xTask);
+// In bytes, as in ESP-IDF. Only xTask == NULL (the calling task) is supported;
+// threads not created through xTaskCreatePinnedToCore() report 0.
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t xTask);
+// NULL on threads not created through xTaskCreatePinnedToCore(), such as the
+// one running app_main() on the host
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+// pcTaskGetName(NULL) on a thread that is not a task returns "main"
+char *pcTaskGetName(TaskHandle_t xTaskToQuery);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,62 @@
+/*
+ * Host build configuration.
+ *
+ * Stand-in for the sdkconfig.h that ESP-IDF generates from menuconfig, so the
+ * CryptoAPI sources and the shims can test the same CONFIG_ symbols on Linux.
+ */
+#pragma once
+
+#define CONFIG_IDF_TARGET "linux"
+#define CONFIG_IDF_TARGET_LINUX 1
+
+#define CONFIG_FREERTOS_HZ 1000
+#define CONFIG_ESP_MAIN_TASK_STACK_SIZE 3584
+
+/* Size of the emulated heap reported by the heap_caps shims, roughly what an
+   ESP32 has free after boot. */
+#define CONFIG_HOST_HEAP_SIZE (300 * 1024)
+
+/* The heap shim calls esp_heap_trace_alloc_hook()/esp_heap_trace_free_hook(). */
+#define CONFIG_HEAP_USE_HOOKS 1
+
+/* Geometry of the emulated "littlefs" partition (see partitions.csv). */
+#define CONFIG_HOST_LITTLEFS_BLOCK_SIZE 4096
+#define CONFIG_HOST_LITTLEFS_BLOCK_COUNT 256
+
+/* micro-ecc build options (components/micro-ecc/Kconfig). */
+#define CONFIG_UECC_SECP256R1_ONLY 1
+#define CONFIG_UECC_SECP256R1_COMB_TEETH 5
+#define CONFIG_UECC_SECP256R1_COMB_TABLES 4
+#define CONFIG_UECC_SECP256R1_WNAF_G_TABLE 1
+#define CONFIG_UECC_SECP256R1_WNAF_G_WINDOW 7
+#define CONFIG_UECC_VERIFY_WNAF_WINDOW 4
+#define CONFIG_UECC_VERIFY_PRECOMP_WINDOW 5
+#define CONFIG_UECC_ENABLE_OP_COUNTERS 1
+
+/* CryptoAPI backends (components/CryptoAPI/Kconfig). */
+#define CONFIG_CRYPTO_API_BACKEND_MBEDTLS 1
+#define CONFIG_CRYPTO_API_BACKEND_WOLFSSL 1
+#define CONFIG_CRYPTO_API_BACKEND_MICROECC 1
+#define CONFIG_CRYPTO_API_INSTRUMENTATION 1
+#define CONFIG_CRYPTO_API_DEFERRED_LOG 1
+#define CONFIG_CRYPTO_API_TRACE_LOG_EVENTS 128
+#define CONFIG_CRYPTO_API_TRACE_DRAIN_PRIORITY 1
+#define CONFIG_CRYPTO_API_SPAN_TRACE 1
+#define CONFIG_CRYPTO_API_SPAN_TRACE_EVENTS 512
+#define CONFIG_CRYPTO_API_KEY_CACHE_BYTES 32768
+#define CONFIG_CRYPTO_API_RESULT_LOG_SIZE 256
+#define CONFIG_CRYPTO_API_BENCH_WARMUP 5
+#define CONFIG_CRYPTO_API_BENCH_ITERATIONS 50
+#define CONFIG_CRYPTO_API_BENCH_KEYGEN_ITERATIONS 3
+#define CONFIG_CRYPTO_API_BENCH_SWEEP_MAX_SIZE 4194304
+#define CONFIG_CRYPTO_API_BENCH_SWEEP_ITERATIONS 5
+#define CONFIG_CRYPTO_API_ALLOC_TRACE 1
+#define CONFIG_CRYPTO_API_ALLOC_TRACE_SLOTS 256
+#define CONFIG_CRYPTO_API_STACK_PROFILE_SIZE 16384
+#define CONFIG_CRYPTO_API_PIPELINE_DEPTH 4
+#define CONFIG_CRYPTO_API_PIPELINE_HASH_CORE 1
+#define CONFIG_CRYPTO_API_PIPELINE_HASH_STACK_SIZE 4096
+#define CONFIG_CRYPTO_API_JOB_QUEUE_LENGTH 8
+#define CONFIG_CRYPTO_API_JOB_WORKER_CORE 1
+#define CONFIG_CRYPTO_API_JOB_WORKER_PRIORITY 5
+#define CONFIG_CRYPTO_API_JOB_WORKER_STACK_SIZE 8192
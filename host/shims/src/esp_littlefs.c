@@ -0,0 +1,393 @@
+/*
+ * littlefs mount for the host build.
+ *
+ * The "partition" is backed by lfs_rambd, or by lfs_filebd when the
+ * CRYPTO_API_LITTLEFS_IMAGE environment variable points at an image file. The
+ * block device is created once per process and outlives unregister, so files
+ * survive a close()/init() cycle the same way they survive on flash.
+ *
+ * The executable is linked with -Wl,--wrap=fopen: paths below a registered
+ * base_path are opened inside littlefs through fopencookie(), everything else
+ * goes to the real fopen(). This mirrors what the ESP-IDF VFS does on target,
+ * so CryptoApiCommons keeps using plain stdio.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lfs.h"
+#include "bd/lfs_rambd.h"
+#include "bd/lfs_filebd.h"
+
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_littlefs.h"
+
+#define MAX_PARTITIONS 2
+#define MAX_LABEL_LEN 17
+#define MAX_PATH_LEN 16
+
+FILE *__real_fopen(const char *path, const char *mode);
+void *__real_malloc(size_t size);
+
+static const char *TAG = "esp_littlefs";
+
+typedef struct
+{
+  char label[MAX_LABEL_LEN];
+  char base_path[MAX_PATH_LEN];
+  bool mounted;
+  bool created;
+  bool file_backed;
+  lfs_t lfs;
+  struct lfs_config cfg;
+  lfs_rambd_t rambd;
+  lfs_filebd_t filebd;
+  struct lfs_rambd_config rambd_cfg;
+  struct lfs_filebd_config filebd_cfg;
+  uint8_t *flash; /* rambd storage, not counted against the emulated heap */
+} littlefs_partition_t;
+
+typedef struct
+{
+  littlefs_partition_t *partition;
+  lfs_file_t file;
+} littlefs_cookie_t;
+
+static littlefs_partition_t partitions[MAX_PARTITIONS];
+static pthread_mutex_t fs_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static littlefs_partition_t *find_partition(const char *label)
+{
+  for (int i = 0; i < MAX_PARTITIONS; i++)
+  {
+    if (partitions[i].label[0] != '\0' && strcmp(partitions[i].label, label) == 0)
+    {
+      return &partitions[i];
+    }
+  }
+  return NULL;
+}
+
+static littlefs_partition_t *claim_partition(const char *label)
+{
+  littlefs_partition_t *partition = find_partition(label);
+  if (partition != NULL)
+  {
+    return partition;
+  }
+
+  for (int i = 0; i < MAX_PARTITIONS; i++)
+  {
+    if (partitions[i].label[0] == '\0')
+    {
+      strncpy(partitions[i].label, label, MAX_LABEL_LEN - 1);
+      return &partitions[i];
+    }
+  }
+  return NULL;
+}
+
+static void configure_block_device(littlefs_partition_t *partition, const char *image_path)
+{
+  struct lfs_config *cfg = &partition->cfg;
+  memset(cfg, 0, sizeof(*cfg));
+
+  cfg->read_size = 128;
+  cfg->prog_size = 128;
+  cfg->block_size = CONFIG_HOST_LITTLEFS_BLOCK_SIZE;
+  cfg->block_count = CONFIG_HOST_LITTLEFS_BLOCK_COUNT;
+  cfg->block_cycles = 512;
+  cfg->cache_size = 512;
+  cfg->lookahead_size = 128;
+
+  if (image_path != NULL)
+  {
+    partition->file_backed = true;
+    partition->filebd_cfg.read_size = cfg->read_size;
+    partition->filebd_cfg.prog_size = cfg->prog_size;
+    partition->filebd_cfg.erase_size = cfg->block_size;
+    partition->filebd_cfg.erase_count = cfg->block_count;
+
+    cfg->context = &partition->filebd;
+    cfg->read = lfs_filebd_read;
+    cfg->prog = lfs_filebd_prog;
+    cfg->erase = lfs_filebd_erase;
+    cfg->sync = lfs_filebd_sync;
+    return;
+  }
+
+  partition->flash = (uint8_t *)__real_malloc((size_t)cfg->block_size * cfg->block_count);
+
+  partition->file_backed = false;
+  partition->rambd_cfg.read_size = cfg->read_size;
+  partition->rambd_cfg.prog_size = cfg->prog_size;
+  partition->rambd_cfg.erase_size = cfg->block_size;
+  partition->rambd_cfg.erase_count = cfg->block_count;
+  partition->rambd_cfg.buffer = partition->flash;
+
+  cfg->context = &partition->rambd;
+  cfg->read = lfs_rambd_read;
+  cfg->prog = lfs_rambd_prog;
+  cfg->erase = lfs_rambd_erase;
+  cfg->sync = lfs_rambd_sync;
+}
+
+esp_err_t esp_vfs_littlefs_register(const esp_vfs_littlefs_conf_t *conf)
+{
+  if (conf == NULL || conf->base_path == NULL || conf->partition_label == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  pthread_mutex_lock(&fs_lock);
+
+  littlefs_partition_t *partition = claim_partition(conf->partition_label);
+  if (partition == NULL)
+  {
+    pthread_mutex_unlock(&fs_lock);
+    return ESP_ERR_NO_MEM;
+  }
+
+  if (partition->mounted)
+  {
+    pthread_mutex_unlock(&fs_lock);
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  strncpy(partition->base_path, conf->base_path, MAX_PATH_LEN - 1);
+
+  int err = 0;
+  if (!partition->created)
+  {
+    const char *image_path = getenv("CRYPTO_API_LITTLEFS_IMAGE");
+    configure_block_device(partition, image_path);
+
+    err = partition->file_backed
+              ? lfs_filebd_create(&partition->cfg, image_path, &partition->filebd_cfg)
+              : lfs_rambd_create(&partition->cfg, &partition->rambd_cfg);
+    if (err != 0)
+    {
+      pthread_mutex_unlock(&fs_lock);
+      return ESP_FAIL;
+    }
+    partition->created = true;
+  }
+
+  if (conf->dont_mount)
+  {
+    pthread_mutex_unlock(&fs_lock);
+    return ESP_OK;
+  }
+
+  err = lfs_mount(&partition->lfs, &partition->cfg);
+  if (err != 0 && conf->format_if_mount_failed)
+  {
+    ESP_LOGW(TAG, "mount failed, formatting partition \"%s\"", partition->label);
+    err = lfs_format(&partition->lfs, &partition->cfg);
+    if (err == 0)
+    {
+      err = lfs_mount(&partition->lfs, &partition->cfg);
+    }
+  }
+
+  partition->mounted = err == 0;
+  pthread_mutex_unlock(&fs_lock);
+
+  return err == 0 ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_vfs_littlefs_unregister(const char *partition_label)
+{
+  pthread_mutex_lock(&fs_lock);
+
+  littlefs_partition_t *partition = find_partition(partition_label);
+  if (partition == NULL || !partition->mounted)
+  {
+    pthread_mutex_unlock(&fs_lock);
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  lfs_unmount(&partition->lfs);
+  partition->mounted = false;
+
+  pthread_mutex_unlock(&fs_lock);
+  return ESP_OK;
+}
+
+bool esp_littlefs_mounted(const char *partition_label)
+{
+  littlefs_partition_t *partition = find_partition(partition_label);
+  return partition != NULL && partition->mounted;
+}
+
+esp_err_t esp_littlefs_format(const char *partition_label)
+{
+  pthread_mutex_lock(&fs_lock);
+
+  littlefs_partition_t *partition = find_partition(partition_label);
+  if (partition == NULL || !partition->mounted)
+  {
+    pthread_mutex_unlock(&fs_lock);
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  lfs_unmount(&partition->lfs);
+  int err = lfs_format(&partition->lfs, &partition->cfg);
+  if (err == 0)
+  {
+    err = lfs_mount(&partition->lfs, &partition->cfg);
+  }
+  partition->mounted = err == 0;
+
+  pthread_mutex_unlock(&fs_lock);
+  return err == 0 ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_littlefs_info(const char *partition_label, size_t *total_bytes, size_t *used_bytes)
+{
+  pthread_mutex_lock(&fs_lock);
+
+  littlefs_partition_t *partition = find_partition(partition_label);
+  if (partition == NULL || !partition->mounted)
+  {
+    pthread_mutex_unlock(&fs_lock);
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  lfs_ssize_t used_blocks = lfs_fs_size(&partition->lfs);
+  pthread_mutex_unlock(&fs_lock);
+
+  if (used_blocks < 0)
+  {
+    return ESP_FAIL;
+  }
+
+  *total_bytes = (size_t)partition->cfg.block_size * partition->cfg.block_count;
+  *used_bytes = (size_t)partition->cfg.block_size * (size_t)used_blocks;
+  return ESP_OK;
+}
+
+static ssize_t cookie_read(void *cookie, char *buf, size_t size)
+{
+  littlefs_cookie_t *c = (littlefs_cookie_t *)cookie;
+  pthread_mutex_lock(&fs_lock);
+  lfs_ssize_t ret = lfs_file_read(&c->partition->lfs, &c->file, buf, (lfs_size_t)size);
+  pthread_mutex_unlock(&fs_lock);
+  return ret < 0 ? -1 : ret;
+}
+
+static ssize_t cookie_write(void *cookie, const char *buf, size_t size)
+{
+  littlefs_cookie_t *c = (littlefs_cookie_t *)cookie;
+  pthread_mutex_lock(&fs_lock);
+  lfs_ssize_t ret = lfs_file_write(&c->partition->lfs, &c->file, buf, (lfs_size_t)size);
+  pthread_mutex_unlock(&fs_lock);
+  return ret < 0 ? 0 : ret;
+}
+
+static int cookie_seek(void *cookie, off64_t *offset, int whence)
+{
+  littlefs_cookie_t *c = (littlefs_cookie_t *)cookie;
+  int lfs_whence = whence == SEEK_SET ? LFS_SEEK_SET : whence == SEEK_CUR ? LFS_SEEK_CUR : LFS_SEEK_END;
+
+  pthread_mutex_lock(&fs_lock);
+  lfs_soff_t ret = lfs_file_seek(&c->partition->lfs, &c->file, (lfs_soff_t)*offset, lfs_whence);
+  pthread_mutex_unlock(&fs_lock);
+
+  if (ret < 0)
+  {
+    return -1;
+  }
+  *offset = ret;
+  return 0;
+}
+
+static int cookie_close(void *cookie)
+{
+  littlefs_cookie_t *c = (littlefs_cookie_t *)cookie;
+  pthread_mutex_lock(&fs_lock);
+  int ret = lfs_file_close(&c->partition->lfs, &c->file);
+  pthread_mutex_unlock(&fs_lock);
+  free(c);
+  return ret < 0 ? -1 : 0;
+}
+
+static int lfs_flags_from_mode(const char *mode)
+{
+  int flags = strchr(mode, '+') != NULL ? LFS_O_RDWR : 0;
+
+  switch (mode[0])
+  {
+  case 'r':
+    return flags != 0 ? flags : LFS_O_RDONLY;
+  case 'w':
+    return (flags != 0 ? flags : LFS_O_WRONLY) | LFS_O_CREAT | LFS_O_TRUNC;
+  case 'a':
+    return (flags != 0 ? flags : LFS_O_WRONLY) | LFS_O_CREAT | LFS_O_APPEND;
+  default:
+    return -1;
+  }
+}
+
+static littlefs_partition_t *partition_for_path(const char *path, const char **relative_path)
+{
+  for (int i = 0; i < MAX_PARTITIONS; i++)
+  {
+    littlefs_partition_t *partition = &partitions[i];
+    size_t base_len = strlen(partition->base_path);
+    if (partition->mounted && base_len > 0 && strncmp(path, partition->base_path, base_len) == 0 && path[base_len] == '/')
+    {
+      *relative_path = path + base_len;
+      return partition;
+    }
+  }
+  return NULL;
+}
+
+FILE *__wrap_fopen(const char *path, const char *mode)
+{
+  const char *relative_path = NULL;
+  littlefs_partition_t *partition = partition_for_path(path, &relative_path);
+  if (partition == NULL)
+  {
+    return __real_fopen(path, mode);
+  }
+
+  int flags = lfs_flags_from_mode(mode);
+  if (flags < 0)
+  {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  littlefs_cookie_t *cookie = (littlefs_cookie_t *)calloc(1, sizeof(littlefs_cookie_t));
+  if (cookie == NULL)
+  {
+    errno = ENOMEM;
+    return NULL;
+  }
+  cookie->partition = partition;
+
+  pthread_mutex_lock(&fs_lock);
+  int err = lfs_file_open(&partition->lfs, &cookie->file, relative_path, flags);
+  pthread_mutex_unlock(&fs_lock);
+
+  if (err < 0)
+  {
+    free(cookie);
+    errno = err == LFS_ERR_NOENT ? ENOENT : EIO;
+    return NULL;
+  }
+
+  cookie_io_functions_t io = {
+      .read = cookie_read,
+      .write = cookie_write,
+      .seek = cookie_seek,
+      .close = cookie_close};
+
+  return fopencookie(cookie, mode, io);
+}
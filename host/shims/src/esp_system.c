@@ -0,0 +1,178 @@
+/*
+ * Host implementations of the small ESP-IDF system APIs used by CryptoAPI:
+ * error names, logging, esp_timer, the CPU cycle counter and esp_random.
+ */
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/random.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_random.h"
+#include "freertos/task.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+static esp_log_level_t log_level = ESP_LOG_INFO;
+
+static int64_t monotonic_us(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int64_t boot_time_us;
+
+__attribute__((constructor)) static void shim_boot(void)
+{
+  boot_time_us = monotonic_us();
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+  switch (code)
+  {
+  case ESP_OK:
+    return "ESP_OK";
+  case ESP_FAIL:
+    return "ESP_FAIL";
+  case ESP_ERR_NO_MEM:
+    return "ESP_ERR_NO_MEM";
+  case ESP_ERR_INVALID_ARG:
+    return "ESP_ERR_INVALID_ARG";
+  case ESP_ERR_INVALID_STATE:
+    return "ESP_ERR_INVALID_STATE";
+  case ESP_ERR_INVALID_SIZE:
+    return "ESP_ERR_INVALID_SIZE";
+  case ESP_ERR_NOT_FOUND:
+    return "ESP_ERR_NOT_FOUND";
+  case ESP_ERR_NOT_SUPPORTED:
+    return "ESP_ERR_NOT_SUPPORTED";
+  case ESP_ERR_TIMEOUT:
+    return "ESP_ERR_TIMEOUT";
+  default:
+    return "UNKNOWN ERROR";
+  }
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+  if (strcmp(tag, "*") == 0)
+  {
+    log_level = level;
+  }
+}
+
+esp_log_level_t esp_log_level_get(const char *tag)
+{
+  (void)tag;
+  return log_level;
+}
+
+uint32_t esp_log_timestamp(void)
+{
+  return (uint32_t)((monotonic_us() - boot_time_us) / 1000);
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+  (void)level;
+  (void)tag;
+
+  va_list args;
+  va_start(args, format);
+  vprintf(format, args);
+  va_end(args);
+}
+
+void esp_log_buffer_hex_internal(const char *tag, const void *buffer, uint16_t buff_len, esp_log_level_t level)
+{
+  if (esp_log_level_get(tag) < level)
+  {
+    return;
+  }
+
+  const uint8_t *bytes = (const uint8_t *)buffer;
+  char line[16 * 3 + 1];
+
+  for (uint16_t offset = 0; offset < buff_len; offset += 16)
+  {
+    int written = 0;
+    for (uint16_t i = offset; i < buff_len && i < offset + 16; i++)
+    {
+      written += snprintf(line + written, sizeof(line) - written, "%02x ", bytes[i]);
+    }
+    printf("I (%" PRIu32 ") %s: %s\n", esp_log_timestamp(), tag, line);
+  }
+}
+
+int64_t esp_timer_get_time(void)
+{
+  return monotonic_us() - boot_time_us;
+}
+
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return (esp_cpu_cycle_count_t)__rdtsc();
+#elif defined(__aarch64__)
+  uint64_t ticks;
+  __asm__ volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+  return (esp_cpu_cycle_count_t)ticks;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (esp_cpu_cycle_count_t)((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+#endif
+}
+
+int esp_cpu_get_core_id(void)
+{
+  int cpu = sched_getcpu();
+  return cpu < 0 ? 0 : cpu;
+}
+
+void esp_fill_random(void *buf, size_t len)
+{
+  uint8_t *dest = (uint8_t *)buf;
+  while (len > 0)
+  {
+    ssize_t ret = getrandom(dest, len, 0);
+    if (ret <= 0)
+    {
+      continue;
+    }
+    dest += ret;
+    len -= (size_t)ret;
+  }
+}
+
+uint32_t esp_random(void)
+{
+  uint32_t value;
+  esp_fill_random(&value, sizeof(value));
+  return value;
+}
+
+void vTaskDelay(const TickType_t xTicksToDelay)
+{
+  struct timespec ts;
+  uint64_t ms = (uint64_t)xTicksToDelay * portTICK_PERIOD_MS;
+  ts.tv_sec = ms / 1000;
+  ts.tv_nsec = (ms % 1000) * 1000000;
+  nanosleep(&ts, NULL);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+  return (TickType_t)(esp_timer_get_time() / 1000 / portTICK_PERIOD_MS);
+}
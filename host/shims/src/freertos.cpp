@@ -0,0 +1,270 @@
+/*
+ * Host implementations of the FreeRTOS task and queue calls used by
+ * CryptoAPI. A task is a pthread running the task function; a queue is a ring
+ * of fixed-size items guarded by a mutex. Semaphores are queues of zero-size
+ * items, as in FreeRTOS itself. Critical sections are a spinlock.
+ *
+ * Each task gets its own mmap()ed stack with a PROT_NONE guard page below
+ * it, painted before the thread starts, like FreeRTOS fills a new task stack.
+ * The stack is usStackDepth bytes plus room for the thread descriptor and TLS
+ * that glibc keeps at its top, so the high-water mark counts the untouched
+ * bytes of the usStackDepth below the task's entry frame: 0 means the task
+ * would have overflowed on the target. Running past the guard page faults.
+ */
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+void vPortEnterCritical(portMUX_TYPE *mux)
+{
+  while (__atomic_exchange_n(&mux->locked, 1, __ATOMIC_ACQUIRE))
+  {
+    std::this_thread::yield();
+  }
+}
+
+void vPortExitCritical(portMUX_TYPE *mux)
+{
+  __atomic_store_n(&mux->locked, 0, __ATOMIC_RELEASE);
+}
+
+struct QueueDefinition
+{
+  std::mutex mutex;
+  std::condition_variable not_empty;
+  std::condition_variable not_full;
+  std::vector<unsigned char> storage;
+  UBaseType_t length;
+  UBaseType_t item_size;
+  UBaseType_t head;
+  UBaseType_t waiting;
+};
+
+// Waits on `condition` until `ready()` holds or the FreeRTOS timeout expires.
+template <typename Predicate>
+static bool wait_for(std::condition_variable &condition, std::unique_lock<std::mutex> &lock, TickType_t ticks, Predicate ready)
+{
+  if (ticks == portMAX_DELAY)
+  {
+    condition.wait(lock, ready);
+    return true;
+  }
+  return condition.wait_for(lock, std::chrono::milliseconds((uint64_t)ticks * portTICK_PERIOD_MS), ready);
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize)
+{
+  if (uxQueueLength == 0)
+  {
+    return NULL;
+  }
+
+  QueueDefinition *queue = new QueueDefinition();
+  queue->storage.resize((size_t)uxQueueLength * uxItemSize);
+  queue->length = uxQueueLength;
+  queue->item_size = uxItemSize;
+  queue->head = 0;
+  queue->waiting = 0;
+  return queue;
+}
+
+void vQueueDelete(QueueHandle_t xQueue)
+{
+  delete xQueue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait)
+{
+  std::unique_lock<std::mutex> lock(xQueue->mutex);
+  if (!wait_for(xQueue->not_full, lock, xTicksToWait, [xQueue] { return xQueue->waiting < xQueue->length; }))
+  {
+    return pdFAIL;
+  }
+
+  UBaseType_t tail = (xQueue->head + xQueue->waiting) % xQueue->length;
+  if (xQueue->item_size > 0)
+  {
+    memcpy(xQueue->storage.data() + (size_t)tail * xQueue->item_size, pvItemToQueue, xQueue->item_size);
+  }
+  xQueue->waiting++;
+
+  lock.unlock();
+  xQueue->not_empty.notify_one();
+  return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait)
+{
+  std::unique_lock<std::mutex> lock(xQueue->mutex);
+  if (!wait_for(xQueue->not_empty, lock, xTicksToWait, [xQueue] { return xQueue->waiting > 0; }))
+  {
+    return pdFAIL;
+  }
+
+  if (xQueue->item_size > 0)
+  {
+    memcpy(pvBuffer, xQueue->storage.data() + (size_t)xQueue->head * xQueue->item_size, xQueue->item_size);
+  }
+  xQueue->head = (xQueue->head + 1) % xQueue->length;
+  xQueue->waiting--;
+
+  lock.unlock();
+  xQueue->not_full.notify_one();
+  return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t xQueue)
+{
+  std::lock_guard<std::mutex> lock(xQueue->mutex);
+  return xQueue->waiting;
+}
+
+#define STACK_FILL_BYTE 0xa5
+
+struct tskTaskControlBlock
+{
+  pthread_t thread;
+  uint8_t *mapping; // the guard page, then the stack
+  size_t mapping_size;
+  uint8_t *stack_low; // usStackDepth below the entry frame, or the stack bottom
+  size_t stack_size;
+  uint32_t stack_depth;
+  TaskFunction_t function;
+  void *parameters;
+  char name[configMAX_TASK_NAME_LEN];
+};
+
+static char main_task_name[configMAX_TASK_NAME_LEN] = "main";
+
+static thread_local tskTaskControlBlock *current_task = NULL;
+
+static std::mutex finished_mutex;
+static std::vector<tskTaskControlBlock *> finished_tasks;
+
+// Joins the tasks that have returned and unmaps their stacks, which is what
+// the FreeRTOS idle task does for deleted tasks
+static void reap_finished_tasks()
+{
+  std::vector<tskTaskControlBlock *> tasks;
+  {
+    std::lock_guard<std::mutex> lock(finished_mutex);
+    tasks.swap(finished_tasks);
+  }
+  for (tskTaskControlBlock *task : tasks)
+  {
+    pthread_join(task->thread, NULL);
+    munmap(task->mapping, task->mapping_size);
+    delete task;
+  }
+}
+
+static void *run_task(void *arg)
+{
+  tskTaskControlBlock *task = (tskTaskControlBlock *)arg;
+  uint8_t entry = 0;
+  uint8_t *stack_base = task->mapping + sysconf(_SC_PAGESIZE);
+
+  // glibc keeps the thread descriptor and TLS at the top of the stack; the
+  // task's budget starts at its entry frame, below them
+  task->stack_low = (size_t)(&entry - stack_base) > task->stack_depth ? &entry - task->stack_depth : stack_base;
+  task->stack_size = &entry - task->stack_low;
+  current_task = task;
+  task->function(task->parameters);
+  current_task = NULL;
+
+  std::lock_guard<std::mutex> lock(finished_mutex);
+  finished_tasks.push_back(task);
+  return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pxTaskCode, const char *pcName, const uint32_t usStackDepth,
+                                   void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask,
+                                   const BaseType_t xCoreID)
+{
+  reap_finished_tasks();
+
+  // The usStackDepth bytes plus room for what glibc puts above the entry
+  // frame, in whole pages, with an inaccessible guard page below
+  size_t page_size = sysconf(_SC_PAGESIZE);
+  size_t stack_bytes = ((size_t)usStackDepth + PTHREAD_STACK_MIN + page_size - 1) / page_size * page_size;
+  tskTaskControlBlock *task = new tskTaskControlBlock();
+  task->mapping_size = page_size + stack_bytes;
+  task->mapping = (uint8_t *)mmap(NULL, task->mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+  if (task->mapping == MAP_FAILED)
+  {
+    delete task;
+    return pdFAIL;
+  }
+  mprotect(task->mapping, page_size, PROT_NONE);
+  memset(task->mapping + page_size, STACK_FILL_BYTE, stack_bytes);
+
+  task->stack_depth = usStackDepth;
+  task->function = pxTaskCode;
+  task->parameters = pvParameters;
+  strncpy(task->name, pcName != NULL ? pcName : "", sizeof(task->name) - 1);
+  task->name[sizeof(task->name) - 1] = '\0';
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstack(&attr, task->mapping + page_size, stack_bytes);
+  int ret = pthread_create(&task->thread, &attr, run_task, task);
+  pthread_attr_destroy(&attr);
+  if (ret != 0)
+  {
+    munmap(task->mapping, task->mapping_size);
+    delete task;
+    return pdFAIL;
+  }
+
+  if (pxCreatedTask != NULL)
+  {
+    *pxCreatedTask = NULL;
+  }
+  return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete)
+{
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t xTask)
+{
+  return 1;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t xTask)
+{
+  tskTaskControlBlock *task = xTask != NULL ? xTask : current_task;
+  if (task == NULL)
+  {
+    return 0;
+  }
+
+  size_t untouched = 0;
+  while (untouched < task->stack_size && task->stack_low[untouched] == STACK_FILL_BYTE)
+  {
+    untouched++;
+  }
+  return untouched;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+  return current_task;
+}
+
+char *pcTaskGetName(TaskHandle_t xTaskToQuery)
+{
+  tskTaskControlBlock *task = xTaskToQuery != NULL ? xTaskToQuery : current_task;
+  return task != NULL ? task->name : main_task_name;
+}
@@ -0,0 +1,182 @@
+/*
+ * Heap accounting for the host build.
+ *
+ * The executable is linked with -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc
+ * and --wrap=free, so the allocators below see every allocation made by code
+ * that is linked statically into it. Usage is measured with
+ * malloc_usable_size() and reported against an emulated heap of
+ * CONFIG_HOST_HEAP_SIZE bytes, which keeps esp_get_minimum_free_heap_size()
+ * and the local minimum monitor meaningful on Linux. The allocation hooks of
+ * CONFIG_HEAP_USE_HOOKS are called the same way as on the target.
+ */
+#include <malloc.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "sdkconfig.h"
+#include "esp_heap_caps.h"
+#include "esp_system.h"
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static atomic_long used_bytes;
+static atomic_long peak_used_bytes;
+static atomic_long local_peak_used_bytes;
+static atomic_bool local_monitor_active;
+
+static void raise_peak(atomic_long *peak, long used)
+{
+  long current = atomic_load(peak);
+  while (used > current && !atomic_compare_exchange_weak(peak, &current, used))
+  {
+  }
+}
+
+static void account_alloc(void *ptr)
+{
+  if (ptr == NULL)
+  {
+    return;
+  }
+
+  long size = (long)malloc_usable_size(ptr);
+  long used = atomic_fetch_add(&used_bytes, size) + size;
+  raise_peak(&peak_used_bytes, used);
+  if (atomic_load(&local_monitor_active))
+  {
+    raise_peak(&local_peak_used_bytes, used);
+  }
+}
+
+static void account_free(void *ptr)
+{
+  if (ptr == NULL)
+  {
+    return;
+  }
+
+  long size = (long)malloc_usable_size(ptr);
+  long used = atomic_fetch_sub(&used_bytes, size) - size;
+  if (used < 0)
+  {
+    /* Memory allocated outside the wrapped objects (e.g. inside libc) and
+       released here; do not let it drive the counter negative. */
+    atomic_fetch_add(&used_bytes, -used);
+  }
+}
+
+static void call_alloc_hook(void *ptr, size_t size)
+{
+  if (ptr != NULL && esp_heap_trace_alloc_hook != NULL)
+  {
+    esp_heap_trace_alloc_hook(ptr, size, MALLOC_CAP_DEFAULT);
+  }
+}
+
+static void call_free_hook(void *ptr)
+{
+  if (ptr != NULL && esp_heap_trace_free_hook != NULL)
+  {
+    esp_heap_trace_free_hook(ptr);
+  }
+}
+
+void *__wrap_malloc(size_t size)
+{
+  void *ptr = __real_malloc(size);
+  account_alloc(ptr);
+  call_alloc_hook(ptr, size);
+  return ptr;
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+  void *ptr = __real_calloc(nmemb, size);
+  account_alloc(ptr);
+  call_alloc_hook(ptr, nmemb * size);
+  return ptr;
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+  account_free(ptr);
+  void *new_ptr = __real_realloc(ptr, size);
+  account_alloc(new_ptr != NULL ? new_ptr : (size != 0 ? ptr : NULL));
+  if (new_ptr != NULL || size == 0)
+  {
+    call_free_hook(ptr);
+    call_alloc_hook(new_ptr, size);
+  }
+  return new_ptr;
+}
+
+void __wrap_free(void *ptr)
+{
+  account_free(ptr);
+  call_free_hook(ptr);
+  __real_free(ptr);
+}
+
+static size_t free_for(long used)
+{
+  return used >= CONFIG_HOST_HEAP_SIZE ? 0 : (size_t)(CONFIG_HOST_HEAP_SIZE - used);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+  (void)caps;
+  return free_for(atomic_load(&used_bytes));
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps)
+{
+  (void)caps;
+  if (atomic_load(&local_monitor_active))
+  {
+    return free_for(atomic_load(&local_peak_used_bytes));
+  }
+  return free_for(atomic_load(&peak_used_bytes));
+}
+
+size_t heap_caps_get_total_size(uint32_t caps)
+{
+  (void)caps;
+  return CONFIG_HOST_HEAP_SIZE;
+}
+
+esp_err_t heap_caps_monitor_local_minimum_free_size_start(void)
+{
+  if (atomic_load(&local_monitor_active))
+  {
+    return ESP_FAIL;
+  }
+
+  atomic_store(&local_peak_used_bytes, atomic_load(&used_bytes));
+  atomic_store(&local_monitor_active, true);
+  return ESP_OK;
+}
+
+esp_err_t heap_caps_monitor_local_minimum_free_size_stop(void)
+{
+  if (!atomic_load(&local_monitor_active))
+  {
+    return ESP_FAIL;
+  }
+
+  atomic_store(&local_monitor_active, false);
+  return ESP_OK;
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+  return (uint32_t)heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+}
+
+uint32_t esp_get_minimum_free_heap_size(void)
+{
+  return (uint32_t)heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT);
+}
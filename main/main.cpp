@@ -1,10 +1,19 @@
 #include <stdio.h>
+#include "BenchmarkMatrix.h"
+#include "BenchmarkRunner.h"
 #include "CryptoAPI.h"
+#include "CryptoSession.h"
+#include "SpanTrace.h"
+#include "StackProfiler.h"
 
 #include "esp_system.h"
+#include "esp_timer.h"
 
 #define MY_RSA_KEY_SIZE 4096
 #define MY_RSA_EXPONENT 65537
+// The matrix generates RSA keys several times per hash; 4096-bit ones would
+// take most of an hour
+#define MATRIX_RSA_KEY_SIZE 2048
 
 static const char *TAG = "Main";
 
@@ -18,15 +27,137 @@ static const size_t message_length = sizeof(message);
 CryptoAPI crypto_api;
 
 int perform_tests(Libraries library, Algorithms algorithm, Hashes hash, size_t shake_256_length);
+int perform_session_tests(CryptoSession &session, Libraries library, Algorithms algorithm, Hashes hash, size_t shake_256_length);
+int perform_benchmarks(CryptoSession &session, Libraries library, Algorithms algorithm, Hashes hash, size_t shake_256_length);
 
 extern "C" void app_main(void)
 {
+    // Parsed by tools/backend_footprint.py to compare backend configurations
+    ESP_LOGI(TAG, "Boot footprint: %lld us to app_main, %lu bytes free heap", esp_timer_get_time(), (unsigned long)esp_get_free_heap_size());
+
     for (int i = 1; i <= 10; i++)
     {
         printf("---------- Beggining operation %d ----------", i);
         int ret = perform_tests(Libraries::WOLFSSL_LIB, Algorithms::ECDSA_BP256R1, Hashes::MY_SHA_512, 512);
         ESP_LOGI(TAG, "Finished status: %d", ret);
     }
+
+    // The same operations on a session: only the first one sets up the
+    // library and generates keys.
+    CryptoSession session(crypto_api);
+    for (int i = 1; i <= 10; i++)
+    {
+        int64_t start_time = esp_timer_get_time();
+        int ret = perform_session_tests(session, Libraries::WOLFSSL_LIB, Algorithms::ECDSA_BP256R1, Hashes::MY_SHA_512, 512);
+        ESP_LOGI(TAG, "Session operation %d finished status: %d in %lld us", i, ret, esp_timer_get_time() - start_time);
+    }
+
+    // Min/median/p95/p99/mean over many iterations, with warmup and outliers
+    // left out, for comparing libraries
+    int ret = perform_benchmarks(session, Libraries::WOLFSSL_LIB, Algorithms::ECDSA_BP256R1, Hashes::MY_SHA_512, 512);
+    ESP_LOGI(TAG, "Benchmarks finished status: %d", ret);
+    session.close();
+
+    // Every library/algorithm/hash combination the build supports, as one table
+    BenchmarkMatrix matrix(crypto_api);
+    ret = matrix.run(message, message_length, MATRIX_RSA_KEY_SIZE, MY_RSA_EXPONENT, 512);
+    ESP_LOGI(TAG, "Benchmark matrix finished status: %d", ret);
+    crypto_api.flush_log();
+    matrix.print_table(stdout);
+
+    // Print the operation logs still waiting in the TraceLog before the CSV
+    crypto_api.flush_log();
+
+    // One CSV row per measured operation, to copy out of the serial monitor
+    crypto_api.export_results(NULL, ResultFormat::RESULT_CSV);
+
+#if CRYPTO_API_SPAN_TRACE
+    // The phases of the last matrix cells, to open in ui.perfetto.dev
+    crypto_api.export_spans("/littlefs/spans.json");
+#endif
+}
+
+int perform_session_tests(CryptoSession &session, Libraries library, Algorithms algorithm, Hashes hash, size_t shake_256_length)
+{
+    int ret = session.open(library, algorithm, hash, shake_256_length, MY_RSA_KEY_SIZE, MY_RSA_EXPONENT);
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    size_t signature_length = crypto_api.get_signature_size();
+    unsigned char *signature = (unsigned char *)malloc(signature_length * sizeof(unsigned char));
+
+    ret = crypto_api.sign(message, message_length, signature, &signature_length);
+    if (ret == 0)
+    {
+        ret = crypto_api.verify(message, message_length, signature, signature_length);
+    }
+
+    free(signature);
+    return ret;
+}
+
+struct BenchmarkContext
+{
+    unsigned char *signature;
+    size_t signature_size;
+    size_t signature_length;
+};
+
+static int sign_once(void *user_data)
+{
+    BenchmarkContext *context = (BenchmarkContext *)user_data;
+    context->signature_length = context->signature_size;
+    return crypto_api.sign(message, message_length, context->signature, &context->signature_length);
+}
+
+static int verify_once(void *user_data)
+{
+    BenchmarkContext *context = (BenchmarkContext *)user_data;
+    return crypto_api.verify(message, message_length, context->signature, context->signature_length);
+}
+
+int perform_benchmarks(CryptoSession &session, Libraries library, Algorithms algorithm, Hashes hash, size_t shake_256_length)
+{
+    int ret = session.open(library, algorithm, hash, shake_256_length, MY_RSA_KEY_SIZE, MY_RSA_EXPONENT);
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    BenchmarkContext context;
+    context.signature_size = crypto_api.get_signature_size();
+    context.signature = (unsigned char *)malloc(context.signature_size * sizeof(unsigned char));
+
+    BenchmarkRunner runner;
+    BenchmarkStats stats;
+
+    ret = runner.run("sign", sign_once, &context, &stats);
+    if (ret == 0)
+    {
+        runner.print_stats("sign", stats);
+        ret = runner.run("verify", verify_once, &context, &stats);
+    }
+    if (ret == 0)
+    {
+        runner.print_stats("verify", stats);
+    }
+
+    // Stack each operation needs, for sizing the tasks that run them
+    StackProfiler profiler;
+    uint32_t stack_bytes = 0;
+    if (ret == 0)
+    {
+        ret = profiler.run("sign", sign_once, &context, &stack_bytes);
+    }
+    if (ret == 0)
+    {
+        ret = profiler.run("verify", verify_once, &context, &stack_bytes);
+    }
+
+    free(context.signature);
+    return ret;
 }
 
 int perform_tests(Libraries library, Algorithms algorithm, Hashes hash, size_t shake_256_length)
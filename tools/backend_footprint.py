@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+"""Compare the cost of each CryptoAPI backend configuration.
+
+Builds the firmware once per backend selection (components/CryptoAPI/Kconfig)
+and reports the application image size against the all-backends build. With
+--port, each image is also flashed and the "Boot footprint" line logged by
+app_main is read back to compare time-to-app_main and free heap.
+
+Run from an ESP-IDF shell in the project root:
+
+    python tools/backend_footprint.py [--port /dev/ttyUSB0]
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+import time
+
+CONFIGURATIONS = [
+    ("all", ("MBEDTLS", "WOLFSSL", "MICROECC")),
+    ("mbedtls", ("MBEDTLS",)),
+    ("wolfssl", ("WOLFSSL",)),
+    ("microecc", ("MICROECC",)),
+    ("mbedtls+microecc", ("MBEDTLS", "MICROECC")),
+]
+
+BACKENDS = ("MBEDTLS", "WOLFSSL", "MICROECC")
+
+BOOT_LINE = re.compile(r"Boot footprint: (\d+) us to app_main, (\d+) bytes free heap")
+
+
+def idf(build_dir, *args):
+    sdkconfig = os.path.join(build_dir, "sdkconfig")
+    defaults = "sdkconfig;" + os.path.join(build_dir, "backends.defaults")
+    command = ["idf.py", "-B", build_dir, "-D", "SDKCONFIG=" + sdkconfig, "-D", "SDKCONFIG_DEFAULTS=" + defaults]
+    subprocess.run(command + list(args), check=True, stdout=subprocess.DEVNULL)
+
+
+def build(name, enabled, root):
+    build_dir = os.path.join(root, name)
+    os.makedirs(build_dir, exist_ok=True)
+
+    # Start from the project sdkconfig and only override the backend choice
+    with open(os.path.join(build_dir, "backends.defaults"), "w") as defaults:
+        for backend in BACKENDS:
+            if backend in enabled:
+                defaults.write("CONFIG_CRYPTO_API_BACKEND_%s=y\n" % backend)
+            else:
+                defaults.write("# CONFIG_CRYPTO_API_BACKEND_%s is not set\n" % backend)
+
+    # Regenerate sdkconfig so an earlier run with other choices does not stick
+    sdkconfig = os.path.join(build_dir, "sdkconfig")
+    if os.path.exists(sdkconfig):
+        os.remove(sdkconfig)
+
+    idf(build_dir, "build")
+
+    with open(os.path.join(build_dir, "project_description.json")) as description:
+        app_bin = re.search(r'"app_bin"\s*:\s*"([^"]+)"', description.read()).group(1)
+    return build_dir, os.path.getsize(os.path.join(build_dir, app_bin))
+
+
+def read_boot_footprint(build_dir, port, timeout):
+    import serial  # shipped with the ESP-IDF python environment
+
+    idf(build_dir, "-p", port, "flash")
+
+    with serial.Serial(port, 115200, timeout=1) as device:
+        # Pulse EN to get a clean boot log from the freshly flashed image
+        device.dtr = False
+        device.rts = True
+        time.sleep(0.1)
+        device.rts = False
+
+        deadline = time.time() + timeout
+        while time.time() < deadline:
+            match = BOOT_LINE.search(device.readline().decode(errors="ignore"))
+            if match:
+                return int(match.group(1)), int(match.group(2))
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--port", help="serial port; flash each image and read its boot footprint")
+    parser.add_argument("--build-root", default="build-footprint", help="directory for the per-configuration builds")
+    parser.add_argument("--timeout", type=float, default=15.0, help="seconds to wait for the boot line")
+    args = parser.parse_args()
+
+    results = []
+    for name, enabled in CONFIGURATIONS:
+        print("building %s..." % name, file=sys.stderr)
+        build_dir, image_size = build(name, enabled, args.build_root)
+        boot = read_boot_footprint(build_dir, args.port, args.timeout) if args.port else None
+        results.append((name, image_size, boot))
+
+    _, base_size, base_boot = results[0]
+
+    header = "%-18s %12s %12s" % ("configuration", "image bytes", "flash saved")
+    if args.port:
+        header += " %12s %12s %12s %12s" % ("boot us", "boot saved", "free heap", "heap saved")
+    print(header)
+
+    for name, image_size, boot in results:
+        row = "%-18s %12d %12d" % (name, image_size, base_size - image_size)
+        if args.port:
+            if boot and base_boot:
+                row += " %12d %12d %12d %12d" % (boot[0], base_boot[0] - boot[0], boot[1], boot[1] - base_boot[1])
+            else:
+                row += " %12s %12s %12s %12s" % ("-", "-", "-", "-")
+        print(row)
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())